@@ -3,6 +3,7 @@ set(CMAKE_CXX_STANDARD_REQUIRED True)
 
 set(LIB_DIR ${CMAKE_SOURCE_DIR}/src/library)
 set(DEMO_DIR ${CMAKE_SOURCE_DIR}/src/demos)
+set(TOOL_DIR ${CMAKE_SOURCE_DIR}/src/tools)
 set(EXTERN_DIR ${CMAKE_SOURCE_DIR}/extern)
 
 set(LIBRARY_OUTPUT_PATH "${CMAKE_BINARY_DIR}")
@@ -87,11 +87,12 @@ void main() {
 
     vec3 normalCamera = passNormalCamera;
     if(material.normalTextureIndex > -1) {
-        vec4 normalData = texture(materialTextures[material.normalTextureIndex], passTexCoord);
+        //z is reconstructed from x and y so two channel normal maps (BC5) work as well
+        vec2 normalData = 2.0 * texture(materialTextures[material.normalTextureIndex], passTexCoord).xy - 1.0;
         normalCamera = normalize(
-            (2.0 * normalData.x - 1.0) * passTangentCamera
-            + (2.0 * normalData.y - 1.0) * passBitangentCamera
-            + normalData.z * passNormalCamera);
+            normalData.x * passTangentCamera
+            + normalData.y * passBitangentCamera
+            + sqrt(max(0.0, 1.0 - dot(normalData, normalData))) * passNormalCamera);
     }
     vec3 viewVector = normalize(-passPositionCamera);
 
@@ -1,13 +1,10 @@
 #version 450
 
-layout(location = 0) in vec4 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec2 inTextureCoord;
-layout(location = 3) in vec3 inTangent;
-
 #include Camera
 #include SceneNodeConstants
+#include VertexPosition
 
 void main(){
-    gl_Position = camera.projection * camera.view * model * inPosition;
+    vec4 position = getPosition();
+    gl_Position = camera.projection * camera.view * model * position;
 }
\ No newline at end of file
@@ -26,11 +26,13 @@ int main() {
     camera = std::make_shared<Camera>(screenWidth, screenHeight, context->getWindow());
     //camera->setPosition(glm::vec3(0.0f, 0.3f, 0.0f));
 
+    //Mesh::setVertexFormat(packedVertexFormat);
+    //Mesh::setSplitVertexStreams(true);
+
     scene = std::make_shared<Scene>();
 
-    auto modelNode = std::make_unique<SceneNode>();
-    ResourceLoader::loadModel("watering_can_metal_01_4k", modelNode);
-    //modelNode->getChildren().back().get()->scale(0.1f);
+    //the model and its textures load in the background while the rest of the scene is set up
+    auto modelNode = ResourceLoader::loadModelAsync("watering_can_metal_01_4k");
     scene->addSceneNode(modelNode);
     scene->addSun(30.0f, 50.0f, glm::vec3(0.85f, 0.67f, 0.29f), 1.0f);
 
@@ -57,6 +59,7 @@ int main() {
     scene->addSceneNode(lightsNode);
 
     DeferredRenderer renderer(context, camera, scene);
+    context->printMemoryStatistics();
 
     while(!glfwWindowShouldClose(context->getWindow().get())) {
         glfwPollEvents();
@@ -0,0 +1,192 @@
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include "ResourceLoader.h"
+
+/**
+ * Check whether two loaded models contain exactly the same geometry.
+ */
+bool isIdentical(std::unique_ptr<SceneNode> &a, std::unique_ptr<SceneNode> &b) {
+    if(a->getChildren().size() != b->getChildren().size()) {
+        return false;
+    }
+    for(size_t c=0; c<a->getChildren().size(); c++) {
+        auto &meshA = a->getChildren()[c]->getMesh();
+        auto &meshB = b->getChildren()[c]->getMesh();
+        if(meshA->getNumVertices() != meshB->getNumVertices() || meshA->getIndices() != meshB->getIndices()
+            || std::memcmp(meshA->getVertices().data(), meshB->getVertices().data(), meshA->getNumVertices() * sizeof(Vertex)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Measure the throughput of ResourceLoader::loadModel on the bundled models.
+ * 
+ * Only the parsing is measured, no vulkan context is created.
+ * The mesh processing done afterwards (levels of detail, Mesh::optimize, meshlets) is timed separately.
+ * The vertex cache efficiency (ACMR and ATVR) of the meshes is reported before and after Mesh::optimize,
+ * as well as the number of triangles of each level of detail and the size of the meshlets.
+ * Every model is parsed with 1, 2, 4, ... threads up to the number of hardware threads,
+ * then loaded from the binary model cache.
+ * Usage: slbModelLoadingBenchmark [numIterations] [model names...]
+ */
+int main(int argc, char *argv[]) {
+    int numIterations = 20;
+    std::vector<std::string> models = {
+        "teapot",
+        "watering_can_metal_01_4k"
+    };
+    if(argc > 1) {
+        numIterations = std::max(1, std::atoi(argv[1]));
+    }
+    if(argc > 2) {
+        models.assign(argv + 2, argv + argc);
+    }
+
+    std::vector<uint32_t> threadCounts;
+    uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for(uint32_t t=1; t<maxThreads; t*=2) {
+        threadCounts.emplace_back(t);
+    }
+    threadCounts.emplace_back(maxThreads);
+
+    for(auto &model : models) {
+        size_t fileSize;
+        {
+            MappedFile objFile("../resources/models/" + model + ".obj");
+            MappedFile mtlFile("../resources/models/" + model + ".mtl");
+            fileSize = objFile.getSize() + mtlFile.getSize();
+        }
+
+        //serial references with and without mesh processing, also warm up the file cache
+        auto referenceNode = std::make_unique<SceneNode>();
+        ResourceLoader::loadModel(model, referenceNode, 1, false);
+        auto unoptimizedNode = std::make_unique<SceneNode>();
+        ResourceLoader::loadModel(model, unoptimizedNode, 1, false, false);
+        uint32_t numVertices = 0;
+        uint32_t numTriangles = 0;
+        std::vector<uint32_t> lodTriangles(maxMeshLods, 0);
+        uint32_t numMeshlets = 0;
+        uint32_t meshletVertices = 0;
+        for(auto &child : referenceNode->getChildren()) {
+            for(auto &meshlet : child->getMesh()->getMeshlets()) {
+                numMeshlets++;
+                meshletVertices += meshlet.numVertices;
+            }
+            numVertices += child->getMesh()->getNumVertices();
+            numTriangles += child->getMesh()->getLod(0).numIndices / 3;
+            for(uint32_t l=0; l<maxMeshLods; l++) {
+                auto &mesh = child->getMesh();
+                lodTriangles[l] += mesh->getLod(std::min(l, mesh->getNumLods() - 1)).numIndices / 3;
+            }
+        }
+
+        double megaBytes = static_cast<double>(fileSize) / (1024.0 * 1024.0);
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << model << ": " << megaBytes << " MB, " << referenceNode->getChildren().size() << " meshes, "
+            << numVertices << " vertices, " << numTriangles << " triangles" << std::endl;
+        std::cout << "   levels of detail:";
+        for(auto triangles : lodTriangles) {
+            std::cout << " " << triangles;
+        }
+        std::cout << " triangles" << std::endl;
+        if(numMeshlets > 0) {
+            std::cout << "   meshlets: " << numMeshlets << " with on average " << static_cast<double>(meshletVertices) / numMeshlets << " vertices and "
+                << static_cast<double>(numTriangles) / numMeshlets << " triangles" << std::endl;
+        }
+
+        //vertex cache efficiency in file order compared to the optimized meshes
+        {
+            std::cout << std::setprecision(3);
+            for(uint32_t cacheSize : {16u, 32u}) {
+                double missesBefore = 0.0, missesAfter = 0.0;
+                uint32_t verticesBefore = 0;
+                for(size_t c=0; c<referenceNode->getChildren().size(); c++) {
+                    auto &meshBefore = unoptimizedNode->getChildren()[c]->getMesh();
+                    auto &meshAfter = referenceNode->getChildren()[c]->getMesh();
+                    missesBefore += meshBefore->getACMR(cacheSize) * (meshBefore->getLod(0).numIndices / 3);
+                    missesAfter += meshAfter->getACMR(cacheSize) * (meshAfter->getLod(0).numIndices / 3);
+                    verticesBefore += meshBefore->getNumVertices();
+                }
+                std::cout << "   vertex cache " << std::setw(2) << cacheSize << ": ACMR " << missesBefore / numTriangles << " -> " << missesAfter / numTriangles
+                    << ", ATVR " << missesBefore / verticesBefore << " -> " << missesAfter / numVertices << std::endl;
+            }
+            std::cout << std::setprecision(2);
+        }
+
+        for(auto numThreads : threadCounts) {
+            double bestSeconds = std::numeric_limits<double>::max();
+            double totalSeconds = 0.0;
+            bool identical = true;
+            for(int i=0; i<numIterations; i++) {
+                auto modelNode = std::make_unique<SceneNode>();
+                auto start = std::chrono::steady_clock::now();
+                ResourceLoader::loadModel(model, modelNode, numThreads, false, false);
+                auto end = std::chrono::steady_clock::now();
+
+                double seconds = std::chrono::duration<double>(end - start).count();
+                bestSeconds = std::min(bestSeconds, seconds);
+                totalSeconds += seconds;
+                identical = identical && isIdentical(unoptimizedNode, modelNode);
+            }
+
+            std::cout << "   " << std::setw(3) << numThreads << " threads: average " << 1000.0 * totalSeconds / numIterations << " ms, "
+                << megaBytes * numIterations / totalSeconds << " MB/s, best " << 1000.0 * bestSeconds << " ms, "
+                << megaBytes / bestSeconds << " MB/s" << (identical ? "" : ", OUTPUT DIFFERS FROM SERIAL") << std::endl;
+        }
+
+        //mesh processing of the parsed meshes, done on a single thread per mesh by the loader
+        {
+            double lodSeconds = 0.0, optimizeSeconds = 0.0, meshletSeconds = 0.0;
+            for(int i=0; i<numIterations; i++) {
+                auto modelNode = std::make_unique<SceneNode>();
+                ResourceLoader::loadModel(model, modelNode, 0, false, false);
+                for(auto &child : modelNode->getChildren()) {
+                    auto &mesh = child->getMesh();
+                    auto start = std::chrono::steady_clock::now();
+                    mesh->generateLods();
+                    auto lodEnd = std::chrono::steady_clock::now();
+                    mesh->optimize();
+                    auto optimizeEnd = std::chrono::steady_clock::now();
+                    mesh->generateMeshlets();
+                    auto end = std::chrono::steady_clock::now();
+
+                    lodSeconds += std::chrono::duration<double>(lodEnd - start).count();
+                    optimizeSeconds += std::chrono::duration<double>(optimizeEnd - lodEnd).count();
+                    meshletSeconds += std::chrono::duration<double>(end - optimizeEnd).count();
+                }
+            }
+            std::cout << "   processing: average " << 1000.0 * lodSeconds / numIterations << " ms levels of detail, "
+                << 1000.0 * optimizeSeconds / numIterations << " ms optimize, " << 1000.0 * meshletSeconds / numIterations << " ms meshlets" << std::endl;
+        }
+
+        //binary model cache, written by the first call if it is missing or outdated
+        {
+            auto modelNode = std::make_unique<SceneNode>();
+            ResourceLoader::loadModel(model, modelNode);
+        }
+        double bestSeconds = std::numeric_limits<double>::max();
+        double totalSeconds = 0.0;
+        bool identical = true;
+        for(int i=0; i<numIterations; i++) {
+            auto modelNode = std::make_unique<SceneNode>();
+            auto start = std::chrono::steady_clock::now();
+            ResourceLoader::loadModel(model, modelNode);
+            auto end = std::chrono::steady_clock::now();
+
+            double seconds = std::chrono::duration<double>(end - start).count();
+            bestSeconds = std::min(bestSeconds, seconds);
+            totalSeconds += seconds;
+            identical = identical && isIdentical(referenceNode, modelNode);
+        }
+        std::cout << "   cached:     average " << 1000.0 * totalSeconds / numIterations << " ms, best " << 1000.0 * bestSeconds << " ms"
+            << (identical ? "" : ", OUTPUT DIFFERS FROM SERIAL") << std::endl;
+    }
+
+    return 0;
+}
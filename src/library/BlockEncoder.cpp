@@ -0,0 +1,312 @@
+#include "BlockEncoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+/** Interpolation weights of the 4 bit BC7 indices in 1/64 */
+const uint32_t bc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+VkFormat BlockEncoder::getFormat(TextureEncoding encoding) {
+    switch(encoding) {
+        case bc7Encoding:
+            return VK_FORMAT_BC7_UNORM_BLOCK;
+        case bc5Encoding:
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        case bc4Encoding:
+            return VK_FORMAT_BC4_UNORM_BLOCK;
+        default:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+std::string BlockEncoder::getName(TextureEncoding encoding) {
+    switch(encoding) {
+        case bc7Encoding:
+            return "bc7";
+        case bc5Encoding:
+            return "bc5";
+        case bc4Encoding:
+            return "bc4";
+        default:
+            return "rgba";
+    }
+}
+
+size_t BlockEncoder::getEncodedSize(TextureEncoding encoding, uint32_t width, uint32_t height) {
+    size_t numBlocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+    switch(encoding) {
+        case bc7Encoding:
+        case bc5Encoding:
+            return numBlocks * 16;
+        case bc4Encoding:
+            return numBlocks * 8;
+        default:
+            return static_cast<size_t>(width) * height * 4;
+    }
+}
+
+void BlockEncoder::encode(TextureEncoding encoding, const unsigned char *pixels, uint32_t width, uint32_t height, unsigned char *target, uint32_t numThreads) {
+    if(encoding == rgbaEncoding) {
+        memcpy(target, pixels, getEncodedSize(encoding, width, height));
+        return;
+    }
+
+    uint32_t numBlocksX = (width + 3) / 4;
+    uint32_t numBlocksY = (height + 3) / 4;
+    size_t blockSize = encoding == bc4Encoding ? 8 : 16;
+    if(numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = std::min(numThreads, numBlocksY);
+
+    //rows of blocks are handed out one at a time, so threads finishing early take over the remaining work
+    std::atomic<uint32_t> nextRow(0);
+    auto encodeRows = [&]() {
+        unsigned char block[64];
+        for(uint32_t y = nextRow++; y < numBlocksY; y = nextRow++) {
+            unsigned char *rowTarget = target + static_cast<size_t>(y) * numBlocksX * blockSize;
+            for(uint32_t x=0; x<numBlocksX; x++) {
+                loadBlock(pixels, width, height, x, y, block);
+                if(encoding == bc7Encoding) {
+                    encodeBC7Block(block, rowTarget + x * blockSize);
+                } else if(encoding == bc5Encoding) {
+                    encodeBC4Block(block, 0, rowTarget + x * blockSize);
+                    encodeBC4Block(block, 1, rowTarget + x * blockSize + 8);
+                } else {
+                    encodeBC4Block(block, 0, rowTarget + x * blockSize);
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(uint32_t t=1; t<numThreads; t++) {
+        threads.emplace_back(encodeRows);
+    }
+    encodeRows();
+    for(auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void BlockEncoder::loadBlock(const unsigned char *pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, unsigned char *block) {
+    for(uint32_t y=0; y<4; y++) {
+        uint32_t pixelY = std::min(4 * blockY + y, height - 1);
+        for(uint32_t x=0; x<4; x++) {
+            uint32_t pixelX = std::min(4 * blockX + x, width - 1);
+            memcpy(block + 4 * (4 * y + x), pixels + 4 * (static_cast<size_t>(pixelY) * width + pixelX), 4);
+        }
+    }
+}
+
+void BlockEncoder::encodeBC4Block(const unsigned char *block, uint32_t channel, unsigned char *target) {
+    uint32_t minValue = 255;
+    uint32_t maxValue = 0;
+    for(uint32_t p=0; p<16; p++) {
+        minValue = std::min(minValue, static_cast<uint32_t>(block[4 * p + channel]));
+        maxValue = std::max(maxValue, static_cast<uint32_t>(block[4 * p + channel]));
+    }
+
+    //with the first endpoint larger than the second, the indices cover 8 evenly spaced values
+    target[0] = static_cast<unsigned char>(maxValue);
+    target[1] = static_cast<unsigned char>(minValue);
+    uint64_t indexBits = 0;
+    if(maxValue > minValue) {
+        uint32_t range = maxValue - minValue;
+        for(uint32_t p=0; p<16; p++) {
+            //position between the endpoints from 0 (first endpoint) to 7 (second endpoint)
+            uint32_t position = ((maxValue - block[4 * p + channel]) * 14 + range) / (2 * range);
+            uint64_t index = position == 0 ? 0 : (position == 7 ? 1 : position + 1);
+            indexBits |= index << (3 * p);
+        }
+    }
+    for(uint32_t b=0; b<6; b++) {
+        target[2 + b] = static_cast<unsigned char>(indexBits >> (8 * b));
+    }
+}
+
+void BlockEncoder::encodeBC7Block(const unsigned char *block, unsigned char *target) {
+    //principal axis of the block colors by power iteration on the covariance matrix
+    float mean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for(uint32_t p=0; p<16; p++) {
+        for(uint32_t c=0; c<4; c++) {
+            mean[c] += block[4 * p + c] / 16.0f;
+        }
+    }
+    float covariance[16] = {};
+    for(uint32_t p=0; p<16; p++) {
+        float difference[4];
+        for(uint32_t c=0; c<4; c++) {
+            difference[c] = block[4 * p + c] - mean[c];
+        }
+        for(uint32_t i=0; i<16; i++) {
+            covariance[i] += difference[i / 4] * difference[i % 4];
+        }
+    }
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for(uint32_t iteration=0; iteration<8; iteration++) {
+        float next[4] = {};
+        for(uint32_t i=0; i<16; i++) {
+            next[i / 4] += covariance[i] * axis[i % 4];
+        }
+        float length = std::max(std::max(std::abs(next[0]), std::abs(next[1])), std::max(std::abs(next[2]), std::abs(next[3])));
+        if(length < 1e-6f) {
+            break;
+        }
+        for(uint32_t c=0; c<4; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    //the extreme projections onto the axis give the initial endpoints
+    float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3];
+    float minProjection = 0.0f;
+    float maxProjection = 0.0f;
+    for(uint32_t p=0; p<16; p++) {
+        float projection = 0.0f;
+        for(uint32_t c=0; c<4; c++) {
+            projection += (block[4 * p + c] - mean[c]) * axis[c];
+        }
+        minProjection = std::min(minProjection, projection / axisLength);
+        maxProjection = std::max(maxProjection, projection / axisLength);
+    }
+    float endpoints[8];
+    for(uint32_t c=0; c<4; c++) {
+        endpoints[c] = mean[c] + minProjection * axis[c];
+        endpoints[4 + c] = mean[c] + maxProjection * axis[c];
+    }
+
+    uint32_t quantized[8];
+    uint32_t parityBits[2];
+    uint32_t indices[16];
+    uint32_t error = fitBC7Endpoints(block, endpoints, quantized, parityBits, indices);
+
+    //least squares refinement of the endpoints for the chosen indices
+    float a = 0.0f, b = 0.0f, d = 0.0f;
+    float x[4] = {}, y[4] = {};
+    for(uint32_t p=0; p<16; p++) {
+        float weight = bc7Weights[indices[p]] / 64.0f;
+        a += (1.0f - weight) * (1.0f - weight);
+        b += (1.0f - weight) * weight;
+        d += weight * weight;
+        for(uint32_t c=0; c<4; c++) {
+            x[c] += (1.0f - weight) * block[4 * p + c];
+            y[c] += weight * block[4 * p + c];
+        }
+    }
+    float determinant = a * d - b * b;
+    if(error > 0 && std::abs(determinant) > 1e-6f) {
+        float refined[8];
+        for(uint32_t c=0; c<4; c++) {
+            refined[c] = (d * x[c] - b * y[c]) / determinant;
+            refined[4 + c] = (a * y[c] - b * x[c]) / determinant;
+        }
+        uint32_t refinedQuantized[8];
+        uint32_t refinedParityBits[2];
+        uint32_t refinedIndices[16];
+        uint32_t refinedError = fitBC7Endpoints(block, refined, refinedQuantized, refinedParityBits, refinedIndices);
+        if(refinedError < error) {
+            memcpy(quantized, refinedQuantized, sizeof(quantized));
+            memcpy(parityBits, refinedParityBits, sizeof(parityBits));
+            memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+
+    //the most significant index bit of the first pixel is implicit zero, swap the endpoints otherwise
+    if(indices[0] >= 8) {
+        for(uint32_t c=0; c<4; c++) {
+            std::swap(quantized[c], quantized[4 + c]);
+        }
+        std::swap(parityBits[0], parityBits[1]);
+        for(uint32_t p=0; p<16; p++) {
+            indices[p] = 15 - indices[p];
+        }
+    }
+
+    uint64_t bits[2] = {0, 0};
+    uint32_t position = 0;
+    auto putBits = [&](uint32_t value, uint32_t count) {
+        for(uint32_t i=0; i<count; i++, position++) {
+            bits[position / 64] |= static_cast<uint64_t>((value >> i) & 1) << (position % 64);
+        }
+    };
+    putBits(1 << 6, 7);
+    for(uint32_t c=0; c<4; c++) {
+        putBits(quantized[c], 7);
+        putBits(quantized[4 + c], 7);
+    }
+    putBits(parityBits[0], 1);
+    putBits(parityBits[1], 1);
+    putBits(indices[0], 3);
+    for(uint32_t p=1; p<16; p++) {
+        putBits(indices[p], 4);
+    }
+    for(uint32_t i=0; i<16; i++) {
+        target[i] = static_cast<unsigned char>(bits[i / 8] >> (8 * (i % 8)));
+    }
+}
+
+uint32_t BlockEncoder::fitBC7Endpoints(const unsigned char *block, const float *endpoints, uint32_t *quantized, uint32_t *parityBits, uint32_t *indices) {
+    uint32_t bestError = UINT32_MAX;
+    for(uint32_t combination=0; combination<4; combination++) {
+        uint32_t parity[2] = {combination & 1, combination >> 1};
+        uint32_t candidate[8];
+        int32_t values[8];
+        for(uint32_t i=0; i<8; i++) {
+            float value = (endpoints[i] - parity[i / 4]) / 2.0f;
+            candidate[i] = static_cast<uint32_t>(std::min(127.0f, std::max(0.0f, std::round(value))));
+            values[i] = static_cast<int32_t>(2 * candidate[i] + parity[i / 4]);
+        }
+
+        int32_t palette[64];
+        for(uint32_t k=0; k<16; k++) {
+            for(uint32_t c=0; c<4; c++) {
+                palette[4 * k + c] = ((64 - bc7Weights[k]) * values[c] + bc7Weights[k] * values[4 + c] + 32) >> 6;
+            }
+        }
+
+        //the projection onto the endpoint line narrows the search down to three neighboring indices
+        int32_t direction[4];
+        int32_t directionLength = 0;
+        for(uint32_t c=0; c<4; c++) {
+            direction[c] = values[4 + c] - values[c];
+            directionLength += direction[c] * direction[c];
+        }
+        uint32_t error = 0;
+        uint32_t candidateIndices[16];
+        for(uint32_t p=0; p<16; p++) {
+            int32_t projection = 0;
+            for(uint32_t c=0; c<4; c++) {
+                projection += (block[4 * p + c] - values[c]) * direction[c];
+            }
+            int32_t guess = directionLength > 0 ? (projection * 15 + directionLength / 2) / directionLength : 0;
+            guess = std::min(15, std::max(0, guess));
+
+            uint32_t bestPixelError = UINT32_MAX;
+            for(int32_t k = std::max(0, guess - 1); k <= std::min(15, guess + 1); k++) {
+                uint32_t pixelError = 0;
+                for(uint32_t c=0; c<4; c++) {
+                    int32_t difference = block[4 * p + c] - palette[4 * k + c];
+                    pixelError += static_cast<uint32_t>(difference * difference);
+                }
+                if(pixelError < bestPixelError) {
+                    bestPixelError = pixelError;
+                    candidateIndices[p] = static_cast<uint32_t>(k);
+                }
+            }
+            error += bestPixelError;
+        }
+
+        if(error < bestError) {
+            bestError = error;
+            memcpy(quantized, candidate, sizeof(candidate));
+            parityBits[0] = parity[0];
+            parityBits[1] = parity[1];
+            memcpy(indices, candidateIndices, sizeof(candidateIndices));
+        }
+    }
+    return bestError;
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef SLBVULKAN_BLOCKENCODER_H
+#define SLBVULKAN_BLOCKENCODER_H
+
+#include <cstdint>
+#include <string>
+
+#include "Context.h"
+
+/**
+ * Formats textures can be stored in on the GPU.
+ */
+enum TextureEncoding {
+    rgbaEncoding, /**< Uncompressed rgba with 8 bits per channel */
+    bc7Encoding, /**< BC7 block compression for color textures with alpha */
+    bc5Encoding, /**< BC5 block compression keeping only red and green, meant for tangent space normal maps */
+    bc4Encoding /**< BC4 block compression keeping only red, meant for roughness and metallic maps */
+};
+
+/**
+ * Compressor converting rgba pixel data to BC4, BC5, or BC7 blocks.
+ *
+ * Each 4x4 pixel block is encoded independently, rows of blocks are distributed over multiple threads.
+ * BC7 blocks use mode 6 (a single pair of rgba endpoints with 4 bit indices), which keeps the encoder fast
+ * while still being considerably more accurate than BC1 or BC3.
+ * Instead of SIMD intrinsics the per-block loops work on small fixed-size arrays the compiler can vectorize.
+ */
+class BlockEncoder {
+public:
+    /**
+     * Return the vulkan format of encoded data.
+     *
+     * @param encoding texture encoding
+     * @return matching vulkan format
+     */
+    static VkFormat getFormat(TextureEncoding encoding);
+
+    /**
+     * Return a short name of the encoding, used in file names.
+     *
+     * @param encoding texture encoding
+     * @return lower case name, e.g. "bc7"
+     */
+    static std::string getName(TextureEncoding encoding);
+
+    /**
+     * Return the number of bytes of a single image after encoding.
+     *
+     * @param encoding texture encoding
+     * @param width width of the image in number of pixels
+     * @param height height of the image in number of pixels
+     * @return size of the encoded data in bytes
+     */
+    static size_t getEncodedSize(TextureEncoding encoding, uint32_t width, uint32_t height);
+
+    /**
+     * Encode rgba pixel data.
+     *
+     * Blocks reaching over the edge of the image repeat the last row or column.
+     *
+     * @param encoding block compressed texture encoding
+     * @param pixels rgba pixel data with 8 bits per channel
+     * @param width width of the image in number of pixels
+     * @param height height of the image in number of pixels
+     * @param[out] target encoded blocks, at least getEncodedSize bytes
+     * @param numThreads maximum number of threads used for encoding, 0 uses all hardware threads
+     */
+    static void encode(TextureEncoding encoding, const unsigned char *pixels, uint32_t width, uint32_t height, unsigned char *target, uint32_t numThreads = 0);
+
+private:
+    /**
+     * Gather the 16 pixels of a block.
+     *
+     * @param pixels rgba pixel data of the whole image
+     * @param width width of the image in number of pixels
+     * @param height height of the image in number of pixels
+     * @param blockX horizontal index of the block
+     * @param blockY vertical index of the block
+     * @param[out] block rgba values of the block in row order
+     */
+    static void loadBlock(const unsigned char *pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, unsigned char *block);
+
+    /**
+     * Encode a single channel of a block as BC4.
+     *
+     * @param block rgba values of the block
+     * @param channel index of the encoded channel
+     * @param[out] target 8 bytes of BC4 data
+     */
+    static void encodeBC4Block(const unsigned char *block, uint32_t channel, unsigned char *target);
+
+    /**
+     * Encode a block as BC7 mode 6.
+     *
+     * Endpoints are found along the principal axis of the block colors and refined by a least squares fit.
+     * All four combinations of endpoint parity bits are tried.
+     *
+     * @param block rgba values of the block
+     * @param[out] target 16 bytes of BC7 data
+     */
+    static void encodeBC7Block(const unsigned char *block, unsigned char *target);
+
+    /**
+     * Quantize BC7 mode 6 endpoints and choose the best index for each pixel.
+     *
+     * @param block rgba values of the block
+     * @param endpoints two rgba endpoints before quantization
+     * @param[out] quantized two rgba endpoints with 7 bits per channel
+     * @param[out] parityBits parity bit of each endpoint
+     * @param[out] indices interpolation index for each pixel
+     * @return sum of squared errors of the block
+     */
+    static uint32_t fitBC7Endpoints(const unsigned char *block, const float *endpoints, uint32_t *quantized, uint32_t *parityBits, uint32_t *indices);
+
+};
+
+#endif //SLBVULKAN_BLOCKENCODER_H
\ No newline at end of file
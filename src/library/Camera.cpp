@@ -50,6 +50,16 @@ glm::mat4 Camera::getProjectionMatrix() {
     return projection;
 }
 
+LodSelection Camera::getLodSelection(float screenHeight, float maxPixelError) {
+    LodSelection selection;
+    selection.cameraPosition = glm::vec3(glm::inverse(getViewMatrix())[3]);
+    //the projection maps half the screen height to 1 in normalized device coordinates
+    selection.pixelsPerUnit = 0.5f * screenHeight * glm::abs(getProjectionMatrix()[1][1]);
+    selection.perspective = m_mode == trackBall || m_mode == pilotView;
+    selection.maxPixelError = maxPixelError;
+    return selection;
+}
+
 void Camera::setPosition(glm::vec3 position) {
     m_position = position;
 }
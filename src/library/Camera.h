@@ -40,6 +40,16 @@ struct CameraUniforms {
     float pad2; /**< Padding for now */
 };
 
+/**
+ * Camera parameters used to choose the level of detail of meshes.
+ */
+struct LodSelection {
+    glm::vec3 cameraPosition; /**< Position of the camera in world coordinates */
+    float pixelsPerUnit; /**< Number of pixels covered by a length of 1 in world coordinates, at distance 1 for perspective projection */
+    bool perspective; /**< True if the projected size decreases with the distance to the camera */
+    float maxPixelError; /**< Largest allowed error of a simplified mesh on screen in pixels */
+};
+
 /**
  * Camera to view the rendered scene.
  * Determines what part of the scene is visible by specifying a view and projection matrix used in the shaders.
@@ -90,6 +100,14 @@ public:
      */
     glm::mat4 getProjectionMatrix();
 
+    /**
+     * Provides the parameters for choosing the level of detail of meshes.
+     * @param screenHeight height of the rendered image in number of pixels
+     * @param maxPixelError largest allowed error of a simplified mesh on screen in pixels
+     * @return camera position and projection scale
+     */
+    LodSelection getLodSelection(float screenHeight, float maxPixelError = 1.0f);
+
     /**
      * Changes the position of the camera.
      * @param position new position in world coordinates
@@ -1,11 +1,28 @@
 #include "Context.h"
 
+#include <algorithm>
+
+#include "ResourceLoader.h"
+
 Context::Context(int width, int height, const char* title, bool enableValidationLayers) {
     createWindow(width, height, title);
     createInstance(title, enableValidationLayers);
     pickPhysicalDevice();
+
+    //decided before any asset is requested, so no texture is block compressed in vain
+    for(auto encoding : {bc7Encoding, bc5Encoding, bc4Encoding}) {
+        if(!hasFormatFeatures(BlockEncoder::getFormat(encoding), VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+            std::cout << "   CONTEXT: Block compressed textures are not supported, textures are uploaded uncompressed" << std::endl;
+            ResourceLoader::setTextureCompression(false);
+            break;
+        }
+    }
+
     createLogicalDevice(enableValidationLayers);
     createCommandPool();
+    m_memoryAllocator = std::make_unique<MemoryAllocator>(m_physicalDevice, m_logicalDevice);
+    uint32_t transferIndex = m_queueFamilyIndices.transferFound ? m_queueFamilyIndices.transferIndex : m_queueFamilyIndices.computeAndGraphicsIndex;
+    m_uploadManager = std::make_unique<UploadManager>(m_logicalDevice, *m_memoryAllocator, m_transferQueue, transferIndex, m_graphicsQueue, m_queueFamilyIndices.computeAndGraphicsIndex);
 }
 
 Context::~Context() {
@@ -28,6 +45,10 @@ VkCommandPool Context::getCommandPool() {
     return m_commandPool;
 }
 
+std::unique_ptr<UploadManager> &Context::getUploadManager() {
+    return m_uploadManager;
+}
+
 VkQueue Context::getComputeQueue() {
     return m_computeQueue;
 }
@@ -40,6 +61,10 @@ VkQueue Context::getPresentQueue() {
     return m_presentQueue;
 }
 
+VkQueue Context::getTransferQueue() {
+    return m_transferQueue;
+}
+
 std::array<uint32_t,2> Context::getQueueFamilyIndices() {
     return {m_queueFamilyIndices.computeAndGraphicsIndex, m_queueFamilyIndices.presentIndex};
 }
@@ -56,20 +81,20 @@ VkSampleCountFlagBits Context::getMaxSamples() {
     return m_maxSamples;
 }
 
+VkDeviceSize Context::getMinBufferOffsetAlignment() {
+    return m_minBufferOffsetAlignment;
+}
+
+VkDeviceSize Context::getNonCoherentAtomSize() {
+    return m_nonCoherentAtomSize;
+}
+
 PFN_vkVoidFunction Context::getExtensionFunction(const char *functionName) {
     return vkGetInstanceProcAddr(m_instance, functionName);
 }
 
 uint32_t Context::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memoryProperties;
-    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memoryProperties);
-    for(uint32_t i=0; i<memoryProperties.memoryTypeCount; i++) {
-        if(typeFilter & (1 << i) &&
-           (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-    throw std::runtime_error("CONTEXT ERROR: Could not find a suitable memory type");
+    return m_memoryAllocator->findMemoryType(typeFilter, properties);
 }
 
 VkFormat Context::findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling,
@@ -86,6 +111,15 @@ VkFormat Context::findSupportedFormat(const std::vector<VkFormat> &candidates, V
     throw std::runtime_error("CONTEXT ERROR: Could not find supported format.");
 }
 
+bool Context::hasFormatFeatures(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features) {
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &properties);
+    if(tiling == VK_IMAGE_TILING_LINEAR) {
+        return (properties.linearTilingFeatures & features) == features;
+    }
+    return (properties.optimalTilingFeatures & features) == features;
+}
+
 VkCommandBuffer Context::startSingleCommand() {
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -118,8 +152,24 @@ void Context::endSingleCommand(VkCommandBuffer commandBuffer) {
     vkFreeCommandBuffers(m_logicalDevice, m_commandPool, 1, &commandBuffer);
 }
 
+void Context::allocateMemory(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, AllocationType type, MemoryAllocation &allocation) {
+    m_memoryAllocator->allocate(requirements, properties, type, allocation);
+}
+
+void Context::freeMemory(MemoryAllocation &allocation) {
+    m_memoryAllocator->free(allocation);
+}
+
+MemoryStatistics Context::getMemoryStatistics() {
+    return m_memoryAllocator->getStatistics();
+}
+
+void Context::printMemoryStatistics() {
+    m_memoryAllocator->printStatistics();
+}
+
 void Context::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-                           VkBuffer &buffer, VkDeviceMemory &bufferMemory) {
+                           VkBuffer &buffer, MemoryAllocation &bufferMemory) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
@@ -132,17 +182,9 @@ void Context::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemory
 
     VkMemoryRequirements memoryRequirements;
     vkGetBufferMemoryRequirements(m_logicalDevice, buffer, &memoryRequirements);
+    allocateMemory(memoryRequirements, properties, bufferAllocation, bufferMemory);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memoryRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, properties);
-
-    if(vkAllocateMemory(m_logicalDevice, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("CONTEXT ERROR: Could not allocate buffer memory.");
-    }
-
-    vkBindBufferMemory(m_logicalDevice, buffer, bufferMemory, 0);
+    vkBindBufferMemory(m_logicalDevice, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
 void Context::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
@@ -295,6 +337,17 @@ QueueFamilyIndices Context::findQueueFamilyIndices(VkPhysicalDevice device) {
             break;
         }
     }
+    //find a queue family dedicated to transfers, which runs copies alongside rendering
+    for(uint32_t i=0; i<queueFamilyCount; i++) {
+        VkExtent3D granularity = queueFamilies[i].minImageTransferGranularity;
+        if((queueFamilies[i].queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+           !(queueFamilies[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+           granularity.width <= 1 && granularity.height <= 1 && granularity.depth <= 1) {
+            queueFamilyIndices.transferFound = true;
+            queueFamilyIndices.transferIndex = i;
+            break;
+        }
+    }
     //find present queue index
     VkBool32 presentSupport = false;
     for(uint32_t i=0; i<queueFamilyCount; i++) {
@@ -405,18 +458,24 @@ void Context::pickPhysicalDevice() {
         }
 
         m_timeStampPeriod = deviceProperties.limits.timestampPeriod;
+        m_minBufferOffsetAlignment = std::max(deviceProperties.limits.minUniformBufferOffsetAlignment, deviceProperties.limits.minStorageBufferOffsetAlignment);
+        m_nonCoherentAtomSize = deviceProperties.limits.nonCoherentAtomSize;
     }
 }
 
 void Context::createLogicalDevice(bool enableValidationLayers) {
     std::vector<VkDeviceQueueCreateInfo> queueInfos;
     std::set<uint32_t> queueFamilySet = {m_queueFamilyIndices.computeAndGraphicsIndex, m_queueFamilyIndices.presentIndex};
+    if(m_queueFamilyIndices.transferFound) {
+        queueFamilySet.insert(m_queueFamilyIndices.transferIndex);
+    }
+    //the priority has to outlive the loop, it is only read by vkCreateDevice
+    float queuePriority = 1.0f;
     for(uint32_t queueFamilyIndex : queueFamilySet) {
         VkDeviceQueueCreateInfo queueInfo{};
         queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueInfo.queueFamilyIndex = queueFamilyIndex;
         queueInfo.queueCount = 1;
-        float queuePriority = 1.0f;
         queueInfo.pQueuePriorities = &queuePriority;
         queueInfos.emplace_back(queueInfo);
     }
@@ -462,6 +521,12 @@ void Context::createLogicalDevice(bool enableValidationLayers) {
     vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices.computeAndGraphicsIndex, 0, &m_computeQueue);
     vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices.computeAndGraphicsIndex, 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices.presentIndex, 0, &m_presentQueue);
+    if(m_queueFamilyIndices.transferFound) {
+        vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices.transferIndex, 0, &m_transferQueue);
+        std::cout << "   CONTEXT: Uploads use the transfer queue family " << m_queueFamilyIndices.transferIndex << std::endl;
+    } else {
+        m_transferQueue = m_graphicsQueue;
+    }
 }
 
 void Context::createCommandPool() {
@@ -475,6 +540,12 @@ void Context::createCommandPool() {
 }
 
 void Context::cleanUp() {
+    if(m_uploadManager != nullptr) {
+        m_uploadManager->cleanUp();
+    }
+    if(m_memoryAllocator != nullptr) {
+        m_memoryAllocator->cleanUp();
+    }
     if(m_commandPool != VK_NULL_HANDLE) {
         vkDestroyCommandPool(m_logicalDevice, m_commandPool, nullptr);
     }
@@ -13,6 +13,9 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+
 /**
  * Destructor for the glfw window.
  * Required to store it using smart pointers.
@@ -39,6 +42,8 @@ struct QueueFamilyIndices {
     bool computeAndGraphicsFound = false; /**< True if the physical device supports a queue family suitable for compute and graphics commands */
     uint32_t presentIndex = static_cast<uint32_t>(-1); /**< Index of the queue family used as present queue */
     bool presentFound = false; /**< True if the physical device supports a queue family suitable as a present queue */
+    uint32_t transferIndex = static_cast<uint32_t>(-1); /**< Index of a queue family only supporting transfer commands */
+    bool transferFound = false; /**< True if the physical device has a queue family dedicated to transfers */
 };
 
 /**
@@ -106,6 +111,11 @@ public:
      */
     VkCommandPool getCommandPool();
 
+    /**
+     * Return the upload manager streaming buffer and image contents to the GPU.
+     */
+    std::unique_ptr<UploadManager> &getUploadManager();
+
     /**
      * Return the vulkan handle of the queue used for compute commands.
      */
@@ -121,6 +131,13 @@ public:
      */
     VkQueue getPresentQueue();
 
+    /**
+     * Return the vulkan handle of the queue used for uploads.
+     * 
+     * This is the graphics queue if the physical device has no queue family dedicated to transfers.
+     */
+    VkQueue getTransferQueue();
+
     /**
      * Return the indices of the queue families used by the selected physical device.
      * 
@@ -145,6 +162,16 @@ public:
      */
     VkSampleCountFlagBits getMaxSamples();
 
+    /**
+     * Return the alignment required for offsets of uniform and storage buffer descriptors, including dynamic offsets.
+     */
+    VkDeviceSize getMinBufferOffsetAlignment();
+
+    /**
+     * Return the granularity of flushes of host visible memory that is not coherent.
+     */
+    VkDeviceSize getNonCoherentAtomSize();
+
     /**
      * Look up the address of a vulkan extension function.
      * 
@@ -175,6 +202,16 @@ public:
      */
     VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
+    /**
+     * Check wether an image format supports a set of features on the selected physical device.
+     * 
+     * @param format image format to check
+     * @param tiling arrangement of texel blocks the features are required for
+     * @param features bitmask of features the format capabilities have to match
+     * @return true if all features are supported
+     */
+    bool hasFormatFeatures(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features);
+
     /**
      * Create a temporary command buffer for one-off GPU operations.
      * 
@@ -193,16 +230,48 @@ public:
      */
     void endSingleCommand(VkCommandBuffer commandBuffer);
 
+    /**
+     * Reserve device memory for a buffer or image inside one of the memory allocator's blocks.
+     * 
+     * The resource has to be bound to allocation.memory at allocation.offset.
+     * If the memory is host visible allocation.mapped points to the range, it must not be mapped again.
+     * 
+     * @param requirements size, alignment, and memory types required by the resource
+     * @param properties properties the allocated memory has to fulfil
+     * @param type kind of resource the memory is bound to
+     * @param[out] allocation reference to the variable the memory range will be stored in
+     */
+    void allocateMemory(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, AllocationType type, MemoryAllocation &allocation);
+
+    /**
+     * Return memory reserved by allocateMemory or createBuffer to the memory allocator.
+     * 
+     * @param allocation memory range to free, reset to an empty allocation
+     */
+    void freeMemory(MemoryAllocation &allocation);
+
+    /**
+     * Return the number of blocks and allocations as well as the usage and fragmentation of the device memory.
+     */
+    MemoryStatistics getMemoryStatistics();
+
+    /**
+     * Print the memory statistics of each memory type.
+     */
+    void printMemoryStatistics();
+
     /**
      * Create a vulkan buffer and allocate and bind buffer memory.
      * 
+     * The memory is a range inside a larger block and has to be released with freeMemory.
+     * 
      * @param size memory size allocated for the buffer
      * @param usage vulkan flags indicating the purpose of the buffer
      * @param properties properties the allocated memory has to fulfil
      * @param[out] buffer reference to the variable the buffer handle will be stored in
      * @param[out] bufferMemory reference to the variable the buffer memory be stored in
      */
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory);
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, MemoryAllocation &bufferMemory);
 
     /**
      * Copy the contents of one buffer into another one.
@@ -216,7 +285,7 @@ public:
     /**
      * Destroy all vulkan components.
      * 
-     * Command pool, logical device, surface, debug messenger and instance are destroyed in reverse order of creation.
+     * Memory blocks, command pool, logical device, surface, debug messenger and instance are destroyed in reverse order of creation.
      */
     void cleanUp();
 
@@ -248,6 +317,8 @@ private:
      * Find queue families suitable for compute, graphics, and present queue.
      * Rendering and compute use the same queue to keep synchronization simple.
      * Present is handled by a separate queue.
+     * A family supporting transfers but neither graphics nor compute is used for uploads if available,
+     * as long as it can copy single texels of images.
      * 
      * @param device physical device checked for queue family support
      * @return struct containing the queue family indices if found
@@ -307,11 +378,17 @@ private:
     VkQueue m_computeQueue = VK_NULL_HANDLE; /**< Vulkan queue used for compute commands */
     VkQueue m_graphicsQueue = VK_NULL_HANDLE; /**< Vulkan queue used for graphics commands */
     VkQueue m_presentQueue = VK_NULL_HANDLE; /**< Vulkan present queue */
+    VkQueue m_transferQueue = VK_NULL_HANDLE; /**< Vulkan queue used for uploads, the graphics queue if there is no dedicated transfer queue family */
 
     VkCommandPool m_commandPool = VK_NULL_HANDLE; /**< Pool to allocate vulkan commands from. */
 
+    std::unique_ptr<MemoryAllocator> m_memoryAllocator = nullptr; /**< Places buffers and images in large blocks of device memory */
+    std::unique_ptr<UploadManager> m_uploadManager = nullptr; /**< Batches the staging copies of all uploads */
+
     float m_maxSamplerAnisotropy = 0.0f; /**< Maximum number of samples used when sampling a texture */
     VkSampleCountFlagBits m_maxSamples = VK_SAMPLE_COUNT_1_BIT; /**< Maximum number of framebuffer samples (e.g. for MSAA) */
+    VkDeviceSize m_minBufferOffsetAlignment = 1; /**< Alignment satisfying the offset limits of both uniform and storage buffers */
+    VkDeviceSize m_nonCoherentAtomSize = 1; /**< Size and alignment of ranges of non-coherent memory that are flushed */
     float m_timeStampPeriod = 0.0f; /**< Number of nanoseconds required for a timestamp to be incremented by 1 */
 };
 
@@ -1,7 +1,7 @@
 #include "DescriptorSet.h"
 
-DescriptorSet::DescriptorSet(std::shared_ptr<Context> &context, uint32_t numFramesInFlight)
-: m_context(context), m_numFramesInFlight(numFramesInFlight) {
+DescriptorSet::DescriptorSet(std::shared_ptr<Context> &context, uint32_t numFramesInFlight, std::shared_ptr<FrameAllocator> frameAllocator)
+: m_context(context), m_numFramesInFlight(numFramesInFlight), m_frameAllocator(frameAllocator) {
 
 }
 
@@ -17,6 +17,22 @@ VkDescriptorSet DescriptorSet::getSet(uint32_t frameIndex) {
     return m_sets[frameIndex];
 }
 
+bool DescriptorSet::hasDynamicOffsets() {
+    return m_numDynamicOffsets > 0;
+}
+
+void DescriptorSet::getDynamicOffsets(uint32_t frameIndex, std::vector<uint32_t> &offsets) {
+    for(auto &descriptor : m_descriptors) {
+        if(descriptor.dynamicOffsets.empty()) {
+            continue;
+        }
+        //as with buffers, the first of two bindings refers to the data of the previous frame
+        for(uint32_t b=0; b<descriptor.numBindings; b++) {
+            offsets.emplace_back(descriptor.dynamicOffsets[(frameIndex + m_numFramesInFlight - (descriptor.numBindings-1-b)) % m_numFramesInFlight]);
+        }
+    }
+}
+
 void DescriptorSet::addBuffer(std::string name, VkDescriptorType descriptorType, VkDeviceSize bufferSize, bool doubleBinding, const void *data) {
     m_descriptors.resize(m_numDescriptors + 1);
     auto &descriptor = m_descriptors[m_numDescriptors];
@@ -33,6 +49,27 @@ void DescriptorSet::addBuffer(std::string name, VkDescriptorType descriptorType,
 
     descriptor.name = name;
     descriptor.type = descriptorType;
+    descriptor.bufferSize = bufferSize;
+
+    //uniforms are rewritten every frame, so they are bump allocated from the frame allocator instead of getting buffers of their own
+    if(descriptor.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && m_frameAllocator != nullptr) {
+        descriptor.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    }
+    if(descriptor.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || descriptor.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC) {
+        if(m_frameAllocator == nullptr) {
+            throw std::runtime_error("DESCRIPTOR SET ERROR: Transient buffer " + name + " requires a frame allocator");
+        }
+        if(bufferSize > m_frameAllocator->getFrameSize() || data != nullptr) {
+            throw std::runtime_error("DESCRIPTOR SET ERROR: Transient buffer " + name + " cannot be larger than a frame or have initial data");
+        }
+        descriptor.dynamicOffsets.resize(m_numFramesInFlight, 0);
+
+        m_numBufferBindings += descriptor.numBindings;
+        m_numDynamicOffsets += descriptor.numBindings;
+        m_numDescriptors++;
+        return;
+    }
+
     VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
     VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
     if(descriptor.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
@@ -41,7 +78,6 @@ void DescriptorSet::addBuffer(std::string name, VkDescriptorType descriptorType,
     }
 
     //create buffers
-    descriptor.bufferSize = bufferSize;
     descriptor.buffers.resize(m_numFramesInFlight);
     descriptor.memory.resize(m_numFramesInFlight);
     if(descriptor.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
@@ -52,30 +88,24 @@ void DescriptorSet::addBuffer(std::string name, VkDescriptorType descriptorType,
             descriptor.bufferSize, usage, properties,
             descriptor.buffers[frame], descriptor.memory[frame]);
         if(descriptor.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
-            vkMapMemory(
-                m_context->getDevice(), descriptor.memory[frame],
-                0, descriptor.bufferSize, 0,
-                &descriptor.buffersMapped[frame]);
+            descriptor.buffersMapped[frame] = descriptor.memory[frame].mapped;
         }
     }
 
     //copy data to buffers if provided
     if(descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER && data != nullptr) {
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-
-        m_context->createBuffer(descriptor.bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-        void* bufferData;
-        vkMapMemory(m_context->getDevice(), stagingBufferMemory, 0, descriptor.bufferSize, 0, &bufferData);
-        memcpy(bufferData, data, (size_t)descriptor.bufferSize);
-        vkUnmapMemory(m_context->getDevice(), stagingBufferMemory);
-
+        //the data is staged once and copied into the buffer of each frame
+        auto &uploads = m_context->getUploadManager();
+        auto staging = uploads->stage(descriptor.bufferSize);
+        memcpy(staging.data, data, (size_t)descriptor.bufferSize);
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = staging.offset;
+        copyRegion.size = descriptor.bufferSize;
         for(uint32_t f=0; f<m_numFramesInFlight; f++) {
-            m_context->copyBuffer(stagingBuffer, descriptor.buffers[f], descriptor.bufferSize);
+            vkCmdCopyBuffer(uploads->getCommandBuffer(), staging.buffer, descriptor.buffers[f], 1, &copyRegion);
+            uploads->releaseBuffer(descriptor.buffers[f]);
         }
-
-        vkDestroyBuffer(m_context->getDevice(), stagingBuffer, nullptr);
-        vkFreeMemory(m_context->getDevice(), stagingBufferMemory, nullptr);
     }
 
     m_numBufferBindings += descriptor.numBindings;
@@ -120,7 +150,7 @@ void DescriptorSet::addImage(VkDescriptorType descriptorType, VkImageView imageV
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.mipLodBias = 0.0f;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = 0.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
         if(vkCreateSampler(m_context->getDevice(), &samplerInfo, nullptr, &m_imageSampler)) {
             throw std::runtime_error("RENDERER ERROR: Could not create image sampler");
         }
@@ -167,7 +197,7 @@ void DescriptorSet::addImages(VkDescriptorType descriptorType, std::vector<VkIma
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.mipLodBias = 0.0f;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = 0.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
         if(vkCreateSampler(m_context->getDevice(), &samplerInfo, nullptr, &m_imageSampler)) {
             throw std::runtime_error("RENDERER ERROR: Could not create image sampler");
         }
@@ -274,7 +304,10 @@ void DescriptorSet::createSets() {
         for(auto &descriptor : m_descriptors) {
             for(uint32_t b=0; b<descriptor.numBindings; b++) {
                 writes[descriptor.firstBinding + b].dstSet = m_sets[frame];
-                if(descriptor.numImages == 0) {
+                if(descriptor.numImages == 0 && !descriptor.dynamicOffsets.empty()) {
+                    bufferInfos[bufferIndex].buffer = m_frameAllocator->getBuffer();
+                    bufferIndex++;
+                } else if(descriptor.numImages == 0) {
                     bufferInfos[bufferIndex].buffer = descriptor.buffers[(frame + m_numFramesInFlight - (descriptor.numBindings-1-b)) % m_numFramesInFlight];
                     bufferIndex++;
                 }
@@ -289,8 +322,15 @@ void DescriptorSet::createSets() {
 void DescriptorSet::updateBuffer(std::string name, uint32_t frameIndex, void* data) {
     uint32_t descriptorIndex = 0;
     while(descriptorIndex < m_numDescriptors) {
-        if(m_descriptors[descriptorIndex].name == name) {
-            memcpy(m_descriptors[descriptorIndex].buffersMapped[frameIndex], data, m_descriptors[descriptorIndex].bufferSize);
+        auto &descriptor = m_descriptors[descriptorIndex];
+        if(descriptor.name == name && !descriptor.dynamicOffsets.empty()) {
+            auto allocation = m_frameAllocator->allocate(descriptor.bufferSize);
+            memcpy(allocation.data, data, descriptor.bufferSize);
+            descriptor.dynamicOffsets[frameIndex] = allocation.offset;
+            return;
+        }
+        if(descriptor.name == name) {
+            memcpy(descriptor.buffersMapped[frameIndex], data, descriptor.bufferSize);
             return;
         }
         descriptorIndex++;
@@ -301,6 +341,9 @@ void DescriptorSet::updateBuffer(std::string name, uint32_t frameIndex, void* da
 void DescriptorSet::clearBuffer(std::string name, VkCommandBuffer commandBuffer, uint32_t frameIndex) {
     uint32_t descriptorIndex = 0;
     while(descriptorIndex < m_numDescriptors) {
+        if(m_descriptors[descriptorIndex].name == name && !m_descriptors[descriptorIndex].dynamicOffsets.empty()) {
+            throw std::runtime_error("DESCRIPTOR SET ERROR: Transient buffer " + name + " cannot be cleared");
+        }
         if(m_descriptors[descriptorIndex].name == name) {
             vkCmdFillBuffer(commandBuffer, m_descriptors[descriptorIndex].buffers[frameIndex], 0, m_descriptors[descriptorIndex].bufferSize, 0);
             return;
@@ -313,6 +356,9 @@ void DescriptorSet::clearBuffer(std::string name, VkCommandBuffer commandBuffer,
 void DescriptorSet::copyBufferFromLastFrame(std::string name, uint32_t frameIndex) {
     uint32_t descriptorIndex = 0;
     while(descriptorIndex < m_numDescriptors) {
+        if(m_descriptors[descriptorIndex].name == name && !m_descriptors[descriptorIndex].dynamicOffsets.empty()) {
+            throw std::runtime_error("DESCRIPTOR SET ERROR: Transient buffer " + name + " cannot be copied");
+        }
         if(m_descriptors[descriptorIndex].name == name) {
             auto lastFrame = (frameIndex + (m_numFramesInFlight - 1)) % m_numFramesInFlight;
             m_context->copyBuffer(m_descriptors[descriptorIndex].buffers[lastFrame], m_descriptors[descriptorIndex].buffers[frameIndex], m_descriptors[descriptorIndex].bufferSize);
@@ -331,8 +377,8 @@ void DescriptorSet::cleanUp() {
         for(auto buffer : descriptor.buffers) {
             vkDestroyBuffer(m_context->getDevice(), buffer, nullptr);
         }
-        for(auto bufferMemory : descriptor.memory) {
-            vkFreeMemory(m_context->getDevice(), bufferMemory, nullptr);
+        for(auto &bufferMemory : descriptor.memory) {
+            m_context->freeMemory(bufferMemory);
         }
     }
 
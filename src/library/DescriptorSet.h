@@ -4,12 +4,14 @@
 #include <glm/glm.hpp>
 
 #include "Context.h"
+#include "FrameAllocator.h"
 
 /**
  * Vulkan representation of an individual shader resource.
  * 
  * The resource can either be a buffer or an image.
- * If it is a buffer numImages is 0 and type is either VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER or VK_DESCRIPTOR_TYPE_STORAGE_BUFFER.
+ * If it is a buffer numImages is 0 and type is VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, or one of their dynamic variants.
+ * Buffers of a dynamic type are transient, their data lives in the frame allocator and is located by a dynamic offset.
  * If it is an image bufferSize is 0 and type is either VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER or VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT.
  * A resource can have more than one binding in the descriptor set layout, e.g. to access data associated with the preceding frame in flight.
  */
@@ -22,8 +24,9 @@ struct Descriptor {
     
     VkDeviceSize bufferSize = 0; /**< Size of the uniform or storage buffer */
     std::vector<VkBuffer> buffers; /**< Vulkan handles of the buffers for each frame in flight */
-    std::vector<VkDeviceMemory> memory; /**< Memory containing the buffer data */
-    std::vector<void*> buffersMapped; /**< Pointers the buffers are mapped to (persistent mapping) */
+    std::vector<MemoryAllocation> memory; /**< Memory ranges containing the buffer data */
+    std::vector<void*> buffersMapped; /**< Pointers the buffers are mapped to (persistent mapping of the memory blocks) */
+    std::vector<uint32_t> dynamicOffsets; /**< Offsets of the data in the frame allocator for each frame in flight, only used by transient buffers */
 
     uint32_t numImages = 0; /**<  */
     std::vector<VkImageView> imageViews; /**< Image views the descriptor points to */
@@ -43,10 +46,13 @@ public:
      * A new smart pointer to the vulkan context is stored for later use.
      * Layout and descriptor sets cannot be accessed until init has been called.
      * 
+     * Uniform buffers are placed in the frame allocator if one is given.
+     * 
      * @param context pointer to the vulkan context
      * @param numFramesInFlight number of images alternated in the swap chain
+     * @param frameAllocator optional allocator for buffers whose data is rewritten every frame
      */
-    DescriptorSet(std::shared_ptr<Context> &context, uint32_t numFramesInFlight);
+    DescriptorSet(std::shared_ptr<Context> &context, uint32_t numFramesInFlight, std::shared_ptr<FrameAllocator> frameAllocator = nullptr);
     ~DescriptorSet();
 
     /**
@@ -61,17 +67,34 @@ public:
      */
     VkDescriptorSet getSet(uint32_t frameIndex);
 
+    /**
+     * Check whether the set contains transient buffers that need dynamic offsets when it is bound.
+     */
+    bool hasDynamicOffsets();
+
+    /**
+     * Append the dynamic offsets of all transient buffers in the order of their bindings.
+     * 
+     * @param frameIndex index of the current frame in flight
+     * @param[out] offsets list the offsets are appended to, passed to vkCmdBindDescriptorSets
+     */
+    void getDynamicOffsets(uint32_t frameIndex, std::vector<uint32_t> &offsets);
+
     /**
      * Add a buffer resource to the descriptor set.
      * 
      * A new buffer with the specified size is created for each frame in flight.
      * If data is provided it is copied into each of the buffers.
      * 
+     * Uniform buffers of a set with a frame allocator, and buffers of type VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+     * or VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, are transient instead and get no buffers of their own.
+     * Their data is allocated from the frame allocator by updateBuffer, so they have to be updated in every frame they are used in.
+     * 
      * If doubleBinding is true the descriptor is initialized with two bindings in the descriptor set layout.
      * And in the descriptor set itself the first binding refers to the buffer associated with the previous frame in flight.
      * 
      * @param name unique name identifying the resource for later access
-     * @param descriptorType type distinguishing between VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER and VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+     * @param descriptorType type distinguishing between VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER and VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, or their dynamic variants
      * @param bufferSize size of the new buffer
      * @param doubleBinding if true an additional binding is added for the previous frame
      * @param data initial buffer data
@@ -109,6 +132,8 @@ public:
     /**
      * Modify the data in one of the buffers.
      * 
+     * The data of transient buffers is written to a new allocation in the current frame of the frame allocator.
+     * 
      * @param name unique name identifying the resource
      * @param frameIndex index of the current frame in flight
      * @param data new data copied into the buffer
@@ -167,6 +192,8 @@ private:
     uint32_t m_numBufferBindings = 0; /**< Total number of buffer bindings in the descriptor set layout */
     uint32_t m_numImageBindings = 0; /**< Total number of image bindings in the descriptor set layout */
     uint32_t m_numImages = 0; /**< Total number of image views added to the descriptor set */
+    uint32_t m_numDynamicOffsets = 0; /**< Total number of bindings of transient buffers */
+    std::shared_ptr<FrameAllocator> m_frameAllocator; /**< Allocator containing the data of transient buffers */
 
     VkDescriptorSetLayout m_layout = VK_NULL_HANDLE; /**< Vulkan handle of the descriptor set layout */
     VkDescriptorPool m_pool = VK_NULL_HANDLE; /**< Vulkan handle of the descriptor pool the sets are allocated from */
@@ -0,0 +1,82 @@
+#include "FrameAllocator.h"
+
+#include <algorithm>
+
+FrameAllocator::FrameAllocator(std::shared_ptr<Context> &context, uint32_t numFramesInFlight, VkDeviceSize frameSize)
+: m_context(context), m_numFramesInFlight(numFramesInFlight) {
+    m_alignment = m_context->getMinBufferOffsetAlignment();
+    m_atomSize = m_context->getNonCoherentAtomSize();
+
+    //regions start at multiples of both alignments, so each one can be flushed on its own
+    VkDeviceSize regionAlignment = std::max(m_alignment, m_atomSize);
+    m_frameSize = (frameSize + regionAlignment - 1) / regionAlignment * regionAlignment;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = m_frameSize * m_numFramesInFlight;
+    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if(vkCreateBuffer(m_context->getDevice(), &bufferInfo, nullptr, &m_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("FRAME ALLOCATOR ERROR: Could not create buffer.");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(m_context->getDevice(), m_buffer, &memoryRequirements);
+    memoryRequirements.alignment = std::max(memoryRequirements.alignment, regionAlignment);
+    m_context->allocateMemory(memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, bufferAllocation, m_memory);
+    vkBindBufferMemory(m_context->getDevice(), m_buffer, m_memory.memory, m_memory.offset);
+}
+
+FrameAllocator::~FrameAllocator() {
+    m_context = nullptr;
+}
+
+VkBuffer FrameAllocator::getBuffer() {
+    return m_buffer;
+}
+
+VkDeviceSize FrameAllocator::getFrameSize() {
+    return m_frameSize;
+}
+
+void FrameAllocator::beginFrame(uint32_t frameIndex) {
+    m_frameIndex = frameIndex % m_numFramesInFlight;
+    m_head = 0;
+    m_flushed = 0;
+}
+
+FrameAllocation FrameAllocator::allocate(VkDeviceSize size) {
+    VkDeviceSize offset = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+    if(offset + size > m_frameSize) {
+        throw std::runtime_error("FRAME ALLOCATOR ERROR: Transient data of the current frame exceeds " + std::to_string(m_frameSize) + " bytes.");
+    }
+    m_head = offset + size;
+
+    FrameAllocation allocation;
+    allocation.offset = static_cast<uint32_t>(m_frameIndex * m_frameSize + offset);
+    allocation.data = static_cast<unsigned char*>(m_memory.mapped) + allocation.offset;
+    return allocation;
+}
+
+void FrameAllocator::flush() {
+    if(m_head <= m_flushed) {
+        return;
+    }
+
+    //a single range covers everything written since the last flush, rounded to whole atoms inside the region
+    VkDeviceSize start = m_flushed / m_atomSize * m_atomSize;
+    VkDeviceSize end = std::min((m_head + m_atomSize - 1) / m_atomSize * m_atomSize, m_frameSize);
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = m_memory.memory;
+    range.offset = m_memory.offset + m_frameIndex * m_frameSize + start;
+    range.size = end - start;
+    vkFlushMappedMemoryRanges(m_context->getDevice(), 1, &range);
+    m_flushed = m_head;
+}
+
+void FrameAllocator::cleanUp() {
+    vkDestroyBuffer(m_context->getDevice(), m_buffer, nullptr);
+    m_context->freeMemory(m_memory);
+    m_buffer = VK_NULL_HANDLE;
+}
\ No newline at end of file
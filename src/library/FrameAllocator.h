@@ -0,0 +1,96 @@
+#ifndef SLBVULKAN_FRAMEALLOCATOR_H
+#define SLBVULKAN_FRAMEALLOCATOR_H
+
+#include "Context.h"
+
+/** Bytes of transient data that can be allocated in each frame in flight */
+const VkDeviceSize frameAllocatorSize = 4 * 1024 * 1024;
+
+/**
+ * Range of the frame allocator buffer holding transient data of the current frame.
+ */
+struct FrameAllocation {
+    void *data = nullptr; /**< Host address the data is written to */
+    uint32_t offset = 0; /**< Position in the buffer, used as dynamic offset when binding descriptor sets */
+};
+
+/**
+ * Linear allocator for data that is rewritten every frame, like uniforms.
+ *
+ * A single persistently mapped buffer is split into one region per frame in flight.
+ * Allocations are bump allocated from the region of the current frame, which is reset by beginFrame.
+ * Shaders access the data through descriptors of type VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC or
+ * VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC pointing at the buffer, with the offsets of the allocations passed as dynamic offsets.
+ * The memory does not have to be coherent, the written range is flushed once per frame.
+ */
+class FrameAllocator {
+public:
+    /**
+     * Create and map the buffer.
+     *
+     * A new smart pointer to the vulkan context is stored for later use.
+     *
+     * @param context pointer to the vulkan context
+     * @param numFramesInFlight number of images alternated in the swap chain
+     * @param frameSize bytes available in each frame
+     */
+    FrameAllocator(std::shared_ptr<Context> &context, uint32_t numFramesInFlight, VkDeviceSize frameSize = frameAllocatorSize);
+    ~FrameAllocator();
+
+    /**
+     * Return the vulkan handle of the buffer all allocations are placed in.
+     */
+    VkBuffer getBuffer();
+
+    /**
+     * Return the number of bytes available in each frame.
+     */
+    VkDeviceSize getFrameSize();
+
+    /**
+     * Start allocating from the region of a frame in flight, discarding its previous allocations.
+     *
+     * The GPU must have finished the last frame that used the region, e.g. by waiting for its in flight fence.
+     *
+     * @param frameIndex index of the current frame in flight
+     */
+    void beginFrame(uint32_t frameIndex);
+
+    /**
+     * Reserve memory in the region of the current frame.
+     *
+     * The offset is aligned for uniform and storage buffer descriptors.
+     *
+     * @param size number of bytes to allocate
+     * @return host address and buffer offset of the allocation
+     */
+    FrameAllocation allocate(VkDeviceSize size);
+
+    /**
+     * Make the data written in the current frame available to the GPU.
+     *
+     * Has to be called after the last allocation of the frame has been written and before the frame is submitted.
+     */
+    void flush();
+
+    /**
+     * Destroy the buffer and free its memory.
+     */
+    void cleanUp();
+
+private:
+    std::shared_ptr<Context> m_context; /**< Pointer to the vulkan context */
+    uint32_t m_numFramesInFlight; /**< Number of regions the buffer is split into */
+    VkDeviceSize m_frameSize; /**< Size of each region in bytes */
+    VkDeviceSize m_alignment = 1; /**< Alignment of all allocations, suitable as dynamic offset for uniform and storage buffers */
+    VkDeviceSize m_atomSize = 1; /**< Granularity of flushes of mapped memory */
+
+    VkBuffer m_buffer = VK_NULL_HANDLE; /**< Vulkan handle of the buffer */
+    MemoryAllocation m_memory; /**< Persistently mapped memory of the buffer */
+
+    uint32_t m_frameIndex = 0; /**< Frame in flight the region currently allocated from belongs to */
+    VkDeviceSize m_head = 0; /**< Bytes allocated in the region of the current frame */
+    VkDeviceSize m_flushed = 0; /**< Bytes of the current region that have already been flushed */
+};
+
+#endif //SLBVULKAN_FRAMEALLOCATOR_H
\ No newline at end of file
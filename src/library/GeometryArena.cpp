@@ -0,0 +1,167 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+
+void GeometryArena::addMesh(const std::shared_ptr<Mesh> &mesh) {
+    if(m_hasBuffers) {
+        throw std::runtime_error("GEOMETRY ARENA ERROR: Buffers have already been created.");
+    }
+    if(mesh->hasBuffers()) {
+        throw std::runtime_error("GEOMETRY ARENA ERROR: Mesh has already been uploaded.");
+    }
+    if(!m_addedMeshes.insert(mesh.get()).second) {
+        return;
+    }
+
+    //indices are relative to the first vertex of their mesh, so each mesh gets the smallest width its vertices allow
+    m_meshes.emplace_back(mesh);
+    m_firstVertices.emplace_back(m_numVertices);
+    m_numVertices += mesh->getNumVertices();
+    if(mesh->getNumVertices() <= static_cast<uint32_t>(std::numeric_limits<uint16_t>::max()) + 1) {
+        m_indexTypes.emplace_back(VK_INDEX_TYPE_UINT16);
+        m_firstIndices.emplace_back(m_numShortIndices);
+        m_numShortIndices += mesh->getNumIndices();
+    } else {
+        m_indexTypes.emplace_back(VK_INDEX_TYPE_UINT32);
+        m_firstIndices.emplace_back(m_numIndices);
+        m_numIndices += mesh->getNumIndices();
+    }
+}
+
+bool GeometryArena::hasBuffers() {
+    return m_hasBuffers;
+}
+
+uint32_t GeometryArena::getNumVertices() {
+    return m_numVertices;
+}
+
+uint32_t GeometryArena::getNumIndices() {
+    return m_numShortIndices + m_numIndices;
+}
+
+void GeometryArena::createBuffers(std::shared_ptr<Context> &context) {
+    if(m_hasBuffers) {
+        throw std::runtime_error("GEOMETRY ARENA ERROR: Buffers have already been created.");
+    }
+    if(m_numVertices == 0 || getNumIndices() == 0) {
+        return;
+    }
+
+    //the strides of both streams follow the vertex format shared by all meshes
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    Mesh::getVertexInput(true, bindings, attributes);
+    auto vertexStride = static_cast<VkDeviceSize>(bindings[0].stride);
+    auto attributeStride = static_cast<VkDeviceSize>(bindings.size() > 1 ? bindings[1].stride : 0);
+
+    //vertices, attributes, and both kinds of indices of all meshes are written into one staging range one after another
+    VkDeviceSize vertexSize = m_numVertices * vertexStride;
+    VkDeviceSize attributeSize = m_numVertices * attributeStride;
+    VkDeviceSize shortIndexSize = m_numShortIndices * sizeof(uint16_t);
+    VkDeviceSize indexSize = m_numIndices * sizeof(uint32_t);
+    auto &uploads = context->getUploadManager();
+    auto staging = uploads->stage(vertexSize + attributeSize + shortIndexSize + indexSize);
+    for(size_t m=0; m<m_meshes.size(); m++) {
+        auto indices = m_indexTypes[m] == VK_INDEX_TYPE_UINT16
+            ? staging.data + vertexSize + attributeSize + m_firstIndices[m] * sizeof(uint16_t)
+            : staging.data + vertexSize + attributeSize + shortIndexSize + m_firstIndices[m] * sizeof(uint32_t);
+        m_meshes[m]->writeGeometry(
+            staging.data + m_firstVertices[m] * vertexStride,
+            staging.data + vertexSize + m_firstVertices[m] * attributeStride,
+            indices,
+            m_indexTypes[m]);
+    }
+
+    context->createBuffer(vertexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertexBuffer, m_vertexMemory);
+    if(attributeSize > 0) {
+        context->createBuffer(attributeSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_attributeBuffer, m_attributeMemory);
+    }
+    if(shortIndexSize > 0) {
+        context->createBuffer(shortIndexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_shortIndexBuffer, m_shortIndexMemory);
+    }
+    if(indexSize > 0) {
+        context->createBuffer(indexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indexBuffer, m_indexMemory);
+    }
+
+    VkCommandBuffer commandBuffer = uploads->getCommandBuffer();
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = staging.offset;
+    copyRegion.size = vertexSize;
+    vkCmdCopyBuffer(commandBuffer, staging.buffer, m_vertexBuffer, 1, &copyRegion);
+    if(attributeSize > 0) {
+        copyRegion.srcOffset = staging.offset + vertexSize;
+        copyRegion.size = attributeSize;
+        vkCmdCopyBuffer(commandBuffer, staging.buffer, m_attributeBuffer, 1, &copyRegion);
+    }
+    if(shortIndexSize > 0) {
+        copyRegion.srcOffset = staging.offset + vertexSize + attributeSize;
+        copyRegion.size = shortIndexSize;
+        vkCmdCopyBuffer(commandBuffer, staging.buffer, m_shortIndexBuffer, 1, &copyRegion);
+    }
+    if(indexSize > 0) {
+        copyRegion.srcOffset = staging.offset + vertexSize + attributeSize + shortIndexSize;
+        copyRegion.size = indexSize;
+        vkCmdCopyBuffer(commandBuffer, staging.buffer, m_indexBuffer, 1, &copyRegion);
+    }
+
+    uploads->releaseBuffer(m_vertexBuffer);
+    if(attributeSize > 0) {
+        uploads->releaseBuffer(m_attributeBuffer);
+    }
+    if(shortIndexSize > 0) {
+        uploads->releaseBuffer(m_shortIndexBuffer);
+    }
+    if(indexSize > 0) {
+        uploads->releaseBuffer(m_indexBuffer);
+    }
+
+    for(size_t m=0; m<m_meshes.size(); m++) {
+        m_meshes[m]->createBuffers(context, m_firstVertices[m], m_firstIndices[m], m_indexTypes[m]);
+    }
+    m_hasBuffers = true;
+}
+
+void GeometryArena::bind(VkCommandBuffer commandBuffer, bool bindAttributes) {
+    if(!m_hasBuffers) {
+        return;
+    }
+    VkDeviceSize offsets[] = {0, 0};
+    VkBuffer vertexBuffers[] = {m_vertexBuffer, m_attributeBuffer};
+    uint32_t numBindings = m_attributeBuffer != VK_NULL_HANDLE && bindAttributes ? 2 : 1;
+    vkCmdBindVertexBuffers(commandBuffer, 0, numBindings, vertexBuffers, offsets);
+}
+
+bool GeometryArena::bindIndices(VkCommandBuffer commandBuffer, VkIndexType indexType) {
+    VkBuffer indexBuffer = indexType == VK_INDEX_TYPE_UINT16 ? m_shortIndexBuffer : m_indexBuffer;
+    if(!m_hasBuffers || indexBuffer == VK_NULL_HANDLE) {
+        return false;
+    }
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+    return true;
+}
+
+void GeometryArena::cleanUp(std::shared_ptr<Context> &context) {
+    vkDestroyBuffer(context->getDevice(), m_vertexBuffer, nullptr);
+    context->freeMemory(m_vertexMemory);
+    vkDestroyBuffer(context->getDevice(), m_attributeBuffer, nullptr);
+    context->freeMemory(m_attributeMemory);
+    vkDestroyBuffer(context->getDevice(), m_shortIndexBuffer, nullptr);
+    context->freeMemory(m_shortIndexMemory);
+    vkDestroyBuffer(context->getDevice(), m_indexBuffer, nullptr);
+    context->freeMemory(m_indexMemory);
+
+    m_vertexBuffer = VK_NULL_HANDLE;
+    m_attributeBuffer = VK_NULL_HANDLE;
+    m_shortIndexBuffer = VK_NULL_HANDLE;
+    m_indexBuffer = VK_NULL_HANDLE;
+    m_meshes.clear();
+    m_addedMeshes.clear();
+    m_firstVertices.clear();
+    m_firstIndices.clear();
+    m_indexTypes.clear();
+    m_numVertices = 0;
+    m_numShortIndices = 0;
+    m_numIndices = 0;
+    m_hasBuffers = false;
+}
\ No newline at end of file
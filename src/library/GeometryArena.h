@@ -0,0 +1,113 @@
+#ifndef SLBVULKAN_GEOMETRYARENA_H
+#define SLBVULKAN_GEOMETRYARENA_H
+
+#include <set>
+
+#include "Mesh.h"
+
+/**
+ * Shared vertex and index buffers containing the geometry of many meshes.
+ *
+ * Each mesh gets a range of vertices and a range of indices inside the buffers.
+ * The buffers are bound once and each mesh is drawn with its own firstIndex and vertexOffset,
+ * so draws of different meshes can be recorded without rebinding or be combined into indirect draws.
+ * All meshes are written into a single staging range and copied with one command per buffer.
+ * Indices of meshes with no more than 65536 vertices are stored with 16 bits, those of larger meshes with 32 bits.
+ * The two widths live in separate index buffers, so draws are grouped by the index buffer they read from.
+ */
+class GeometryArena {
+public:
+    GeometryArena() = default;
+    ~GeometryArena() = default;
+
+    /**
+     * Reserve ranges for the vertices and indices of a mesh.
+     *
+     * Meshes that have already been added are skipped, so meshes shared by several scene nodes are stored once.
+     * The geometry of the mesh must not change until the buffers are created.
+     *
+     * @param mesh pointer to a mesh without buffers
+     */
+    void addMesh(const std::shared_ptr<Mesh> &mesh);
+
+    /**
+     * Return the availability of the arena for rendering.
+     *
+     * @return true if the buffers have been created and initialized
+     */
+    bool hasBuffers();
+
+    /**
+     * Return the total number of vertices of all meshes in the arena.
+     */
+    uint32_t getNumVertices();
+
+    /**
+     * Return the total number of indices of all meshes in the arena.
+     */
+    uint32_t getNumIndices();
+
+    /**
+     * Create and fill the vertex and index buffers and initialize all meshes.
+     *
+     * No meshes can be added after this point.
+     *
+     * @param context pointer to the vulkan context
+     */
+    void createBuffers(std::shared_ptr<Context> &context);
+
+    /**
+     * Bind the vertex buffers before drawing meshes of the arena.
+     *
+     * Does nothing if the buffers have not been created.
+     *
+     * @param commandBuffer graphics command buffer
+     * @param bindAttributes false if the pipeline only reads positions, the attribute stream is then left unbound
+     */
+    void bind(VkCommandBuffer commandBuffer, bool bindAttributes = true);
+
+    /**
+     * Bind the index buffer used by the meshes with the given index type.
+     *
+     * @param commandBuffer graphics command buffer
+     * @param indexType VK_INDEX_TYPE_UINT16 or VK_INDEX_TYPE_UINT32
+     * @return false if no mesh of the arena uses the index type, draws of that type can be skipped
+     */
+    bool bindIndices(VkCommandBuffer commandBuffer, VkIndexType indexType);
+
+    /**
+     * Destroy all vulkan components.
+     *
+     * The meshes are not cleaned up, they may be shared with other owners.
+     *
+     * @param context pointer to the vulkan context
+     */
+    void cleanUp(std::shared_ptr<Context> &context);
+
+private:
+    std::vector<std::shared_ptr<Mesh>> m_meshes; /**< Meshes stored in the arena in the order of their ranges */
+    std::set<Mesh*> m_addedMeshes; /**< Meshes that have already been added */
+    std::vector<uint32_t> m_firstVertices; /**< Position of the first vertex of each mesh in the vertex buffer */
+    std::vector<uint32_t> m_firstIndices; /**< Position of the first index of each mesh in the index buffer of its index type */
+    std::vector<VkIndexType> m_indexTypes; /**< Size of the indices of each mesh */
+    uint32_t m_numVertices = 0; /**< Total number of vertices */
+    uint32_t m_numShortIndices = 0; /**< Number of 16 bit indices */
+    uint32_t m_numIndices = 0; /**< Number of 32 bit indices */
+
+    bool m_hasBuffers = false; /**< Status of the buffers required for rendering */
+
+    VkBuffer m_vertexBuffer = VK_NULL_HANDLE; /**< Vulkan handle of the vertex buffer */
+    MemoryAllocation m_vertexMemory; /**< Memory containing the vertex data */
+
+    VkBuffer m_attributeBuffer = VK_NULL_HANDLE; /**< Vulkan handle of the buffer containing all attributes but the position, only used with split streams */
+    MemoryAllocation m_attributeMemory; /**< Memory containing the attribute data */
+
+    VkBuffer m_shortIndexBuffer = VK_NULL_HANDLE; /**< Vulkan handle of the index buffer with 16 bit indices */
+    MemoryAllocation m_shortIndexMemory; /**< Memory containing the 16 bit indices */
+
+    VkBuffer m_indexBuffer = VK_NULL_HANDLE; /**< Vulkan handle of the index buffer with 32 bit indices */
+    MemoryAllocation m_indexMemory; /**< Memory containing the 32 bit indices */
+
+};
+
+#endif //SLBVULKAN_GEOMETRYARENA_H
\ No newline at end of file
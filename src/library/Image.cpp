@@ -1,4 +1,9 @@
 #include "Image.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -90,7 +95,7 @@ void Image::createAndAllocate(std::shared_ptr<Context> &context, uint32_t numFra
     imageInfo.extent.width = m_width;
     imageInfo.extent.height = m_height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = m_mipLevels;
     imageInfo.arrayLayers = m_numLayers;
     imageInfo.format = m_format;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -100,9 +105,6 @@ void Image::createAndAllocate(std::shared_ptr<Context> &context, uint32_t numFra
     imageInfo.samples = m_useMultisampling ? context->getMaxSamples() : VK_SAMPLE_COUNT_1_BIT;
     imageInfo.flags = 0;
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-
     m_handles.resize(numFrames);
     m_memory.resize(numFrames);
     for(uint32_t f=0; f<numFrames; f++) {
@@ -112,14 +114,9 @@ void Image::createAndAllocate(std::shared_ptr<Context> &context, uint32_t numFra
 
         VkMemoryRequirements memoryRequirements;
         vkGetImageMemoryRequirements(context->getDevice(), m_handles[f], &memoryRequirements);
-        allocInfo.allocationSize = memoryRequirements.size;
-        allocInfo.memoryTypeIndex = context->findMemoryType(memoryRequirements.memoryTypeBits, m_properties);
-
-        if(vkAllocateMemory(context->getDevice(), &allocInfo, nullptr, &m_memory[f]) != VK_SUCCESS) {
-            throw std::runtime_error("CONTEXT ERROR: Could not allocate image memory.");
-        }
+        context->allocateMemory(memoryRequirements, m_properties, imageAllocation, m_memory[f]);
 
-        vkBindImageMemory(context->getDevice(), m_handles[f], m_memory[f], 0);
+        vkBindImageMemory(context->getDevice(), m_handles[f], m_memory[f].memory, m_memory[f].offset);
     }
 }
 
@@ -145,7 +142,7 @@ void Image::createViews(std::shared_ptr<Context> &context) {
     viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
     viewInfo.subresourceRange.aspectMask = m_aspect;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = m_mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = m_numLayers;
 
@@ -161,7 +158,11 @@ void Image::createViews(std::shared_ptr<Context> &context) {
 
 void Image::transitionLayout(std::shared_ptr<Context> &context, VkImageLayout oldLayout, VkImageLayout newLayout) {
     VkCommandBuffer commandBuffer = context->startSingleCommand();
+    recordTransition(commandBuffer, oldLayout, newLayout);
+    context->endSingleCommand(commandBuffer);
+}
 
+void Image::recordTransition(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) {
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.oldLayout = oldLayout;
@@ -170,7 +171,7 @@ void Image::transitionLayout(std::shared_ptr<Context> &context, VkImageLayout ol
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.subresourceRange.aspectMask = m_aspect; //VK_IMAGE_ASPECT_COLOR_BIT
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = m_mipLevels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = m_numLayers;
 
@@ -217,25 +218,27 @@ void Image::transitionLayout(std::shared_ptr<Context> &context, VkImageLayout ol
             1, &barrier
         );
     }
-
-    context->endSingleCommand(commandBuffer);
 }
 
 void Image::copyBuffer(std::shared_ptr<Context> &context, VkBuffer buffer) {
     VkCommandBuffer commandBuffer = context->startSingleCommand();
+    recordCopyBuffer(commandBuffer, buffer);
+    context->endSingleCommand(commandBuffer);
+}
 
+void Image::recordCopyBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t mipLevel) {
     VkBufferImageCopy region{};
-    region.bufferOffset = 0;
+    region.bufferOffset = offset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
 
     region.imageSubresource.aspectMask = m_aspect;
-    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.mipLevel = mipLevel;
     region.imageSubresource.baseArrayLayer = 0;
     region.imageSubresource.layerCount = m_numLayers;
 
     region.imageOffset = {0, 0, 0};
-    region.imageExtent = {m_width, m_height, 1};
+    region.imageExtent = {getMipWidth(mipLevel), getMipHeight(mipLevel), 1};
 
     for(uint32_t f=0; f<m_handles.size(); f++) {
         vkCmdCopyBufferToImage(
@@ -247,53 +250,488 @@ void Image::copyBuffer(std::shared_ptr<Context> &context, VkBuffer buffer) {
             &region
         );
     }
-
-    context->endSingleCommand(commandBuffer);
 }
 
-void Image::loadTexture(std::shared_ptr<Context> &context, const std::string &fileName) {
-    //load file contents
+void Image::decodeTexture(const std::string &fileName, TextureEncoding encoding, uint32_t numEncoderThreads) {
+    //the file is hashed while it is mapped anyway, so identical textures can be detected
+    auto file = std::make_shared<MappedFile>("../resources/textures/" + fileName);
+    m_contentHash = file->computeHash();
+
+    if(fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".ktx2") == 0) {
+        decodeKtx2(file, fileName);
+        return;
+    }
+    std::string cachePath = "../resources/textures/" + fileName + "." + BlockEncoder::getName(encoding) + ".slbtex";
+    if(encoding != rgbaEncoding && loadTextureCache(cachePath)) {
+        return;
+    }
+
+    //stbi_set_flip_vertically_on_load changes global state, so the rows are flipped here instead
     int width, height, numChannels;
-    stbi_set_flip_vertically_on_load(true);
-    stbi_uc* pixels = stbi_load(("../resources/textures/" + fileName).c_str(), &width, &height, &numChannels, STBI_rgb_alpha);
+    stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file->begin()), static_cast<int>(file->getSize()), &width, &height, &numChannels, STBI_rgb_alpha);
     if(!pixels) {
         throw std::runtime_error("IMAGE ERROR: Could not load file " + fileName);
     }
 
+    size_t rowSize = static_cast<size_t>(width) * 4;
+    std::vector<unsigned char> row(rowSize);
+    for(int y=0; y<height/2; y++) {
+        unsigned char *top = pixels + y * rowSize;
+        unsigned char *bottom = pixels + (height - 1 - y) * rowSize;
+        memcpy(row.data(), top, rowSize);
+        memcpy(top, bottom, rowSize);
+        memcpy(bottom, row.data(), rowSize);
+    }
+    m_pixels = std::shared_ptr<const unsigned char>(pixels, stbi_image_free);
+
     //image settings
     m_width = static_cast<uint32_t>(width);
     m_height = static_cast<uint32_t>(height);
     m_format = VK_FORMAT_R8G8B8A8_UNORM;
     m_aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    m_mipLevels = 1;
+    while(std::max(m_width, m_height) >> m_mipLevels) {
+        m_mipLevels++;
+    }
+    m_levelOffsets = {0};
+    m_levelSizes = {static_cast<VkDeviceSize>(m_width) * m_height * 4};
 
-    //write image content to buffer first
-    VkDeviceSize imageSize = width * height * 4;
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    context->createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-    void* data;
-    vkMapMemory(context->getDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(context->getDevice(), stagingBufferMemory);
-    stbi_image_free(pixels);
-
-    //copy buffer to the final image
-    m_usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    m_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if(encoding != rgbaEncoding) {
+        encodeTexture(encoding, numEncoderThreads);
+        writeTextureCache(cachePath);
+    }
+}
+
+uint32_t Image::getNumMipLevels() {
+    return m_mipLevels;
+}
+
+uint64_t Image::getContentHash() {
+    return m_contentHash;
+}
+
+bool Image::hasPixels() {
+    return m_pixels != nullptr;
+}
+
+void Image::uploadTexture(std::shared_ptr<Context> &context) {
+    //write image content to the staging ring first, 16 byte offsets suit optimalBufferCopyOffsetAlignment on common hardware
+    auto &uploads = context->getUploadManager();
+    VkDeviceSize stagingSize = prepareUpload(context);
+    auto staging = uploads->stage(stagingSize, 16);
+    writeStaging(staging.data);
+
+    //copy buffer to the final image, the commands run with the next flush of the upload manager
     createAndAllocate(context);
-    transitionLayout(context, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copyBuffer(context, stagingBuffer);
-    transitionLayout(context, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    recordUpload(uploads, staging.buffer, staging.offset);
     createViews(context);
+}
+
+void Image::uploadTextures(std::shared_ptr<Context> &context, std::vector<std::shared_ptr<Image>> &images) {
+    for(auto &image : images) {
+        image->uploadTexture(context);
+    }
+}
+
+void Image::loadTexture(std::shared_ptr<Context> &context, const std::string &fileName, TextureEncoding encoding) {
+    if(encoding != rgbaEncoding && !context->hasFormatFeatures(BlockEncoder::getFormat(encoding), VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+        encoding = rgbaEncoding;
+    }
+    decodeTexture(fileName, encoding);
+    uploadTexture(context);
+}
+
+VkDeviceSize Image::prepareUpload(std::shared_ptr<Context> &context) {
+    if(!m_pixels) {
+        throw std::runtime_error("IMAGE ERROR: No decoded pixel data to upload");
+    }
+
+    //throws if the device cannot sample the format, e.g. block compressed formats without textureCompressionBC
+    context->findSupportedFormat({m_format}, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+
+    //missing levels are blitted, which requires linear filtering support for the format, otherwise they are computed on the cpu
+    m_usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    m_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    bool generateMips = m_mipLevels > m_levelSizes.size();
+    m_generateMipsOnCpu = generateMips && !context->hasFormatFeatures(m_format, VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+    if(generateMips && !m_generateMipsOnCpu) {
+        m_usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
+    //each level starts at a multiple of 16 bytes, which suits the texel block size of all formats
+    uint32_t numStagedLevels = m_generateMipsOnCpu ? m_mipLevels : static_cast<uint32_t>(m_levelSizes.size());
+    m_stagingOffsets.resize(numStagedLevels);
+    VkDeviceSize stagingSize = 0;
+    for(uint32_t level=0; level<numStagedLevels; level++) {
+        m_stagingOffsets[level] = (stagingSize + 15) / 16 * 16;
+        VkDeviceSize levelSize = level < m_levelSizes.size() ? m_levelSizes[level] : static_cast<VkDeviceSize>(getMipWidth(level)) * getMipHeight(level) * 4;
+        stagingSize = m_stagingOffsets[level] + levelSize;
+    }
+    return stagingSize;
+}
+
+void Image::writeStaging(unsigned char *target) {
+    for(size_t level=0; level<m_levelSizes.size(); level++) {
+        memcpy(target + m_stagingOffsets[level], m_pixels.get() + m_levelOffsets[level], static_cast<size_t>(m_levelSizes[level]));
+    }
+    m_pixels.reset();
+
+    if(m_generateMipsOnCpu) {
+        for(uint32_t level=1; level<m_mipLevels; level++) {
+            downsample(target + m_stagingOffsets[level - 1], getMipWidth(level - 1), getMipHeight(level - 1), target + m_stagingOffsets[level]);
+        }
+    }
+}
+
+void Image::recordUpload(std::unique_ptr<UploadManager> &uploads, VkBuffer buffer, VkDeviceSize offset) {
+    VkCommandBuffer commandBuffer = uploads->getCommandBuffer();
+    recordTransition(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    for(uint32_t level=0; level<m_stagingOffsets.size(); level++) {
+        recordCopyBuffer(commandBuffer, buffer, offset + m_stagingOffsets[level], level);
+    }
+
+    //blits and the final transition are executed on the graphics queue, which may differ from the one of the copies
+    VkImageSubresourceRange range{};
+    range.aspectMask = m_aspect;
+    range.baseMipLevel = 0;
+    range.levelCount = m_mipLevels;
+    range.baseArrayLayer = 0;
+    range.layerCount = m_numLayers;
+    for(auto &handle : m_handles) {
+        uploads->releaseImage(handle, range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    }
+
+    commandBuffer = uploads->getGraphicsCommandBuffer();
+    if(m_stagingOffsets.size() < m_mipLevels) {
+        recordMipBlits(commandBuffer);
+    } else {
+        recordTransition(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+}
+
+void Image::recordMipBlits(VkCommandBuffer commandBuffer) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = m_aspect;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = m_numLayers;
+
+    for(uint32_t f=0; f<m_handles.size(); f++) {
+        barrier.image = m_handles[f];
+
+        for(uint32_t level=1; level<m_mipLevels; level++) {
+            //the previous level has been written and becomes the source of the blit
+            barrier.subresourceRange.baseMipLevel = level - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = {0, 0, 0};
+            blit.srcOffsets[1] = {static_cast<int32_t>(getMipWidth(level - 1)), static_cast<int32_t>(getMipHeight(level - 1)), 1};
+            blit.srcSubresource.aspectMask = m_aspect;
+            blit.srcSubresource.mipLevel = level - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = m_numLayers;
+            blit.dstOffsets[0] = {0, 0, 0};
+            blit.dstOffsets[1] = {static_cast<int32_t>(getMipWidth(level)), static_cast<int32_t>(getMipHeight(level)), 1};
+            blit.dstSubresource.aspectMask = m_aspect;
+            blit.dstSubresource.mipLevel = level;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = m_numLayers;
+            vkCmdBlitImage(
+                commandBuffer,
+                m_handles[f], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                m_handles[f], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &blit,
+                VK_FILTER_LINEAR
+            );
+
+            //the source level is finished
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+
+        //the last level is never read by a blit
+        barrier.subresourceRange.baseMipLevel = m_mipLevels - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
+
+void Image::downsample(const unsigned char *source, uint32_t width, uint32_t height, unsigned char *target) {
+    uint32_t targetWidth = std::max(1u, width / 2);
+    uint32_t targetHeight = std::max(1u, height / 2);
+    //a side of length 1 is not halved, its single texel is used twice instead
+    size_t rowStep = height > 1 ? static_cast<size_t>(width) * 4 : 0;
+
+    for(uint32_t y=0; y<targetHeight; y++) {
+        const unsigned char *top = source + static_cast<size_t>(2 * y) * width * 4;
+        const unsigned char *bottom = top + rowStep;
+        unsigned char *targetRow = target + static_cast<size_t>(y) * targetWidth * 4;
+        if(width == 1) {
+            for(uint32_t c=0; c<4; c++) {
+                targetRow[c] = static_cast<unsigned char>((2 * top[c] + 2 * bottom[c] + 2) / 4);
+            }
+            continue;
+        }
+        //2x2 box filter with rounding, all four channels of a texel are summed at once in two 32 bit words
+        //with 16 bits per channel (SIMD within a register), which leaves enough room for the carry
+        const uint32_t mask = 0x00FF00FF;
+        const uint32_t rounding = 0x00020002;
+        for(uint32_t x=0; x<targetWidth; x++) {
+            uint32_t texels[4];
+            memcpy(&texels[0], top + 8 * x, 8);
+            memcpy(&texels[2], bottom + 8 * x, 8);
+            uint32_t even = (texels[0] & mask) + (texels[1] & mask) + (texels[2] & mask) + (texels[3] & mask) + rounding;
+            uint32_t odd = ((texels[0] >> 8) & mask) + ((texels[1] >> 8) & mask) + ((texels[2] >> 8) & mask) + ((texels[3] >> 8) & mask) + rounding;
+            uint32_t average = ((even >> 2) & mask) | (((odd >> 2) & mask) << 8);
+            memcpy(targetRow + 4 * x, &average, 4);
+        }
+    }
+}
 
-    vkDestroyBuffer(context->getDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(context->getDevice(), stagingBufferMemory, nullptr);
+uint32_t Image::getMipWidth(uint32_t level) {
+    return std::max(1u, m_width >> level);
+}
+
+uint32_t Image::getMipHeight(uint32_t level) {
+    return std::max(1u, m_height >> level);
+}
+
+void Image::decodeKtx2(std::shared_ptr<MappedFile> &file, const std::string &fileName) {
+    const unsigned char identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    Ktx2Header header;
+    if(file->getSize() < sizeof(header) || memcmp(file->begin(), identifier, sizeof(identifier)) != 0) {
+        throw std::runtime_error("IMAGE ERROR: Invalid KTX2 file " + fileName);
+    }
+    memcpy(&header, file->begin(), sizeof(header));
+
+    //block compressed formats, srgb variants are sampled as unorm just like the textures decoded by stb_image
+    const std::vector<std::pair<VkFormat, VkFormat>> formats = {
+        {VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGB_UNORM_BLOCK},
+        {VK_FORMAT_BC1_RGB_SRGB_BLOCK, VK_FORMAT_BC1_RGB_UNORM_BLOCK},
+        {VK_FORMAT_BC1_RGBA_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_UNORM_BLOCK},
+        {VK_FORMAT_BC1_RGBA_SRGB_BLOCK, VK_FORMAT_BC1_RGBA_UNORM_BLOCK},
+        {VK_FORMAT_BC3_UNORM_BLOCK, VK_FORMAT_BC3_UNORM_BLOCK},
+        {VK_FORMAT_BC3_SRGB_BLOCK, VK_FORMAT_BC3_UNORM_BLOCK},
+        {VK_FORMAT_BC4_UNORM_BLOCK, VK_FORMAT_BC4_UNORM_BLOCK},
+        {VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC5_UNORM_BLOCK},
+        {VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC7_UNORM_BLOCK},
+        {VK_FORMAT_BC7_SRGB_BLOCK, VK_FORMAT_BC7_UNORM_BLOCK}
+    };
+    size_t formatIndex = 0;
+    while(formatIndex < formats.size() && static_cast<uint32_t>(formats[formatIndex].first) != header.vkFormat) {
+        formatIndex++;
+    }
+    if(formatIndex == formats.size()) {
+        throw std::runtime_error("IMAGE ERROR: Unsupported format in KTX2 file " + fileName + ", expected BC1, BC3, BC4, BC5 or BC7");
+    }
+    if(header.supercompressionScheme != 0) {
+        throw std::runtime_error("IMAGE ERROR: Supercompressed KTX2 files are not supported: " + fileName);
+    }
+    if(header.pixelHeight == 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1) {
+        throw std::runtime_error("IMAGE ERROR: KTX2 file " + fileName + " is not a 2D texture");
+    }
+    //a full mip chain bounds the level count, which also keeps the shifts in getMipWidth and getMipHeight below 32
+    uint32_t maxLevels = 1;
+    while(std::max(header.pixelWidth, header.pixelHeight) >> maxLevels) {
+        maxLevels++;
+    }
+    if(header.pixelWidth == 0 || header.levelCount > maxLevels) {
+        throw std::runtime_error("IMAGE ERROR: Invalid KTX2 file " + fileName);
+    }
+
+    m_width = header.pixelWidth;
+    m_height = header.pixelHeight;
+    m_format = formats[formatIndex].second;
+    m_aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    //a level count of 0 asks for generated mip levels, which is not possible for block compressed data
+    m_mipLevels = std::max(1u, header.levelCount);
+
+    //the level index follows the header, level 0 is the largest one
+    VkDeviceSize blockSize = m_format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || m_format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || m_format == VK_FORMAT_BC4_UNORM_BLOCK ? 8 : 16;
+    if(file->getSize() < sizeof(header) + m_mipLevels * sizeof(Ktx2LevelIndex)) {
+        throw std::runtime_error("IMAGE ERROR: Invalid KTX2 file " + fileName);
+    }
+    m_levelOffsets.resize(m_mipLevels);
+    m_levelSizes.resize(m_mipLevels);
+    for(uint32_t level=0; level<m_mipLevels; level++) {
+        Ktx2LevelIndex levelIndex;
+        memcpy(&levelIndex, file->begin() + sizeof(header) + level * sizeof(levelIndex), sizeof(levelIndex));
+        VkDeviceSize expectedSize = ((getMipWidth(level) + 3) / 4) * ((getMipHeight(level) + 3) / 4) * blockSize;
+        if(levelIndex.byteLength != expectedSize || levelIndex.byteOffset > file->getSize() || levelIndex.byteLength > file->getSize() - levelIndex.byteOffset) {
+            throw std::runtime_error("IMAGE ERROR: Invalid mip level in KTX2 file " + fileName);
+        }
+        m_levelOffsets[level] = levelIndex.byteOffset;
+        m_levelSizes[level] = levelIndex.byteLength;
+    }
+
+    //texture coordinates expect the first row at the bottom like the flipped images from stb_image
+    std::string orientation = findKtx2Value(*file, header, "KTXorientation");
+    if(orientation.size() < 2 || orientation[1] != 'u') {
+        std::cout << "   IMAGE: KTX2 file " << fileName << " is stored top-down and will appear flipped, create it with its origin at the bottom left" << std::endl;
+    }
+
+    //the level data is uploaded straight from the mapped file, which stays open as long as the pixels are referenced
+    m_pixels = std::shared_ptr<const unsigned char>(file, reinterpret_cast<const unsigned char*>(file->begin()));
+}
+
+std::string Image::findKtx2Value(const MappedFile &file, const Ktx2Header &header, const std::string &key) {
+    if(header.kvdByteOffset > file.getSize() || header.kvdByteLength > file.getSize() - header.kvdByteOffset) {
+        return "";
+    }
+
+    //entries consist of their length, the key and the value, both null terminated, and padding to 4 bytes
+    const char *keyValue = file.begin() + header.kvdByteOffset;
+    const char *keyValueEnd = keyValue + header.kvdByteLength;
+    while(keyValueEnd - keyValue >= 4) {
+        uint32_t length;
+        memcpy(&length, keyValue, 4);
+        keyValue += 4;
+        if(length > static_cast<uint32_t>(keyValueEnd - keyValue)) {
+            break;
+        }
+        size_t keyLength = strnlen(keyValue, length);
+        if(key.compare(0, std::string::npos, keyValue, keyLength) == 0 && keyLength + 1 < length) {
+            return std::string(keyValue + keyLength + 1, strnlen(keyValue + keyLength + 1, length - keyLength - 1));
+        }
+        keyValue += std::min(static_cast<size_t>((length + 3) / 4 * 4), static_cast<size_t>(keyValueEnd - keyValue));
+    }
+    return "";
+}
+
+void Image::encodeTexture(TextureEncoding encoding, uint32_t numThreads) {
+    //all levels are computed from the decoded image before being encoded
+    std::vector<std::vector<unsigned char>> levels(m_mipLevels);
+    levels[0].assign(m_pixels.get(), m_pixels.get() + static_cast<size_t>(m_width) * m_height * 4);
+    for(uint32_t level=1; level<m_mipLevels; level++) {
+        levels[level].resize(static_cast<size_t>(getMipWidth(level)) * getMipHeight(level) * 4);
+        downsample(levels[level - 1].data(), getMipWidth(level - 1), getMipHeight(level - 1), levels[level].data());
+    }
+
+    m_levelOffsets.resize(m_mipLevels);
+    m_levelSizes.resize(m_mipLevels);
+    VkDeviceSize encodedSize = 0;
+    for(uint32_t level=0; level<m_mipLevels; level++) {
+        m_levelOffsets[level] = encodedSize;
+        m_levelSizes[level] = BlockEncoder::getEncodedSize(encoding, getMipWidth(level), getMipHeight(level));
+        encodedSize += m_levelSizes[level];
+    }
+    auto encoded = std::make_shared<std::vector<unsigned char>>(static_cast<size_t>(encodedSize));
+    for(uint32_t level=0; level<m_mipLevels; level++) {
+        BlockEncoder::encode(encoding, levels[level].data(), getMipWidth(level), getMipHeight(level), encoded->data() + m_levelOffsets[level], numThreads);
+    }
+
+    m_format = BlockEncoder::getFormat(encoding);
+    m_pixels = std::shared_ptr<const unsigned char>(encoded, encoded->data());
+}
+
+bool Image::loadTextureCache(const std::string &cachePath) {
+    uint64_t cacheSize, cacheModificationTime;
+    if(!MappedFile::getFileStatus(cachePath, cacheSize, cacheModificationTime) || cacheSize < sizeof(Ktx2Header)) {
+        return false;
+    }
+
+    auto cacheFile = std::make_shared<MappedFile>(cachePath);
+    Ktx2Header header;
+    memcpy(&header, cacheFile->begin(), sizeof(header));
+    char sourceHash[17];
+    snprintf(sourceHash, sizeof(sourceHash), "%016llx", static_cast<unsigned long long>(m_contentHash));
+    if(findKtx2Value(*cacheFile, header, "slbSourceHash") != sourceHash) {
+        return false;
+    }
+
+    //a broken cache is simply encoded again
+    try {
+        decodeKtx2(cacheFile, cachePath);
+    } catch(std::runtime_error &) {
+        return false;
+    }
+    return true;
+}
+
+void Image::writeTextureCache(const std::string &cachePath) {
+    char sourceHash[17];
+    snprintf(sourceHash, sizeof(sourceHash), "%016llx", static_cast<unsigned long long>(m_contentHash));
+    std::vector<std::pair<std::string, std::string>> entries = {
+        {"KTXorientation", "ru"},
+        {"slbSourceHash", sourceHash}
+    };
+    std::string keyValueData;
+    for(auto &entry : entries) {
+        uint32_t length = static_cast<uint32_t>(entry.first.size() + entry.second.size() + 2);
+        keyValueData.append(reinterpret_cast<const char*>(&length), 4);
+        keyValueData += entry.first + '\0' + entry.second + '\0';
+        keyValueData.resize((keyValueData.size() + 3) / 4 * 4, '\0');
+    }
+
+    Ktx2Header header{};
+    const unsigned char identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    memcpy(header.identifier, identifier, sizeof(identifier));
+    header.vkFormat = static_cast<uint32_t>(m_format);
+    header.typeSize = 1;
+    header.pixelWidth = m_width;
+    header.pixelHeight = m_height;
+    header.faceCount = 1;
+    header.levelCount = m_mipLevels;
+    header.kvdByteOffset = static_cast<uint32_t>(sizeof(header) + m_mipLevels * sizeof(Ktx2LevelIndex));
+    header.kvdByteLength = static_cast<uint32_t>(keyValueData.size());
+
+    //like in KTX2 files the smallest level is stored first, each level aligned to 16 bytes
+    std::vector<Ktx2LevelIndex> levelIndices(m_mipLevels);
+    uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+    for(uint32_t level=m_mipLevels; level-->0;) {
+        offset = (offset + 15) / 16 * 16;
+        levelIndices[level].byteOffset = offset;
+        levelIndices[level].byteLength = m_levelSizes[level];
+        levelIndices[level].uncompressedByteLength = m_levelSizes[level];
+        offset += m_levelSizes[level];
+    }
+
+    //write to a temporary file first so an interrupted write never leaves a broken cache behind
+    std::ofstream cacheFile(cachePath + ".tmp", std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!cacheFile.is_open()) {
+        std::cout << "   IMAGE: Could not write texture cache " << cachePath << std::endl;
+        return;
+    }
+    cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    cacheFile.write(reinterpret_cast<const char*>(levelIndices.data()), levelIndices.size() * sizeof(Ktx2LevelIndex));
+    cacheFile.write(keyValueData.data(), keyValueData.size());
+    offset = header.kvdByteOffset + header.kvdByteLength;
+    const char padding[16] = {};
+    for(uint32_t level=m_mipLevels; level-->0;) {
+        cacheFile.write(padding, levelIndices[level].byteOffset - offset);
+        cacheFile.write(reinterpret_cast<const char*>(m_pixels.get() + m_levelOffsets[level]), m_levelSizes[level]);
+        offset = levelIndices[level].byteOffset + m_levelSizes[level];
+    }
+
+    cacheFile.close();
+    if(cacheFile.fail()) {
+        std::remove((cachePath + ".tmp").c_str());
+        std::cout << "   IMAGE: Could not write texture cache " << cachePath << std::endl;
+        return;
+    }
+    std::remove(cachePath.c_str());
+    std::rename((cachePath + ".tmp").c_str(), cachePath.c_str());
 }
 
 void Image::cleanUp(std::shared_ptr<Context> &context) {
     for(uint32_t m=0; m<m_memory.size(); m++) {
         vkDestroyImage(context->getDevice(), m_handles[m], nullptr);
-        vkFreeMemory(context->getDevice(), m_memory[m], nullptr);
+        context->freeMemory(m_memory[m]);
     }
     for(uint32_t v=0; v<m_views.size(); v++) {
         vkDestroyImageView(context->getDevice(), m_views[v], nullptr);
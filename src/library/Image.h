@@ -3,7 +3,42 @@
 
 #include <glm/glm.hpp>
 
+#include "BlockEncoder.h"
 #include "Context.h"
+#include "MappedFile.h"
+
+/**
+ * Header at the beginning of a KTX2 file, including the 12 byte file identifier.
+ * 
+ * The header is followed by one Ktx2LevelIndex per mip level.
+ */
+struct Ktx2Header {
+    unsigned char identifier[12]; /**< Identifier marking the file as KTX2 */
+    uint32_t vkFormat; /**< Vulkan format of the image data */
+    uint32_t typeSize; /**< Size of the data type used by the format in bytes, 1 for block compressed formats */
+    uint32_t pixelWidth; /**< Width of the base level in number of pixels */
+    uint32_t pixelHeight; /**< Height of the base level in number of pixels, 0 for 1D textures */
+    uint32_t pixelDepth; /**< Depth of the base level in number of pixels, 0 for 2D textures */
+    uint32_t layerCount; /**< Number of array layers, 0 if the texture is not an array */
+    uint32_t faceCount; /**< Number of cube map faces, 1 for textures that are not cube maps */
+    uint32_t levelCount; /**< Number of mip levels stored in the file, 0 if they should be generated */
+    uint32_t supercompressionScheme; /**< Additional compression applied to the level data, 0 for none */
+    uint32_t dfdByteOffset; /**< Position of the data format descriptor in the file */
+    uint32_t dfdByteLength; /**< Size of the data format descriptor in bytes */
+    uint32_t kvdByteOffset; /**< Position of the key/value data in the file */
+    uint32_t kvdByteLength; /**< Size of the key/value data in bytes */
+    uint64_t sgdByteOffset; /**< Position of the supercompression global data in the file */
+    uint64_t sgdByteLength; /**< Size of the supercompression global data in bytes */
+};
+
+/**
+ * Location of a single mip level in a KTX2 file.
+ */
+struct Ktx2LevelIndex {
+    uint64_t byteOffset; /**< Position of the level data in the file */
+    uint64_t byteLength; /**< Size of the level data in the file in bytes */
+    uint64_t uncompressedByteLength; /**< Size of the level data after supercompression is undone */
+};
 
 /**
  * Image or set of images used to access in shaders or to render to.
@@ -189,6 +224,15 @@ public:
      */
     void transitionLayout(std::shared_ptr<Context> &context, VkImageLayout oldLayout, VkImageLayout newLayout);
 
+    /**
+     * Record a change in image layout into a command buffer.
+     * 
+     * @param commandBuffer command buffer receiving the pipeline barrier
+     * @param oldLayout layout of the image before the transition
+     * @param newLayout layout of the image after the transition
+     */
+    void recordTransition(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout);
+
     /**
      * Copy the contents of a buffer into the image.
      * 
@@ -199,15 +243,94 @@ public:
      */
     void copyBuffer(std::shared_ptr<Context> &context, VkBuffer buffer);
 
+    /**
+     * Record a copy from a buffer into the image.
+     * 
+     * The image has to be in layout VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL when the command is executed.
+     * 
+     * @param commandBuffer command buffer receiving the copy command
+     * @param buffer source buffer to copy from
+     * @param offset position of the image data in the source buffer in bytes
+     * @param mipLevel mip level of the image receiving the data
+     */
+    void recordCopyBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset = 0, uint32_t mipLevel = 0);
+
+    /**
+     * Decode an image file into pixel data kept in host memory.
+     * 
+     * Files ending in .ktx2 have to contain BC1, BC3, BC4, BC5 or BC7 data, which is uploaded as is together with the mip levels stored in the file.
+     * All other files are decoded to rgba by stb_image.
+     * With a block compressed encoding the full mip chain is computed and encoded on the CPU.
+     * The result is cached in a file named <fileName>.<encoding>.slbtex next to the texture, which is reused as long as the source hash matches.
+     * Does not access the vulkan context, so textures can be decoded on worker threads.
+     * The pixel data is released again by uploadTexture or uploadTextures.
+     * A hash of the file contents is stored as well, the number of mip levels is set for a full mip chain.
+     * 
+     * @param fileName name of an image file in the resources/textures folder
+     * @param encoding format the texture is converted to, ignored for .ktx2 files
+     * @param numEncoderThreads maximum number of threads used for block compression, 0 uses all hardware threads, should be 1 on thread pool workers
+     */
+    void decodeTexture(const std::string &fileName, TextureEncoding encoding = rgbaEncoding, uint32_t numEncoderThreads = 0);
+
+    /**
+     * Return the number of mip levels of the image.
+     * 
+     * Textures loaded from files have a full mip chain down to 1x1 pixels, all other images have a single level.
+     */
+    uint32_t getNumMipLevels();
+
+    /**
+     * Return the hash of the file contents the texture was decoded from.
+     * 
+     * Files with identical contents have the same hash regardless of their name.
+     * 
+     * @return hash computed by decodeTexture, 0 if the image was not loaded from a file
+     */
+    uint64_t getContentHash();
+
+    /**
+     * Check wether decoded pixel data is waiting to be uploaded.
+     * 
+     * @return true if decodeTexture has been called but uploadTexture has not
+     */
+    bool hasPixels();
+
+    /**
+     * Create the vulkan image from previously decoded pixel data.
+     * 
+     * Mip levels missing from the pixel data are generated with linear blits on the GPU.
+     * If the format does not support linear filtering for blits they are computed on the CPU and uploaded as well.
+     * The copies are recorded into the current batch of the upload manager, so the texture can only be sampled
+     * by commands submitted after the next flush.
+     * A pointer to the vulkan context is used to access the logical device.
+     * 
+     * @param context pointer to the vulkan context
+     */
+    void uploadTexture(std::shared_ptr<Context> &context);
+
+    /**
+     * Create the vulkan images for several textures with previously decoded pixel data.
+     * 
+     * All layout transitions and copies are recorded into the current batch of the upload manager,
+     * which submits them together instead of one submission per texture.
+     * 
+     * @param context pointer to the vulkan context
+     * @param images textures with decoded pixel data
+     */
+    static void uploadTextures(std::shared_ptr<Context> &context, std::vector<std::shared_ptr<Image>> &images);
+
     /**
      * Load image data from a file.
      * 
+     * Decodes and uploads the texture in one go.
+     * If the device cannot sample the requested block compressed format, the texture is uploaded as rgba instead.
      * A pointer to the vulkan context is used to access the logical device.
      * 
      * @param context pointer to the vulkan context
      * @param fileName name of an image file in the resources/textures folder
+     * @param encoding format the texture is converted to
      */
-    void loadTexture(std::shared_ptr<Context> &context, const std::string &fileName);
+    void loadTexture(std::shared_ptr<Context> &context, const std::string &fileName, TextureEncoding encoding = rgbaEncoding);
 
     /**
      * Destroy all vulkan components.
@@ -220,9 +343,116 @@ public:
     void cleanUp(std::shared_ptr<Context> &context);
 
 private:
+    /**
+     * Read the header and mip level locations of a KTX2 file.
+     * 
+     * The level data is not copied, the pixel data refers to the mapped file instead.
+     * 
+     * @param file mapped KTX2 file
+     * @param fileName name of the file used in error messages
+     */
+    void decodeKtx2(std::shared_ptr<MappedFile> &file, const std::string &fileName);
+
+    /**
+     * Look up a value in the key/value data of a KTX2 file.
+     * 
+     * @param file mapped KTX2 file
+     * @param header header read from the file
+     * @param key name of the entry
+     * @return value of the entry, empty if there is none
+     */
+    static std::string findKtx2Value(const MappedFile &file, const Ktx2Header &header, const std::string &key);
+
+    /**
+     * Replace the decoded rgba pixels by a block compressed mip chain.
+     * 
+     * @param encoding block compressed texture encoding
+     * @param numThreads maximum number of threads used for encoding, 0 uses all hardware threads
+     */
+    void encodeTexture(TextureEncoding encoding, uint32_t numThreads);
+
+    /**
+     * Load previously encoded pixel data from a texture cache.
+     * 
+     * The cache is only used if it was created from a file with the current content hash.
+     * 
+     * @param cachePath path of the cache file
+     * @return true if the cache was valid and has been loaded
+     */
+    bool loadTextureCache(const std::string &cachePath);
+
+    /**
+     * Store the encoded pixel data in a texture cache.
+     * 
+     * The cache uses the KTX2 layout without a data format descriptor, the content hash of the source is added as key/value data.
+     * Failing to write the cache is not an error, the texture is simply encoded again next time.
+     * 
+     * @param cachePath path of the cache file
+     */
+    void writeTextureCache(const std::string &cachePath);
+
+    /**
+     * Choose how the mip chain is generated and set up usage and memory properties for a texture upload.
+     * 
+     * @param context pointer to the vulkan context
+     * @return number of bytes required in the staging buffer
+     */
+    VkDeviceSize prepareUpload(std::shared_ptr<Context> &context);
+
+    /**
+     * Write the decoded pixel data, and mip levels generated on the CPU if required, into a staging buffer.
+     * 
+     * The decoded pixel data is released afterwards.
+     * 
+     * @param target mapped staging memory with at least the size returned by prepareUpload
+     */
+    void writeStaging(unsigned char *target);
+
+    /**
+     * Record all commands turning the staged data into a sampled texture with a complete mip chain.
+     * 
+     * The copies are recorded for the transfer queue, the image is then handed over to the graphics queue for the mip level blits.
+     * 
+     * @param uploads upload manager providing the command buffers of the current batch
+     * @param buffer staging buffer written by writeStaging
+     * @param offset position of the staged data in the buffer in bytes
+     */
+    void recordUpload(std::unique_ptr<UploadManager> &uploads, VkBuffer buffer, VkDeviceSize offset);
+
+    /**
+     * Record blits filling each mip level from the previous one.
+     * 
+     * Level 0 has to contain the image data in layout VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL.
+     * Afterwards all levels are in layout VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+     * 
+     * @param commandBuffer command buffer receiving the commands
+     */
+    void recordMipBlits(VkCommandBuffer commandBuffer);
+
+    /**
+     * Compute the next mip level of rgba pixel data with a 2x2 box filter.
+     * 
+     * @param source pixel data of the larger level
+     * @param width width of the larger level in number of pixels
+     * @param height height of the larger level in number of pixels
+     * @param[out] target pixel data of the smaller level
+     */
+    static void downsample(const unsigned char *source, uint32_t width, uint32_t height, unsigned char *target);
+
+    /**
+     * Return the width of a mip level in number of pixels.
+     */
+    uint32_t getMipWidth(uint32_t level);
+
+    /**
+     * Return the height of a mip level in number of pixels.
+     */
+    uint32_t getMipHeight(uint32_t level);
+
     uint32_t m_width; /**< Width of the image in number of pixels */
     uint32_t m_height; /**< Height of the image in number of pixels */
     uint32_t m_numLayers = 1; /**< Number of layers relevant for an image array */
+    uint32_t m_mipLevels = 1; /**< Number of mip levels, each half the size of the previous one */
 
     VkFormat m_format = VK_FORMAT_R8G8B8A8_SRGB; /**< Format of the image values */
     VkImageAspectFlags m_aspect = VK_IMAGE_ASPECT_COLOR_BIT; /**< Image aspect flags included in the image view */
@@ -235,8 +465,15 @@ private:
 
     bool m_useMultisampling = false; /**< If true multiple samples are stored for each pixel */
 
+    std::shared_ptr<const unsigned char> m_pixels; /**< Decoded pixel data waiting to be uploaded */
+    std::vector<VkDeviceSize> m_levelOffsets; /**< Position of each mip level available in the pixel data */
+    std::vector<VkDeviceSize> m_levelSizes; /**< Size of each mip level available in the pixel data in bytes */
+    std::vector<VkDeviceSize> m_stagingOffsets; /**< Position of each uploaded mip level in the staging buffer */
+    uint64_t m_contentHash = 0; /**< Hash of the file contents the texture was decoded from */
+    bool m_generateMipsOnCpu = false; /**< True if missing mip levels are computed on the CPU because the format does not support linear blits */
+
     std::vector<VkImage> m_handles; /**< Vulkan handles of the created images */
-    std::vector<VkDeviceMemory> m_memory; /**< Memory containing the image data */
+    std::vector<MemoryAllocation> m_memory; /**< Memory ranges containing the image data */
     std::vector<VkImageView> m_views; /**< Image views necessary for shader access to the image */
 
 };
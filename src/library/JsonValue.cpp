@@ -0,0 +1,293 @@
+#include "JsonValue.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+JsonValue JsonValue::parse(const char *begin, const char *end) {
+    JsonValue root;
+    const char *cursor = begin;
+    parseValue(cursor, end, 0, root);
+    skipWhiteSpace(cursor, end);
+    if(cursor != end) {
+        throw parseError("Unexpected characters after the document.");
+    }
+    return root;
+}
+
+JsonType JsonValue::getType() const {
+    return m_type;
+}
+
+bool JsonValue::isNull() const {
+    return m_type == nullJson;
+}
+
+size_t JsonValue::size() const {
+    return m_elements.size();
+}
+
+bool JsonValue::has(const std::string &key) const {
+    for(auto &memberKey : m_keys) {
+        if(memberKey == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const JsonValue &JsonValue::operator[](const std::string &key) const {
+    static const JsonValue missing;
+    for(size_t m=0; m<m_keys.size(); m++) {
+        if(m_keys[m] == key) {
+            return m_elements[m];
+        }
+    }
+    return missing;
+}
+
+const JsonValue &JsonValue::operator[](size_t index) const {
+    static const JsonValue missing;
+    if(m_type != arrayJson || index >= m_elements.size()) {
+        return missing;
+    }
+    return m_elements[index];
+}
+
+bool JsonValue::getBool(bool defaultValue) const {
+    return m_type == boolJson ? m_bool : defaultValue;
+}
+
+double JsonValue::getNumber(double defaultValue) const {
+    return m_type == numberJson ? m_number : defaultValue;
+}
+
+uint32_t JsonValue::getIndex(uint32_t defaultValue) const {
+    if(m_type != numberJson || m_number < 0.0 || m_number > 4294967295.0 || std::floor(m_number) != m_number) {
+        return defaultValue;
+    }
+    return static_cast<uint32_t>(m_number);
+}
+
+const std::string &JsonValue::getString() const {
+    return m_string;
+}
+
+void JsonValue::parseValue(const char *&cursor, const char *end, uint32_t depth, JsonValue &value) {
+    if(depth > maxJsonDepth) {
+        throw parseError("Document is nested too deeply.");
+    }
+    skipWhiteSpace(cursor, end);
+    if(cursor == end) {
+        throw parseError("Unexpected end of the document.");
+    }
+
+    if(*cursor == '{') {
+        value.m_type = objectJson;
+        cursor++;
+        skipWhiteSpace(cursor, end);
+        if(cursor != end && *cursor == '}') {
+            cursor++;
+            return;
+        }
+        while(true) {
+            skipWhiteSpace(cursor, end);
+            if(cursor == end || *cursor != '"') {
+                throw parseError("Expected a member name.");
+            }
+            value.m_keys.emplace_back();
+            parseString(cursor, end, value.m_keys.back());
+            skipWhiteSpace(cursor, end);
+            if(cursor == end || *cursor != ':') {
+                throw parseError("Expected ':' after a member name.");
+            }
+            cursor++;
+            value.m_elements.emplace_back();
+            parseValue(cursor, end, depth + 1, value.m_elements.back());
+            skipWhiteSpace(cursor, end);
+            if(cursor != end && *cursor == ',') {
+                cursor++;
+            } else if(cursor != end && *cursor == '}') {
+                cursor++;
+                return;
+            } else {
+                throw parseError("Expected ',' or '}' in an object.");
+            }
+        }
+    }
+
+    if(*cursor == '[') {
+        value.m_type = arrayJson;
+        cursor++;
+        skipWhiteSpace(cursor, end);
+        if(cursor != end && *cursor == ']') {
+            cursor++;
+            return;
+        }
+        while(true) {
+            value.m_elements.emplace_back();
+            parseValue(cursor, end, depth + 1, value.m_elements.back());
+            skipWhiteSpace(cursor, end);
+            if(cursor != end && *cursor == ',') {
+                cursor++;
+            } else if(cursor != end && *cursor == ']') {
+                cursor++;
+                return;
+            } else {
+                throw parseError("Expected ',' or ']' in an array.");
+            }
+        }
+    }
+
+    if(*cursor == '"') {
+        value.m_type = stringJson;
+        parseString(cursor, end, value.m_string);
+        return;
+    }
+
+    const char *keywords[3] = {"true", "false", "null"};
+    for(int k=0; k<3; k++) {
+        size_t length = std::strlen(keywords[k]);
+        if(static_cast<size_t>(end - cursor) >= length && std::strncmp(cursor, keywords[k], length) == 0) {
+            value.m_type = k < 2 ? boolJson : nullJson;
+            value.m_bool = k == 0;
+            cursor += length;
+            return;
+        }
+    }
+
+    //numbers are validated against the JSON grammar, which is stricter than strtod
+    const char *numberStart = cursor;
+    if(cursor != end && *cursor == '-') {
+        cursor++;
+    }
+    if(cursor == end || !std::isdigit(static_cast<unsigned char>(*cursor))) {
+        throw parseError("Unexpected character.");
+    }
+    if(*cursor == '0') {
+        cursor++;
+    } else {
+        while(cursor != end && std::isdigit(static_cast<unsigned char>(*cursor))) {
+            cursor++;
+        }
+    }
+    if(cursor != end && *cursor == '.') {
+        cursor++;
+        if(cursor == end || !std::isdigit(static_cast<unsigned char>(*cursor))) {
+            throw parseError("Expected digits after the decimal point.");
+        }
+        while(cursor != end && std::isdigit(static_cast<unsigned char>(*cursor))) {
+            cursor++;
+        }
+    }
+    if(cursor != end && (*cursor == 'e' || *cursor == 'E')) {
+        cursor++;
+        if(cursor != end && (*cursor == '+' || *cursor == '-')) {
+            cursor++;
+        }
+        if(cursor == end || !std::isdigit(static_cast<unsigned char>(*cursor))) {
+            throw parseError("Expected digits in the exponent.");
+        }
+        while(cursor != end && std::isdigit(static_cast<unsigned char>(*cursor))) {
+            cursor++;
+        }
+    }
+    value.m_type = numberJson;
+    value.m_number = std::strtod(std::string(numberStart, cursor).c_str(), nullptr);
+}
+
+void JsonValue::parseString(const char *&cursor, const char *end, std::string &text) {
+    cursor++;
+    while(true) {
+        if(cursor == end) {
+            throw parseError("Unterminated string.");
+        }
+        char c = *cursor++;
+        if(c == '"') {
+            return;
+        }
+        if(static_cast<unsigned char>(c) < 0x20) {
+            throw parseError("Control character in a string.");
+        }
+        if(c != '\\') {
+            text += c;
+            continue;
+        }
+
+        if(cursor == end) {
+            throw parseError("Unterminated string.");
+        }
+        c = *cursor++;
+        switch(c) {
+            case '"': text += '"'; break;
+            case '\\': text += '\\'; break;
+            case '/': text += '/'; break;
+            case 'b': text += '\b'; break;
+            case 'f': text += '\f'; break;
+            case 'n': text += '\n'; break;
+            case 'r': text += '\r'; break;
+            case 't': text += '\t'; break;
+            case 'u': {
+                auto readCodeUnit = [&]() {
+                    if(end - cursor < 4) {
+                        throw parseError("Incomplete unicode escape.");
+                    }
+                    uint32_t unit = 0;
+                    for(int d=0; d<4; d++) {
+                        char digit = *cursor++;
+                        unit <<= 4;
+                        if(digit >= '0' && digit <= '9') {
+                            unit |= digit - '0';
+                        } else if(digit >= 'a' && digit <= 'f') {
+                            unit |= digit - 'a' + 10;
+                        } else if(digit >= 'A' && digit <= 'F') {
+                            unit |= digit - 'A' + 10;
+                        } else {
+                            throw parseError("Invalid unicode escape.");
+                        }
+                    }
+                    return unit;
+                };
+                uint32_t codePoint = readCodeUnit();
+                //characters outside the basic plane are escaped as a pair of surrogates
+                if(codePoint >= 0xD800 && codePoint < 0xDC00 && end - cursor >= 2 && cursor[0] == '\\' && cursor[1] == 'u') {
+                    cursor += 2;
+                    uint32_t low = readCodeUnit();
+                    if(low < 0xDC00 || low >= 0xE000) {
+                        throw parseError("Invalid surrogate pair.");
+                    }
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                if(codePoint < 0x80) {
+                    text += static_cast<char>(codePoint);
+                } else if(codePoint < 0x800) {
+                    text += static_cast<char>(0xC0 | (codePoint >> 6));
+                    text += static_cast<char>(0x80 | (codePoint & 0x3F));
+                } else if(codePoint < 0x10000) {
+                    text += static_cast<char>(0xE0 | (codePoint >> 12));
+                    text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                    text += static_cast<char>(0x80 | (codePoint & 0x3F));
+                } else {
+                    text += static_cast<char>(0xF0 | (codePoint >> 18));
+                    text += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                    text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                    text += static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+                break;
+            }
+            default:
+                throw parseError("Invalid escape sequence.");
+        }
+    }
+}
+
+void JsonValue::skipWhiteSpace(const char *&cursor, const char *end) {
+    while(cursor != end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) {
+        cursor++;
+    }
+}
+
+std::runtime_error JsonValue::parseError(const std::string &message) {
+    return std::runtime_error("JSON ERROR: " + message);
+}
\ No newline at end of file
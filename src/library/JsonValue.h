@@ -0,0 +1,164 @@
+#ifndef SLBVULKAN_JSONVALUE_H
+#define SLBVULKAN_JSONVALUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Maximum number of arrays and objects nested into each other, so malformed files cannot overflow the stack.
+ */
+const uint32_t maxJsonDepth = 64;
+
+/**
+ * Kinds of values in a JSON document.
+ */
+enum JsonType {
+    nullJson,
+    boolJson,
+    numberJson,
+    stringJson,
+    arrayJson,
+    objectJson
+};
+
+/**
+ * Value of a parsed JSON document, e.g. the scene description of a glTF file.
+ *
+ * Arrays and objects own their elements, members of objects are kept in the order of the document.
+ * Accessing missing members or elements returns a null value instead of throwing,
+ * so optional properties can be read with a default value in a single expression.
+ */
+class JsonValue {
+public:
+    /**
+     * Parse a JSON document.
+     *
+     * Throws an error if the text is not valid JSON or nested too deeply.
+     *
+     * @param begin first character of the document
+     * @param end position directly behind the last character of the document
+     * @return root value of the document
+     */
+    static JsonValue parse(const char *begin, const char *end);
+
+    /**
+     * Return the kind of the value.
+     */
+    JsonType getType() const;
+
+    /**
+     * Check if the value is null, which includes missing members and elements.
+     */
+    bool isNull() const;
+
+    /**
+     * Return the number of elements of an array or members of an object.
+     *
+     * @return size of the array or object, 0 for all other values
+     */
+    size_t size() const;
+
+    /**
+     * Check if an object has a member with the given name.
+     *
+     * @param key name of the member
+     * @return true if the value is an object containing the member
+     */
+    bool has(const std::string &key) const;
+
+    /**
+     * Return a member of an object.
+     *
+     * @param key name of the member
+     * @return value of the member, null if the value is not an object or the member does not exist
+     */
+    const JsonValue &operator[](const std::string &key) const;
+
+    /**
+     * Return an element of an array.
+     *
+     * @param index position of the element
+     * @return element, null if the value is not an array or the index is out of range
+     */
+    const JsonValue &operator[](size_t index) const;
+
+    /**
+     * Return the value of a boolean.
+     *
+     * @param defaultValue result if the value is not a boolean
+     */
+    bool getBool(bool defaultValue = false) const;
+
+    /**
+     * Return the value of a number.
+     *
+     * @param defaultValue result if the value is not a number
+     */
+    double getNumber(double defaultValue = 0.0) const;
+
+    /**
+     * Return the value of a number used as an index or count.
+     *
+     * @param defaultValue result if the value is not a number
+     * @return value of the number, defaultValue if it is negative, fractional or too large
+     */
+    uint32_t getIndex(uint32_t defaultValue = 0) const;
+
+    /**
+     * Return the text of a string with all escape sequences resolved.
+     *
+     * @return text of the string, empty for all other values
+     */
+    const std::string &getString() const;
+
+private:
+    /**
+     * Parse the value starting at the cursor.
+     *
+     * @param cursor position of the value, moved behind it
+     * @param end end of the document
+     * @param depth number of arrays and objects the value is nested in
+     * @param[out] value parsed value
+     */
+    static void parseValue(const char *&cursor, const char *end, uint32_t depth, JsonValue &value);
+
+    /**
+     * Parse a string starting at its opening quote.
+     *
+     * Escaped unicode characters, including surrogate pairs, are converted to UTF-8.
+     *
+     * @param cursor position of the opening quote, moved behind the closing quote
+     * @param end end of the document
+     * @param[out] text contents of the string
+     */
+    static void parseString(const char *&cursor, const char *end, std::string &text);
+
+    /**
+     * Move the cursor to the next character that is not white space.
+     *
+     * @param cursor current position
+     * @param end end of the document
+     */
+    static void skipWhiteSpace(const char *&cursor, const char *end);
+
+    /**
+     * Create an error describing a malformed document.
+     *
+     * @param message description of the problem
+     * @return exception to be thrown
+     */
+    static std::runtime_error parseError(const std::string &message);
+
+    JsonType m_type = nullJson; /**< Kind of the value */
+    bool m_bool = false; /**< Value of a boolean */
+    double m_number = 0.0; /**< Value of a number */
+    std::string m_string; /**< Text of a string */
+    std::vector<std::string> m_keys; /**< Member names of an object, in the same order as the elements */
+    std::vector<JsonValue> m_elements; /**< Elements of an array or member values of an object */
+
+};
+
+#endif //SLBVULKAN_JSONVALUE_H
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("MAPPED FILE ERROR: Could not open file: " + path);
+    }
+    m_fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::runtime_error("MAPPED FILE ERROR: Could not determine size of file: " + path);
+    }
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    if(m_size == 0) {
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping == nullptr) {
+        CloseHandle(file);
+        throw std::runtime_error("MAPPED FILE ERROR: Could not create mapping for file: " + path);
+    }
+    m_mappingHandle = mapping;
+
+    m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if(m_data == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("MAPPED FILE ERROR: Could not map file: " + path);
+    }
+}
+
+bool MappedFile::getFileStatus(const std::string &path, uint64_t &size, uint64_t &modificationTime) {
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if(!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes)) {
+        return false;
+    }
+    size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+    modificationTime = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+std::vector<std::string> MappedFile::listFiles(const std::string &directory, const std::string &extension) {
+    std::vector<std::string> fileNames;
+    WIN32_FIND_DATAA entry;
+    HANDLE search = FindFirstFileA((directory + "/*" + extension).c_str(), &entry);
+    if(search == INVALID_HANDLE_VALUE) {
+        return fileNames;
+    }
+    do {
+        //the pattern also matches longer extensions starting with the same characters
+        std::string fileName = entry.cFileName;
+        if(!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && fileName.size() > extension.size()
+            && fileName.compare(fileName.size() - extension.size(), extension.size(), extension) == 0) {
+            fileNames.emplace_back(fileName);
+        }
+    } while(FindNextFileA(search, &entry));
+    FindClose(search);
+    std::sort(fileNames.begin(), fileNames.end());
+    return fileNames;
+}
+
+MappedFile::~MappedFile() {
+    if(m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+    if(m_mappingHandle != nullptr) {
+        CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+    }
+    if(m_fileHandle != nullptr) {
+        CloseHandle(static_cast<HANDLE>(m_fileHandle));
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+    m_fileDescriptor = open(path.c_str(), O_RDONLY);
+    if(m_fileDescriptor < 0) {
+        throw std::runtime_error("MAPPED FILE ERROR: Could not open file: " + path);
+    }
+
+    struct stat fileStats;
+    if(fstat(m_fileDescriptor, &fileStats) != 0) {
+        close(m_fileDescriptor);
+        throw std::runtime_error("MAPPED FILE ERROR: Could not determine size of file: " + path);
+    }
+    m_size = static_cast<size_t>(fileStats.st_size);
+    if(m_size == 0) {
+        return;
+    }
+
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+    if(data == MAP_FAILED) {
+        close(m_fileDescriptor);
+        throw std::runtime_error("MAPPED FILE ERROR: Could not map file: " + path);
+    }
+    //the file is read front to back
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(data);
+}
+
+bool MappedFile::getFileStatus(const std::string &path, uint64_t &size, uint64_t &modificationTime) {
+    struct stat fileStats;
+    if(stat(path.c_str(), &fileStats) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(fileStats.st_size);
+#ifdef __APPLE__
+    modificationTime = static_cast<uint64_t>(fileStats.st_mtimespec.tv_sec) * 1000000000ull + static_cast<uint64_t>(fileStats.st_mtimespec.tv_nsec);
+#else
+    modificationTime = static_cast<uint64_t>(fileStats.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64_t>(fileStats.st_mtim.tv_nsec);
+#endif
+    return true;
+}
+
+std::vector<std::string> MappedFile::listFiles(const std::string &directory, const std::string &extension) {
+    std::vector<std::string> fileNames;
+    DIR *dir = opendir(directory.c_str());
+    if(dir == nullptr) {
+        return fileNames;
+    }
+    while(dirent *entry = readdir(dir)) {
+        std::string fileName = entry->d_name;
+        struct stat fileStats;
+        if(fileName.size() > extension.size() && fileName.compare(fileName.size() - extension.size(), extension.size(), extension) == 0
+            && stat((directory + "/" + fileName).c_str(), &fileStats) == 0 && S_ISREG(fileStats.st_mode)) {
+            fileNames.emplace_back(fileName);
+        }
+    }
+    closedir(dir);
+    std::sort(fileNames.begin(), fileNames.end());
+    return fileNames;
+}
+
+MappedFile::~MappedFile() {
+    if(m_data != nullptr) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+    if(m_fileDescriptor >= 0) {
+        close(m_fileDescriptor);
+    }
+}
+
+#endif
+
+const char *MappedFile::begin() const {
+    return m_data;
+}
+
+const char *MappedFile::end() const {
+    return m_data + m_size;
+}
+
+size_t MappedFile::getSize() const {
+    return m_size;
+}
+
+uint64_t MappedFile::computeHash(uint64_t seed) const {
+    const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+
+    //four independent lanes of 8 bytes each keep the multipliers busy
+    uint64_t lanes[4] = {seed + prime1, seed + prime2, seed, seed - prime1};
+    size_t numBlocks = m_size / 32;
+    for(size_t b=0; b<numBlocks; b++) {
+        for(int l=0; l<4; l++) {
+            uint64_t word;
+            std::memcpy(&word, m_data + 32 * b + 8 * l, sizeof(word));
+            lanes[l] += word * prime2;
+            lanes[l] = ((lanes[l] << 31) | (lanes[l] >> 33)) * prime1;
+        }
+    }
+
+    uint64_t hash = m_size;
+    for(int l=0; l<4; l++) {
+        hash = (hash ^ lanes[l]) * prime1 + prime2;
+    }
+    for(size_t i=32*numBlocks; i<m_size; i++) {
+        hash = (hash ^ static_cast<unsigned char>(m_data[i])) * prime1;
+        hash = (hash << 23) | (hash >> 41);
+    }
+
+    //final mixing so every input bit affects every output bit
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime1;
+    hash ^= hash >> 32;
+    return hash;
+}
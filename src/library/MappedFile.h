@@ -0,0 +1,98 @@
+#ifndef SLBVULKAN_MAPPEDFILE_H
+#define SLBVULKAN_MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Read-only view of a file mapped into the address space of the process.
+ * 
+ * The file contents can be accessed directly through a pointer without copying them into a buffer first.
+ * Pages are loaded lazily by the operating system when they are accessed for the first time.
+ * The mapping is released when the object is destroyed.
+ */
+class MappedFile {
+public:
+    /**
+     * Map a file into memory.
+     * 
+     * Throws an error if the file does not exist or cannot be mapped.
+     * Empty files are valid and result in a null data pointer with size 0.
+     * 
+     * @param path path of the file relative to the working directory
+     */
+    MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * Return the first character of the mapped file.
+     * 
+     * @return pointer to the start of the file contents
+     */
+    const char *begin() const;
+
+    /**
+     * Return the position directly behind the last character of the mapped file.
+     * 
+     * @return pointer to the end of the file contents
+     */
+    const char *end() const;
+
+    /**
+     * Return the size of the mapped file.
+     * 
+     * @return number of bytes in the file
+     */
+    size_t getSize() const;
+
+    /**
+     * Compute a 64 bit hash of the file contents.
+     * 
+     * The hash is not cryptographically secure, it is meant to detect changed files.
+     * 
+     * @param seed start value of the hash, can be used to combine the hashes of multiple files
+     * @return hash of all bytes in the file
+     */
+    uint64_t computeHash(uint64_t seed = 0) const;
+
+    /**
+     * Query size and time of the last modification of a file without opening it.
+     * 
+     * @param path path of the file relative to the working directory
+     * @param[out] size number of bytes in the file
+     * @param[out] modificationTime time of the last modification in platform specific units
+     * @return true if the file exists
+     */
+    static bool getFileStatus(const std::string &path, uint64_t &size, uint64_t &modificationTime);
+
+    /**
+     * List the regular files in a directory that end with a given extension.
+     * 
+     * Subdirectories are not searched, the names are sorted alphabetically.
+     * 
+     * @param directory path of the directory relative to the working directory
+     * @param extension required end of the file names including the dot, e.g. ".obj"
+     * @return names of the matching files without the directory, empty if the directory does not exist
+     */
+    static std::vector<std::string> listFiles(const std::string &directory, const std::string &extension);
+
+private:
+    const char *m_data = nullptr; /**< Start of the mapped view */
+    size_t m_size = 0; /**< Number of bytes in the mapped view */
+
+#ifdef _WIN32
+    void *m_fileHandle = nullptr; /**< Handle of the opened file */
+    void *m_mappingHandle = nullptr; /**< Handle of the file mapping object */
+#else
+    int m_fileDescriptor = -1; /**< Descriptor of the opened file */
+#endif
+
+};
+
+#endif //SLBVULKAN_MAPPEDFILE_H
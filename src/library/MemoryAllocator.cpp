@@ -0,0 +1,286 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+
+MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device)
+: m_device(device) {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    m_maxAllocations = deviceProperties.limits.maxMemoryAllocationCount;
+
+    //one pool for buffers and one for images per memory type
+    m_pools.resize(2 * m_memoryProperties.memoryTypeCount);
+    for(uint32_t p=0; p<m_pools.size(); p++) {
+        m_pools[p].memoryType = p / 2;
+        VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[p / 2].heapIndex].size;
+        m_pools[p].blockSize = std::max<VkDeviceSize>(std::min(memoryBlockSize, heapSize / 8), 1);
+    }
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    for(uint32_t i=0; i<m_memoryProperties.memoryTypeCount; i++) {
+        if(typeFilter & (1 << i) &&
+           (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("MEMORY ALLOCATOR ERROR: Could not find a suitable memory type");
+}
+
+void MemoryAllocator::allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, AllocationType type, MemoryAllocation &allocation) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t poolIndex = 2 * findMemoryType(requirements.memoryTypeBits, properties) + type;
+    auto &pool = m_pools[poolIndex];
+    VkDeviceSize size = std::max<VkDeviceSize>(requirements.size, 1);
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    //large resources would waste most of a block, they get one of their own
+    if(size > pool.blockSize / 2) {
+        uint32_t blockIndex = createBlock(poolIndex, size, true);
+        auto &block = pool.blocks[blockIndex];
+        block.numAllocations = 1;
+        allocation.memory = block.memory;
+        allocation.offset = 0;
+        allocation.size = size;
+        allocation.mapped = block.mapped;
+        allocation.poolIndex = poolIndex;
+        allocation.blockIndex = blockIndex;
+        return;
+    }
+
+    //best fit: the smallest free range that still fits the request after aligning its start
+    bool found = false;
+    FreeMemoryRange range{};
+    VkDeviceSize offset = 0;
+    for(uint32_t c=getSizeClass(size); c<numMemorySizeClasses && !found; c++) {
+        auto &sizeClass = pool.sizeClasses[c];
+        for(auto candidate = sizeClass.lower_bound({size, 0, 0}); candidate != sizeClass.end(); candidate++) {
+            offset = (candidate->offset + alignment - 1) / alignment * alignment;
+            if(offset + size <= candidate->offset + candidate->size) {
+                range = *candidate;
+                found = true;
+                break;
+            }
+        }
+    }
+    if(!found) {
+        range.blockIndex = createBlock(poolIndex, pool.blockSize, false);
+        range.offset = 0;
+        range.size = pool.blockSize;
+        offset = 0;
+    }
+
+    //the alignment padding in front and the rest behind the allocation remain free
+    eraseFreeRange(pool, range.blockIndex, range.offset, range.size);
+    if(offset > range.offset) {
+        insertFreeRange(pool, range.blockIndex, range.offset, offset - range.offset);
+    }
+    if(offset + size < range.offset + range.size) {
+        insertFreeRange(pool, range.blockIndex, offset + size, range.offset + range.size - offset - size);
+    }
+
+    auto &block = pool.blocks[range.blockIndex];
+    block.numAllocations++;
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.mapped = block.mapped != nullptr ? static_cast<char*>(block.mapped) + offset : nullptr;
+    allocation.poolIndex = poolIndex;
+    allocation.blockIndex = range.blockIndex;
+}
+
+void MemoryAllocator::free(MemoryAllocation &allocation) {
+    if(allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto &pool = m_pools[allocation.poolIndex];
+    uint32_t blockIndex = allocation.blockIndex;
+    auto &block = pool.blocks[blockIndex];
+    block.numAllocations--;
+    if(block.dedicated) {
+        releaseBlock(pool, blockIndex);
+        allocation = MemoryAllocation();
+        return;
+    }
+
+    //merge the range with free neighbours so that later requests find contiguous memory
+    VkDeviceSize offset = allocation.offset;
+    VkDeviceSize size = allocation.size;
+    auto next = block.freeRanges.lower_bound(offset);
+    if(next != block.freeRanges.end() && next->first == offset + size) {
+        size += next->second;
+        eraseFreeRange(pool, blockIndex, next->first, next->second);
+    }
+    next = block.freeRanges.lower_bound(offset);
+    if(next != block.freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if(previous->first + previous->second == offset) {
+            VkDeviceSize previousOffset = previous->first;
+            VkDeviceSize previousSize = previous->second;
+            eraseFreeRange(pool, blockIndex, previousOffset, previousSize);
+            offset = previousOffset;
+            size += previousSize;
+        }
+    }
+    insertFreeRange(pool, blockIndex, offset, size);
+
+    //empty blocks are released, but the last one is kept to avoid reallocating it for the next resource
+    if(block.numAllocations == 0) {
+        for(uint32_t b=0; b<pool.blocks.size(); b++) {
+            if(b != blockIndex && pool.blocks[b].memory != VK_NULL_HANDLE && !pool.blocks[b].dedicated) {
+                releaseBlock(pool, blockIndex);
+                break;
+            }
+        }
+    }
+    allocation = MemoryAllocation();
+}
+
+MemoryStatistics MemoryAllocator::getStatistics() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MemoryStatistics statistics;
+    for(auto &pool : m_pools) {
+        addStatistics(pool, statistics);
+    }
+    return statistics;
+}
+
+void MemoryAllocator::printStatistics() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MemoryStatistics total;
+    auto flags = std::cout.flags();
+    auto precision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(1);
+    for(uint32_t p=0; p<m_pools.size(); p++) {
+        MemoryStatistics statistics;
+        addStatistics(m_pools[p], statistics);
+        addStatistics(m_pools[p], total);
+        if(statistics.numBlocks == 0) {
+            continue;
+        }
+        std::cout << "   MEMORY ALLOCATOR: Memory type " << m_pools[p].memoryType << (p % 2 == bufferAllocation ? " buffers: " : " images: ")
+            << statistics.numAllocations << " allocations in " << statistics.numBlocks << " blocks, "
+            << statistics.usedBytes / 1048576.0 << " of " << statistics.blockBytes / 1048576.0 << " MB used, "
+            << 100.0f * statistics.fragmentation << "% fragmentation" << std::endl;
+    }
+    std::cout << "   MEMORY ALLOCATOR: Total " << total.numAllocations << " allocations in " << total.numBlocks << " blocks, "
+        << total.usedBytes / 1048576.0 << " of " << total.blockBytes / 1048576.0 << " MB used, "
+        << 100.0f * total.fragmentation << "% fragmentation" << std::endl;
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
+void MemoryAllocator::cleanUp() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t numLeaked = 0;
+    for(auto &pool : m_pools) {
+        for(uint32_t b=0; b<pool.blocks.size(); b++) {
+            if(pool.blocks[b].memory != VK_NULL_HANDLE) {
+                numLeaked += pool.blocks[b].numAllocations;
+                releaseBlock(pool, b);
+            }
+        }
+        pool.blocks.clear();
+    }
+    if(numLeaked > 0) {
+        std::cout << "   MEMORY ALLOCATOR: " << numLeaked << " allocations were not freed before clean up" << std::endl;
+    }
+}
+
+void MemoryAllocator::addStatistics(const MemoryPool &pool, MemoryStatistics &statistics) {
+    for(auto &block : pool.blocks) {
+        if(block.memory == VK_NULL_HANDLE) {
+            continue;
+        }
+        statistics.numBlocks++;
+        statistics.numAllocations += block.numAllocations;
+        statistics.blockBytes += block.size;
+        VkDeviceSize freeBytes = 0;
+        VkDeviceSize largestFreeRange = 0;
+        for(auto &range : block.freeRanges) {
+            freeBytes += range.second;
+            largestFreeRange = std::max(largestFreeRange, range.second);
+        }
+        statistics.freeBytes += freeBytes;
+        statistics.largestFreeRange = std::max(statistics.largestFreeRange, largestFreeRange);
+        statistics.contiguousFreeBytes += largestFreeRange;
+        statistics.usedBytes += block.size - freeBytes;
+    }
+    statistics.fragmentation = 0.0f;
+    if(statistics.freeBytes > 0) {
+        statistics.fragmentation = 1.0f - static_cast<float>(statistics.contiguousFreeBytes) / static_cast<float>(statistics.freeBytes);
+    }
+}
+
+uint32_t MemoryAllocator::createBlock(uint32_t poolIndex, VkDeviceSize size, bool dedicated) {
+    if(m_numDeviceAllocations >= m_maxAllocations) {
+        throw std::runtime_error("MEMORY ALLOCATOR ERROR: Reached the maximum number of device memory allocations.");
+    }
+    auto &pool = m_pools[poolIndex];
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = pool.memoryType;
+    VkDeviceMemory memory;
+    if(vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("MEMORY ALLOCATOR ERROR: Could not allocate device memory.");
+    }
+    m_numDeviceAllocations++;
+
+    uint32_t blockIndex = 0;
+    while(blockIndex < pool.blocks.size() && pool.blocks[blockIndex].memory != VK_NULL_HANDLE) {
+        blockIndex++;
+    }
+    if(blockIndex == pool.blocks.size()) {
+        pool.blocks.emplace_back();
+    }
+    auto &block = pool.blocks[blockIndex];
+    block.memory = memory;
+    block.size = size;
+    block.dedicated = dedicated;
+    block.numAllocations = 0;
+    if(m_memoryProperties.memoryTypes[pool.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &block.mapped);
+    }
+    if(!dedicated) {
+        insertFreeRange(pool, blockIndex, 0, size);
+    }
+    return blockIndex;
+}
+
+void MemoryAllocator::releaseBlock(MemoryPool &pool, uint32_t blockIndex) {
+    auto &block = pool.blocks[blockIndex];
+    for(auto &range : block.freeRanges) {
+        pool.sizeClasses[getSizeClass(range.second)].erase({range.second, blockIndex, range.first});
+    }
+    //freeing the memory also removes its mapping
+    vkFreeMemory(m_device, block.memory, nullptr);
+    block = MemoryBlock();
+    m_numDeviceAllocations--;
+}
+
+void MemoryAllocator::insertFreeRange(MemoryPool &pool, uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size) {
+    pool.blocks[blockIndex].freeRanges[offset] = size;
+    pool.sizeClasses[getSizeClass(size)].insert({size, blockIndex, offset});
+}
+
+void MemoryAllocator::eraseFreeRange(MemoryPool &pool, uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size) {
+    pool.blocks[blockIndex].freeRanges.erase(offset);
+    pool.sizeClasses[getSizeClass(size)].erase({size, blockIndex, offset});
+}
+
+uint32_t MemoryAllocator::getSizeClass(VkDeviceSize size) {
+    uint32_t sizeClass = 0;
+    while(size > 1) {
+        size >>= 1;
+        sizeClass++;
+    }
+    return sizeClass;
+}
\ No newline at end of file
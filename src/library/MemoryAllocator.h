@@ -0,0 +1,220 @@
+#ifndef SLBVULKAN_MEMORYALLOCATOR_H
+#define SLBVULKAN_MEMORYALLOCATOR_H
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <iostream>
+#include <vector>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+/** Size of the device memory blocks resources are placed in, smaller heaps use an eighth of their size instead */
+const VkDeviceSize memoryBlockSize = 64 * 1024 * 1024;
+
+/** Number of size classes, free ranges of 2^c up to 2^(c+1)-1 bytes are listed in class c */
+const uint32_t numMemorySizeClasses = 64;
+
+/**
+ * Kinds of resources memory is allocated for.
+ *
+ * Buffers and images are placed in separate pools,
+ * so that linear and optimal resources never share a page of size bufferImageGranularity.
+ */
+enum AllocationType {
+    bufferAllocation,
+    imageAllocation
+};
+
+/**
+ * Range of device memory a buffer or image is bound to.
+ */
+struct MemoryAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE; /**< Device memory block containing the range */
+    VkDeviceSize offset = 0; /**< Start of the range inside the block */
+    VkDeviceSize size = 0; /**< Number of bytes in the range */
+    void *mapped = nullptr; /**< Host address of the range if the memory is host visible, nullptr otherwise */
+    uint32_t poolIndex = 0; /**< Index of the pool the block belongs to */
+    uint32_t blockIndex = 0; /**< Index of the block inside its pool */
+};
+
+/**
+ * Usage of the device memory allocated by a memory allocator or one of its pools.
+ */
+struct MemoryStatistics {
+    uint32_t numBlocks = 0; /**< Number of device memory allocations, including dedicated ones */
+    uint32_t numAllocations = 0; /**< Number of ranges handed out to buffers and images */
+    VkDeviceSize blockBytes = 0; /**< Total size of all blocks */
+    VkDeviceSize usedBytes = 0; /**< Bytes covered by allocated ranges */
+    VkDeviceSize freeBytes = 0; /**< Bytes in the blocks that are not used, including alignment padding */
+    VkDeviceSize largestFreeRange = 0; /**< Size of the largest contiguous free range */
+    VkDeviceSize contiguousFreeBytes = 0; /**< Sum of the largest free range of each block */
+    float fragmentation = 0.0f; /**< 1 - contiguousFreeBytes / freeBytes, 0 if the free memory of each block is contiguous */
+};
+
+/**
+ * Unused range inside a block, ordered by size to find the smallest range that fits a request.
+ */
+struct FreeMemoryRange {
+    VkDeviceSize size; /**< Number of bytes in the range */
+    uint32_t blockIndex; /**< Index of the block inside its pool */
+    VkDeviceSize offset; /**< Start of the range inside the block */
+
+    bool operator<(const FreeMemoryRange &other) const {
+        if(size != other.size) {
+            return size < other.size;
+        }
+        if(blockIndex != other.blockIndex) {
+            return blockIndex < other.blockIndex;
+        }
+        return offset < other.offset;
+    }
+};
+
+/**
+ * Single vkAllocateMemory allocation that buffers and images are placed in.
+ */
+struct MemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE; /**< Vulkan handle of the memory, VK_NULL_HANDLE if the slot is unused */
+    VkDeviceSize size = 0; /**< Size of the block in bytes */
+    void *mapped = nullptr; /**< Host address of the block if the memory is host visible (persistent mapping) */
+    bool dedicated = false; /**< True if the block was allocated for a single large resource */
+    uint32_t numAllocations = 0; /**< Number of ranges currently handed out from the block */
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges; /**< Offsets and sizes of the unused ranges, adjacent ranges are merged */
+};
+
+/**
+ * Blocks of one memory type used for one kind of resource.
+ */
+struct MemoryPool {
+    uint32_t memoryType = 0; /**< Index of the memory type all blocks are allocated from */
+    VkDeviceSize blockSize = memoryBlockSize; /**< Size of the blocks, larger requests get a dedicated block */
+    std::vector<MemoryBlock> blocks; /**< Blocks of the pool, unused slots are reused for new blocks */
+    std::array<std::set<FreeMemoryRange>, numMemorySizeClasses> sizeClasses; /**< Free ranges of all blocks (segregated free lists) */
+};
+
+/**
+ * Sub-allocator placing buffers and images in large blocks of device memory.
+ *
+ * Allocating device memory per resource is slow and limited to maxMemoryAllocationCount allocations,
+ * which a scene with a few thousand meshes easily exceeds.
+ * Instead there is a pool per memory type and resource type that allocates blocks of memoryBlockSize bytes.
+ * Free ranges are kept in segregated free lists by size class and the smallest fitting range is used (best fit),
+ * freed ranges are merged with their neighbours to keep fragmentation low.
+ * Resources larger than half a block get a dedicated block of their own.
+ * Host visible blocks stay mapped for their entire lifetime.
+ * All functions are thread safe.
+ */
+class MemoryAllocator {
+public:
+    /**
+     * Set up an empty pool for each memory type of the physical device.
+     *
+     * @param physicalDevice physical device providing memory types and limits
+     * @param device logical device the memory is allocated with
+     */
+    MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+
+    /**
+     * Choose a memory type matching the properties of the physical device.
+     *
+     * @param typeFilter selection of memory types to choose from (encoded as a bit mask)
+     * @param properties requirements the memory type has to meet
+     * @return suitable memory type
+     */
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    /**
+     * Reserve a range of device memory for a buffer or image.
+     *
+     * @param requirements size, alignment, and memory types required by the resource
+     * @param properties properties the memory has to fulfil
+     * @param type kind of resource the memory is bound to
+     * @param[out] allocation range the resource has to be bound to
+     */
+    void allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, AllocationType type, MemoryAllocation &allocation);
+
+    /**
+     * Return a range to its block.
+     *
+     * Blocks without any allocations are released unless they are the last block of their pool.
+     * Does nothing if the allocation is empty.
+     *
+     * @param allocation range to free, reset to an empty allocation
+     */
+    void free(MemoryAllocation &allocation);
+
+    /**
+     * Sum up the usage of all pools.
+     */
+    MemoryStatistics getStatistics();
+
+    /**
+     * Print the usage of all pools that contain blocks.
+     */
+    void printStatistics();
+
+    /**
+     * Release all blocks.
+     *
+     * Has to be called before the logical device is destroyed.
+     */
+    void cleanUp();
+
+private:
+    /**
+     * Sum up the usage of a pool.
+     *
+     * @param pool pool to analyze
+     * @param[out] statistics statistics the usage of the pool is added to
+     */
+    static void addStatistics(const MemoryPool &pool, MemoryStatistics &statistics);
+
+    /**
+     * Allocate a new block and map it if the memory is host visible.
+     *
+     * @param poolIndex index of the pool the block is added to
+     * @param size size of the block in bytes
+     * @param dedicated true if the block is allocated for a single resource
+     * @return index of the block inside the pool
+     */
+    uint32_t createBlock(uint32_t poolIndex, VkDeviceSize size, bool dedicated);
+
+    /**
+     * Free the device memory of a block and mark its slot as unused.
+     *
+     * @param pool pool containing the block
+     * @param blockIndex index of the block inside the pool
+     */
+    void releaseBlock(MemoryPool &pool, uint32_t blockIndex);
+
+    /**
+     * Add a free range to its block and to the matching size class.
+     */
+    static void insertFreeRange(MemoryPool &pool, uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size);
+
+    /**
+     * Remove a free range from its block and from its size class.
+     */
+    static void eraseFreeRange(MemoryPool &pool, uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size);
+
+    /**
+     * Return the size class a range of the given size is listed in.
+     */
+    static uint32_t getSizeClass(VkDeviceSize size);
+
+    VkDevice m_device = VK_NULL_HANDLE; /**< Logical device the memory is allocated with */
+    VkPhysicalDeviceMemoryProperties m_memoryProperties; /**< Memory types and heaps of the physical device */
+    uint32_t m_maxAllocations = 0; /**< Maximum number of device memory allocations supported by the physical device */
+    uint32_t m_numDeviceAllocations = 0; /**< Number of blocks currently allocated */
+
+    std::vector<MemoryPool> m_pools; /**< Pools for each combination of memory type and allocation type */
+    std::mutex m_mutex; /**< Guards the pools against concurrent allocation */
+
+};
+
+#endif //SLBVULKAN_MEMORYALLOCATOR_H
\ No newline at end of file
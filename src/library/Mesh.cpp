@@ -1,5 +1,15 @@
 #include "Mesh.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <thread>
+
+VertexFormat Mesh::m_vertexFormat = fullVertexFormat;
+bool Mesh::m_splitVertexStreams = false;
+
 Mesh::Mesh() {
     
 }
@@ -8,16 +18,60 @@ bool Mesh::hasBuffers() {
     return m_hasBuffers;
 }
 
+uint32_t Mesh::getNumVertices() {
+    if(m_mappedFile != nullptr) {
+        return m_numMappedVertices;
+    }
+    return static_cast<uint32_t>(m_vertices.size());
+}
+
+uint32_t Mesh::getNumIndices() {
+    if(m_mappedFile != nullptr) {
+        return m_numMappedIndices;
+    }
+    return static_cast<uint32_t>(m_indices.size());
+}
+
+std::vector<Vertex> &Mesh::getVertices() {
+    copyMappedGeometry();
+    return m_vertices;
+}
+
+std::vector<uint32_t> &Mesh::getIndices() {
+    copyMappedGeometry();
+    return m_indices;
+}
+
+void Mesh::setMappedGeometry(std::shared_ptr<MappedFile> &file, const Vertex *vertices, uint32_t numVertices, const uint32_t *indices, uint32_t numIndices) {
+    if(m_hasBuffers) {
+        throw std::runtime_error("MESH ERROR: Buffers have already been created.");
+    }
+
+    m_vertices.clear();
+    m_indices.clear();
+    m_lods.clear();
+    m_meshlets.clear();
+    m_boundingBox = BoundingBox();
+    m_mappedFile = file;
+    m_mappedVertices = vertices;
+    m_mappedIndices = indices;
+    m_numMappedVertices = numVertices;
+    m_numMappedIndices = numIndices;
+}
+
 void Mesh::addVertex(glm::vec3 position, glm::vec3 normal, glm::vec2 texCoord, glm::vec3 tangent) {
+    copyMappedGeometry();
     m_vertices.emplace_back(Vertex{
         glm::vec4(position, 1.0f),
         glm::normalize(normal),
         texCoord,
-        glm::normalize(tangent)
+        glm::vec4(glm::normalize(tangent), 1.0f)
     });
+    m_boundingBox = BoundingBox();
 }
 
 void Mesh::addIndex(uint32_t index) {
+    copyMappedGeometry();
     m_indices.emplace_back(index);
 }
 
@@ -153,91 +207,1143 @@ void Mesh::addCone(glm::vec3 base, float radius, float height, int resolution) {
     }
 }
 
-void Mesh::calculateTangents() {
-    for(size_t i=0; i<m_indices.size()/3; i++) {
-        std::array<uint32_t,3> triIndices = {
-            m_indices[3*i],
-            m_indices[3*i+1],
-            m_indices[3*i+2]
+void Mesh::calculateTangents(uint32_t numThreads) {
+    copyMappedGeometry();
+    //coarser levels of detail share the vertices and would count triangles twice
+    auto numTriangles = getLod(0).numIndices / 3;
+    auto numCorners = 3 * numTriangles;
+    auto numVertices = static_cast<uint32_t>(m_vertices.size());
+    if(numTriangles == 0) {
+        return;
+    }
+
+    //chunks are handed out one at a time, so threads finishing early take over the remaining work
+    if(numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    auto runChunks = [numThreads](uint32_t numElements, const std::function<void(uint32_t, uint32_t)> &task) {
+        uint32_t numChunks = (numElements + tangentChunkSize - 1) / tangentChunkSize;
+        std::atomic<uint32_t> nextChunk(0);
+        auto processChunks = [&]() {
+            for(uint32_t chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++) {
+                task(chunk * tangentChunkSize, std::min(numElements, (chunk + 1) * tangentChunkSize));
+            }
         };
-        for(size_t j=0; j<3; j++) {
-            m_vertices[m_indices[3*i+j]].tangent = getTangent(
-                triIndices[j],
-                triIndices[(j+1)%3],
-                triIndices[(j+2)%3]
-            );
+        std::vector<std::thread> threads;
+        for(uint32_t t=1; t<std::min(numThreads, numChunks); t++) {
+            threads.emplace_back(processChunks);
+        }
+        processChunks();
+        for(auto &thread : threads) {
+            thread.join();
+        }
+    };
+
+    //tangent and bitangent direction of each triangle scaled by its area, and the angle at each corner
+    std::vector<glm::vec3> faceTangents(numTriangles);
+    std::vector<glm::vec3> faceBitangents(numTriangles);
+    std::vector<float> cornerAngles(numCorners);
+    runChunks(numTriangles, [&](uint32_t first, uint32_t last) {
+        for(uint32_t batch=first; batch<last; batch+=tangentBatchSize) {
+            calculateTriangleTangents(batch, std::min(tangentBatchSize, last - batch), &faceTangents[batch], &faceBitangents[batch], &cornerAngles[3 * batch]);
+        }
+    });
+
+    //corners sorted by vertex, so each vertex can sum up its own triangles without synchronization
+    std::vector<uint32_t> cornerStarts(numVertices + 1, 0);
+    for(uint32_t c=0; c<numCorners; c++) {
+        cornerStarts[m_indices[c] + 1]++;
+    }
+    for(uint32_t v=0; v<numVertices; v++) {
+        cornerStarts[v + 1] += cornerStarts[v];
+    }
+    std::vector<uint32_t> vertexCorners(numCorners);
+    std::vector<uint32_t> insertPositions(cornerStarts.begin(), cornerStarts.end() - 1);
+    for(uint32_t c=0; c<numCorners; c++) {
+        vertexCorners[insertPositions[m_indices[c]]++] = c;
+    }
+
+    runChunks(numVertices, [&](uint32_t first, uint32_t last) {
+        for(uint32_t v=first; v<last; v++) {
+            glm::vec3 tangent = glm::vec3(0.0f);
+            glm::vec3 bitangent = glm::vec3(0.0f);
+            for(uint32_t c=cornerStarts[v]; c<cornerStarts[v + 1]; c++) {
+                auto corner = vertexCorners[c];
+                tangent += cornerAngles[corner] * faceTangents[corner / 3];
+                bitangent += cornerAngles[corner] * faceBitangents[corner / 3];
+            }
+
+            //Gram-Schmidt against the normal, the handedness tells whether the texture is mirrored
+            auto normal = m_vertices[v].normal;
+            tangent -= normal * glm::dot(normal, tangent);
+            if(glm::length(tangent) < 1e-12f) {
+                //degenerate texture coordinates, any tangent perpendicular to the normal will do
+                tangent = glm::cross(normal, std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+            }
+            tangent = glm::length(tangent) > 0.0f ? glm::normalize(tangent) : glm::vec3(1.0f, 0.0f, 0.0f);
+            float handedness = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+            m_vertices[v].tangent = glm::vec4(tangent, handedness);
+        }
+    });
+}
+
+void Mesh::calculateTriangleTangents(uint32_t firstTriangle, uint32_t numTriangles, glm::vec3 *tangents, glm::vec3 *bitangents, float *angles) {
+    //the attributes of the batch are gathered into arrays with one lane per triangle, which the compiler can vectorize
+    float px[3][tangentBatchSize], py[3][tangentBatchSize], pz[3][tangentBatchSize];
+    float tu[3][tangentBatchSize], tv[3][tangentBatchSize];
+    for(uint32_t corner=0; corner<3; corner++) {
+        for(uint32_t lane=0; lane<tangentBatchSize; lane++) {
+            //unused lanes repeat the last triangle
+            auto &vertex = m_vertices[m_indices[3 * (firstTriangle + std::min(lane, numTriangles - 1)) + corner]];
+            px[corner][lane] = vertex.position.x;
+            py[corner][lane] = vertex.position.y;
+            pz[corner][lane] = vertex.position.z;
+            tu[corner][lane] = vertex.texCoord.x;
+            tv[corner][lane] = vertex.texCoord.y;
+        }
+    }
+
+    float tx[tangentBatchSize], ty[tangentBatchSize], tz[tangentBatchSize];
+    float bx[tangentBatchSize], by[tangentBatchSize], bz[tangentBatchSize];
+    float cornerCos[3][tangentBatchSize];
+    for(uint32_t lane=0; lane<tangentBatchSize; lane++) {
+        float e1x = px[1][lane] - px[0][lane], e1y = py[1][lane] - py[0][lane], e1z = pz[1][lane] - pz[0][lane];
+        float e2x = px[2][lane] - px[0][lane], e2y = py[2][lane] - py[0][lane], e2z = pz[2][lane] - pz[0][lane];
+        float e3x = px[2][lane] - px[1][lane], e3y = py[2][lane] - py[1][lane], e3z = pz[2][lane] - pz[1][lane];
+        float du1 = tu[1][lane] - tu[0][lane], dv1 = tv[1][lane] - tv[0][lane];
+        float du2 = tu[2][lane] - tu[0][lane], dv2 = tv[2][lane] - tv[0][lane];
+
+        //only the directions are needed, so the sign of the uv determinant replaces the division by it
+        float determinant = du1 * dv2 - du2 * dv1;
+        float orientation = determinant > 0.0f ? 1.0f : (determinant < 0.0f ? -1.0f : 0.0f);
+        float sx = (e1x * dv2 - e2x * dv1) * orientation, sy = (e1y * dv2 - e2y * dv1) * orientation, sz = (e1z * dv2 - e2z * dv1) * orientation;
+        float rx = (e2x * du1 - e1x * du2) * orientation, ry = (e2y * du1 - e1y * du2) * orientation, rz = (e2z * du1 - e1z * du2) * orientation;
+
+        float nx = e1y * e2z - e1z * e2y, ny = e1z * e2x - e1x * e2z, nz = e1x * e2y - e1y * e2x;
+        float area = 0.5f * std::sqrt(nx * nx + ny * ny + nz * nz);
+        float sLength = std::sqrt(sx * sx + sy * sy + sz * sz);
+        float rLength = std::sqrt(rx * rx + ry * ry + rz * rz);
+        float sScale = sLength > 0.0f ? area / sLength : 0.0f;
+        float rScale = rLength > 0.0f ? area / rLength : 0.0f;
+        tx[lane] = sx * sScale; ty[lane] = sy * sScale; tz[lane] = sz * sScale;
+        bx[lane] = rx * rScale; by[lane] = ry * rScale; bz[lane] = rz * rScale;
+
+        float l1 = std::sqrt(e1x * e1x + e1y * e1y + e1z * e1z);
+        float l2 = std::sqrt(e2x * e2x + e2y * e2y + e2z * e2z);
+        float l3 = std::sqrt(e3x * e3x + e3y * e3y + e3z * e3z);
+        float d0 = l1 * l2, d1 = l1 * l3, d2 = l2 * l3;
+        cornerCos[0][lane] = d0 > 0.0f ? (e1x * e2x + e1y * e2y + e1z * e2z) / d0 : 1.0f;
+        cornerCos[1][lane] = d1 > 0.0f ? -(e1x * e3x + e1y * e3y + e1z * e3z) / d1 : 1.0f;
+        cornerCos[2][lane] = d2 > 0.0f ? (e2x * e3x + e2y * e3y + e2z * e3z) / d2 : 1.0f;
+    }
+
+    for(uint32_t lane=0; lane<numTriangles; lane++) {
+        tangents[lane] = glm::vec3(tx[lane], ty[lane], tz[lane]);
+        bitangents[lane] = glm::vec3(bx[lane], by[lane], bz[lane]);
+        for(uint32_t corner=0; corner<3; corner++) {
+            angles[3 * lane + corner] = std::acos(glm::clamp(cornerCos[corner][lane], -1.0f, 1.0f));
+        }
+    }
+}
+
+uint32_t Mesh::getNumLods() {
+    return std::max(1u, static_cast<uint32_t>(m_lods.size()));
+}
+
+MeshLod Mesh::getLod(uint32_t level) {
+    if(m_lods.empty()) {
+        return MeshLod{0, getNumIndices(), 0.0f};
+    }
+    return m_lods[level];
+}
+
+void Mesh::setLods(const std::vector<MeshLod> &lods) {
+    m_lods = lods;
+}
+
+void Mesh::computeBounds() {
+    const Vertex *vertices = m_mappedFile != nullptr ? m_mappedVertices : m_vertices.data();
+    auto numVertices = getNumVertices();
+    m_boundingBox = BoundingBox();
+    m_boundingSphere = glm::vec4(0.0f);
+    if(numVertices == 0) {
+        return;
+    }
+
+    //every lane keeps its own extremes, they are only combined at the end
+    float minimum[3][boundsBatchSize];
+    float maximum[3][boundsBatchSize];
+    for(int axis=0; axis<3; axis++) {
+        for(uint32_t lane=0; lane<boundsBatchSize; lane++) {
+            minimum[axis][lane] = vertices[0].position[axis];
+            maximum[axis][lane] = vertices[0].position[axis];
+        }
+    }
+    uint32_t numBatched = numVertices / boundsBatchSize * boundsBatchSize;
+    for(uint32_t v=0; v<numBatched; v+=boundsBatchSize) {
+        for(int axis=0; axis<3; axis++) {
+            for(uint32_t lane=0; lane<boundsBatchSize; lane++) {
+                float coordinate = vertices[v + lane].position[axis];
+                minimum[axis][lane] = std::min(minimum[axis][lane], coordinate);
+                maximum[axis][lane] = std::max(maximum[axis][lane], coordinate);
+            }
+        }
+    }
+    for(uint32_t v=numBatched; v<numVertices; v++) {
+        for(int axis=0; axis<3; axis++) {
+            minimum[axis][0] = std::min(minimum[axis][0], vertices[v].position[axis]);
+            maximum[axis][0] = std::max(maximum[axis][0], vertices[v].position[axis]);
+        }
+    }
+    for(int axis=0; axis<3; axis++) {
+        for(uint32_t lane=0; lane<boundsBatchSize; lane++) {
+            m_boundingBox.minimum[axis] = std::min(m_boundingBox.minimum[axis], minimum[axis][lane]);
+            m_boundingBox.maximum[axis] = std::max(m_boundingBox.maximum[axis], maximum[axis][lane]);
+        }
+    }
+
+    glm::vec3 center = 0.5f * (m_boundingBox.minimum + m_boundingBox.maximum);
+    float radiusSquared[boundsBatchSize] = {};
+    for(uint32_t v=0; v<numBatched; v+=boundsBatchSize) {
+        for(uint32_t lane=0; lane<boundsBatchSize; lane++) {
+            float dx = vertices[v + lane].position.x - center.x;
+            float dy = vertices[v + lane].position.y - center.y;
+            float dz = vertices[v + lane].position.z - center.z;
+            radiusSquared[lane] = std::max(radiusSquared[lane], dx * dx + dy * dy + dz * dz);
+        }
+    }
+    for(uint32_t v=numBatched; v<numVertices; v++) {
+        auto offset = glm::vec3(vertices[v].position) - center;
+        radiusSquared[0] = std::max(radiusSquared[0], glm::dot(offset, offset));
+    }
+    float radius = 0.0f;
+    for(uint32_t lane=0; lane<boundsBatchSize; lane++) {
+        radius = std::max(radius, std::sqrt(radiusSquared[lane]));
+    }
+    m_boundingSphere = glm::vec4(center, radius);
+}
+
+BoundingBox Mesh::getBoundingBox() {
+    return m_boundingBox;
+}
+
+void Mesh::setBoundingBox(const BoundingBox &boundingBox) {
+    m_boundingBox = boundingBox;
+}
+
+glm::vec4 Mesh::getBoundingSphere() {
+    return m_boundingSphere;
+}
+
+void Mesh::setBoundingSphere(glm::vec4 boundingSphere) {
+    m_boundingSphere = boundingSphere;
+}
+
+void Mesh::generateLods(uint32_t numLevels) {
+    copyMappedGeometry();
+    //meshes this small are cheap to draw anyway
+    const uint32_t minTriangles = 64;
+
+    uint32_t numIndices = getLod(0).numIndices / 3 * 3;
+    m_indices.resize(numIndices);
+    m_lods = {MeshLod{0, numIndices, 0.0f}};
+    m_meshlets.clear();
+
+    std::vector<VertexKind> kinds;
+    std::vector<uint32_t> twins;
+    classifyVertices(numIndices, kinds, twins);
+    std::vector<Quadric> quadrics(m_vertices.size());
+    for(uint32_t i=0; i<numIndices; i+=3) {
+        auto quadric = getPlaneQuadric(glm::vec3(m_vertices[m_indices[i]].position), glm::vec3(m_vertices[m_indices[i + 1]].position), glm::vec3(m_vertices[m_indices[i + 2]].position));
+        for(uint32_t j=0; j<3; j++) {
+            addQuadric(quadrics[m_indices[i + j]], quadric);
+        }
+    }
+    //both vertices of a seam describe the same surface point
+    for(uint32_t v=0; v<m_vertices.size(); v++) {
+        if(twins[v] > v) {
+            addQuadric(quadrics[v], quadrics[twins[v]]);
+            quadrics[twins[v]] = quadrics[v];
+        }
+    }
+
+    //each level continues the simplification of the previous one
+    std::vector<uint32_t> indices(m_indices);
+    for(uint32_t level=1; level<numLevels; level++) {
+        auto numTriangles = static_cast<uint32_t>(indices.size() / 3);
+        if(numTriangles < 2 * minTriangles) {
+            break;
+        }
+        float error = collapseEdges(indices, quadrics, kinds, twins, numTriangles / 2);
+        if(indices.size() / 3 > numTriangles * 3 / 4) {
+            break;
         }
+
+        m_lods.emplace_back(MeshLod{
+            static_cast<uint32_t>(m_indices.size()),
+            static_cast<uint32_t>(indices.size()),
+            std::max(error, m_lods.back().error)
+        });
+        m_indices.insert(m_indices.end(), indices.begin(), indices.end());
+    }
+    if(m_lods.size() == 1) {
+        m_lods.clear();
+    }
+}
+
+uint32_t Mesh::selectLod(float pixelsPerUnit, float maxPixelError) {
+    for(uint32_t level=getNumLods()-1; level>0; level--) {
+        if(m_lods[level].error * pixelsPerUnit <= maxPixelError) {
+            return level;
+        }
+    }
+    return 0;
+}
+
+void Mesh::generateMeshlets() {
+    m_meshlets.clear();
+    auto lod = getLod(0);
+    const uint32_t *indices = m_mappedFile != nullptr ? m_mappedIndices : m_indices.data();
+
+    //vertices already referenced by the current meshlet are marked with its number
+    std::vector<uint32_t> meshletMarks(getNumVertices(), std::numeric_limits<uint32_t>::max());
+    Meshlet meshlet{};
+    meshlet.firstIndex = lod.firstIndex;
+    for(uint32_t i=lod.firstIndex; i+2<lod.firstIndex+lod.numIndices; i+=3) {
+        auto meshletNumber = static_cast<uint32_t>(m_meshlets.size());
+        uint32_t newVertices = 0;
+        for(uint32_t corner=0; corner<3; corner++) {
+            if(meshletMarks[indices[i + corner]] != meshletNumber) {
+                newVertices++;
+            }
+        }
+        if(meshlet.numVertices + newVertices > maxMeshletVertices || meshlet.numIndices / 3 + 1 > maxMeshletTriangles) {
+            computeMeshletBounds(meshlet);
+            m_meshlets.emplace_back(meshlet);
+            meshlet = Meshlet{};
+            meshlet.firstIndex = i;
+            meshletNumber++;
+        }
+
+        for(uint32_t corner=0; corner<3; corner++) {
+            if(meshletMarks[indices[i + corner]] != meshletNumber) {
+                meshletMarks[indices[i + corner]] = meshletNumber;
+                meshlet.numVertices++;
+            }
+        }
+        meshlet.numIndices += 3;
     }
+    if(meshlet.numIndices > 0) {
+        computeMeshletBounds(meshlet);
+        m_meshlets.emplace_back(meshlet);
+    }
+}
+
+const std::vector<Meshlet> &Mesh::getMeshlets() {
+    return m_meshlets;
 }
 
-glm::vec3 Mesh::getTangent(uint32_t i0, uint32_t i1, uint32_t i2) {
-    float u1 = m_vertices[i1].texCoord.x - m_vertices[i0].texCoord.x;
-    float u2 = m_vertices[i2].texCoord.x - m_vertices[i0].texCoord.x;
-    float v1 = m_vertices[i1].texCoord.y - m_vertices[i0].texCoord.y;
-    float v2 = m_vertices[i2].texCoord.y - m_vertices[i0].texCoord.y;
-    float invDenom = 1.0f / ((u1*v2) - (u2*v1));
-    float tx = ((v1-v2) * m_vertices[i0].position.x + v2 * m_vertices[i1].position.x - v1 * m_vertices[i2].position.x) * invDenom;
-    float ty = ((v1-v2) * m_vertices[i0].position.y + v2 * m_vertices[i1].position.y - v1 * m_vertices[i2].position.y) * invDenom;
-    float tz = ((v1-v2) * m_vertices[i0].position.z + v2 * m_vertices[i1].position.z - v1 * m_vertices[i2].position.z) * invDenom;
-    //float bx = ((u2-u1) * m_vertices[i0].position.x - u2 * m_vertices[i1].position.x + u1 * m_vertices[i2].position.x) * invDenom;
-    //float by = ((u2-u1) * m_vertices[i0].position.y - u2 * m_vertices[i1].position.y + u1 * m_vertices[i2].position.y) * invDenom;
-    //float bz = ((u2-u1) * m_vertices[i0].position.z - u2 * m_vertices[i1].position.z + u1 * m_vertices[i2].position.z) * invDenom;
-    glm::vec3 tangent = glm::vec3(tx, ty, tz);
-    auto normal = m_vertices[i0].normal;
-    return glm::normalize(tangent - normal * glm::dot(normal, tangent));
+void Mesh::setMeshlets(const std::vector<Meshlet> &meshlets) {
+    m_meshlets = meshlets;
 }
 
-void Mesh::createBuffers(std::shared_ptr<Context> &context) {
+bool Mesh::isMeshletBackFacing(const Meshlet &meshlet, glm::vec3 cameraPosition) {
+    auto center = glm::vec3(meshlet.boundingSphere);
+    auto toCenter = center - cameraPosition;
+    return glm::dot(toCenter, glm::vec3(meshlet.normalCone)) >= meshlet.normalCone.w * glm::length(toCenter) + meshlet.boundingSphere.w;
+}
+
+void Mesh::optimize() {
+    copyMappedGeometry();
+    m_meshlets.clear();
+    if(m_lods.empty()) {
+        m_indices.resize(m_indices.size() / 3 * 3);
+    }
+    if(m_indices.empty()) {
+        return;
+    }
+
+    for(uint32_t level=0; level<getNumLods(); level++) {
+        auto lod = getLod(level);
+        optimizeVertexCache(lod.firstIndex, lod.numIndices, vertexCacheSize);
+        optimizeOverdraw(lod.firstIndex, lod.numIndices, vertexCacheSize, 1.05f);
+    }
+    optimizeVertexFetch();
+}
+
+float Mesh::getACMR(uint32_t cacheSize) {
+    auto lod = getLod(0);
+    uint32_t numTriangles = lod.numIndices / 3;
+    if(numTriangles == 0) {
+        return 0.0f;
+    }
+    const uint32_t *indexData = (m_mappedFile != nullptr ? m_mappedIndices : m_indices.data()) + lod.firstIndex;
+    return static_cast<float>(simulateVertexCache(indexData, numTriangles * 3, getNumVertices(), cacheSize)) / static_cast<float>(numTriangles);
+}
+
+float Mesh::getATVR(uint32_t cacheSize) {
+    if(getNumVertices() == 0) {
+        return 0.0f;
+    }
+    auto lod = getLod(0);
+    const uint32_t *indexData = (m_mappedFile != nullptr ? m_mappedIndices : m_indices.data()) + lod.firstIndex;
+    return static_cast<float>(simulateVertexCache(indexData, lod.numIndices / 3 * 3, getNumVertices(), cacheSize)) / static_cast<float>(getNumVertices());
+}
+
+void Mesh::setVertexFormat(VertexFormat format) {
+    m_vertexFormat = format;
+}
+
+VertexFormat Mesh::getVertexFormat() {
+    return m_vertexFormat;
+}
+
+void Mesh::setSplitVertexStreams(bool split) {
+    m_splitVertexStreams = split;
+}
+
+bool Mesh::hasSplitVertexStreams() {
+    return m_splitVertexStreams;
+}
+
+void Mesh::getVertexInput(bool readsAttributes, std::vector<VkVertexInputBindingDescription> &bindings, std::vector<VkVertexInputAttributeDescription> &attributes) {
+    auto binding = Vertex::getBindingDescription();
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    if(m_vertexFormat == packedVertexFormat) {
+        binding = PackedVertex::getBindingDescription();
+        attributeDescriptions = PackedVertex::getAttributeDescriptions();
+    }
+    //the position is the first attribute, everything from the normal on belongs to the attribute stream
+    auto positionSize = attributeDescriptions[1].offset;
+
+    bindings.clear();
+    attributes.clear();
+    if(!m_splitVertexStreams) {
+        bindings.emplace_back(binding);
+        attributes.emplace_back(attributeDescriptions[0]);
+        if(readsAttributes) {
+            attributes.insert(attributes.end(), attributeDescriptions.begin() + 1, attributeDescriptions.end());
+        }
+        return;
+    }
+
+    auto attributeBinding = binding;
+    attributeBinding.binding = 1;
+    attributeBinding.stride = binding.stride - positionSize;
+    binding.stride = positionSize;
+    bindings.emplace_back(binding);
+    attributes.emplace_back(attributeDescriptions[0]);
+    if(readsAttributes) {
+        bindings.emplace_back(attributeBinding);
+        for(size_t a=1; a<attributeDescriptions.size(); a++) {
+            attributeDescriptions[a].binding = 1;
+            attributeDescriptions[a].offset -= positionSize;
+            attributes.emplace_back(attributeDescriptions[a]);
+        }
+    }
+}
+
+glm::vec4 Mesh::getPositionOffset() {
+    return m_positionOffset;
+}
+
+glm::vec4 Mesh::getPositionScale() {
+    return m_positionScale;
+}
+
+Quadric Mesh::getPlaneQuadric(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2) {
+    Quadric quadric;
+    glm::dvec3 normal = glm::cross(glm::dvec3(p1) - glm::dvec3(p0), glm::dvec3(p2) - glm::dvec3(p0));
+    double length = glm::length(normal);
+    if(length <= 0.0) {
+        return quadric;
+    }
+    double area = 0.5 * length;
+    normal /= length;
+    double d = -glm::dot(normal, glm::dvec3(p0));
+
+    quadric.xx = normal.x * normal.x;
+    quadric.xy = normal.x * normal.y;
+    quadric.xz = normal.x * normal.z;
+    quadric.xw = normal.x * d;
+    quadric.yy = normal.y * normal.y;
+    quadric.yz = normal.y * normal.z;
+    quadric.yw = normal.y * d;
+    quadric.zz = normal.z * normal.z;
+    quadric.zw = normal.z * d;
+    quadric.ww = d * d;
+    quadric.xx *= area;
+    quadric.xy *= area;
+    quadric.xz *= area;
+    quadric.xw *= area;
+    quadric.yy *= area;
+    quadric.yz *= area;
+    quadric.yw *= area;
+    quadric.zz *= area;
+    quadric.zw *= area;
+    quadric.ww *= area;
+    quadric.weight = area;
+    return quadric;
+}
+
+void Mesh::addQuadric(Quadric &target, const Quadric &source) {
+    target.xx += source.xx;
+    target.xy += source.xy;
+    target.xz += source.xz;
+    target.xw += source.xw;
+    target.yy += source.yy;
+    target.yz += source.yz;
+    target.yw += source.yw;
+    target.zz += source.zz;
+    target.zw += source.zw;
+    target.ww += source.ww;
+    target.weight += source.weight;
+}
+
+double Mesh::evaluateQuadric(const Quadric &quadric, glm::vec3 point) {
+    double x = point.x, y = point.y, z = point.z;
+    double error = quadric.xx * x * x + quadric.yy * y * y + quadric.zz * z * z + quadric.ww
+        + 2.0 * (quadric.xy * x * y + quadric.xz * x * z + quadric.yz * y * z + quadric.xw * x + quadric.yw * y + quadric.zw * z);
+    if(quadric.weight <= 0.0) {
+        return 0.0;
+    }
+    //rounding can make the result slightly negative
+    return std::max(0.0, error / quadric.weight);
+}
+
+void Mesh::classifyVertices(uint32_t numIndices, std::vector<VertexKind> &kinds, std::vector<uint32_t> &twins) {
+    auto numVertices = static_cast<uint32_t>(m_vertices.size());
+
+    //vertices with equal positions are grouped by sorting them
+    std::vector<uint32_t> order(numVertices);
+    for(uint32_t v=0; v<numVertices; v++) {
+        order[v] = v;
+    }
+    auto positionLess = [&](uint32_t a, uint32_t b) {
+        const auto &pa = m_vertices[a].position;
+        const auto &pb = m_vertices[b].position;
+        return pa.x < pb.x || (pa.x == pb.x && (pa.y < pb.y || (pa.y == pb.y && pa.z < pb.z)));
+    };
+    std::sort(order.begin(), order.end(), positionLess);
+    std::vector<uint32_t> positionIds(numVertices);
+    std::vector<uint32_t> positionSizes;
+    for(uint32_t i=0; i<numVertices; i++) {
+        if(i == 0 || positionLess(order[i - 1], order[i])) {
+            positionSizes.emplace_back(0);
+        }
+        positionIds[order[i]] = static_cast<uint32_t>(positionSizes.size() - 1);
+        positionSizes.back()++;
+    }
+
+    //edges between positions are counted to find borders and non-manifold geometry
+    std::vector<uint64_t> edges;
+    edges.reserve(numIndices);
+    for(uint32_t i=0; i<numIndices; i+=3) {
+        for(uint32_t j=0; j<3; j++) {
+            uint64_t a = positionIds[m_indices[i + j]];
+            uint64_t b = positionIds[m_indices[i + (j + 1) % 3]];
+            if(a != b) {
+                edges.emplace_back(std::min(a, b) << 32 | std::max(a, b));
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    std::vector<VertexKind> positionKinds(positionSizes.size(), manifoldVertex);
+    for(uint32_t p=0; p<positionSizes.size(); p++) {
+        if(positionSizes[p] == 2) {
+            positionKinds[p] = seamVertex;
+        } else if(positionSizes[p] > 2) {
+            positionKinds[p] = lockedVertex;
+        }
+    }
+    for(size_t e=0; e<edges.size();) {
+        size_t count = 1;
+        while(e + count < edges.size() && edges[e + count] == edges[e]) {
+            count++;
+        }
+        for(auto p : {static_cast<uint32_t>(edges[e] >> 32), static_cast<uint32_t>(edges[e] & 0xFFFFFFFF)}) {
+            if(count > 2) {
+                positionKinds[p] = lockedVertex;
+            } else if(count == 1) {
+                positionKinds[p] = positionKinds[p] == manifoldVertex || positionKinds[p] == borderVertex ? borderVertex : lockedVertex;
+            }
+        }
+        e += count;
+    }
+
+    kinds.resize(numVertices);
+    twins.resize(numVertices);
+    for(uint32_t i=0; i<numVertices; i++) {
+        uint32_t v = order[i];
+        kinds[v] = positionKinds[positionIds[v]];
+        twins[v] = v;
+        if(kinds[v] == seamVertex) {
+            twins[v] = i > 0 && positionIds[order[i - 1]] == positionIds[v] ? order[i - 1] : order[i + 1];
+        }
+    }
+}
+
+float Mesh::collapseEdges(std::vector<uint32_t> &indices, std::vector<Quadric> &quadrics, const std::vector<VertexKind> &kinds, const std::vector<uint32_t> &twins, uint32_t targetTriangles) {
+    auto numVertices = static_cast<uint32_t>(m_vertices.size());
+    double maxCost = 0.0;
+
+    struct Collapse {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> adjacencyOffsets(numVertices + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<bool> touched(numVertices);
+    std::vector<uint32_t> remap(numVertices);
+
+    //a collapse is valid if no triangle flips and the surface stays manifold, the number of triangles removed by it is counted
+    std::vector<uint32_t> neighbors;
+    auto checkCollapse = [&](uint32_t from, uint32_t to, uint32_t &numDegenerate) {
+        numDegenerate = 0;
+        neighbors.clear();
+        glm::vec3 target = glm::vec3(m_vertices[to].position);
+        for(uint32_t a=adjacencyOffsets[from]; a<adjacencyOffsets[from + 1]; a++) {
+            const uint32_t *triangle = &indices[3 * adjacency[a]];
+            neighbors.insert(neighbors.end(), triangle, triangle + 3);
+            if(triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                numDegenerate++;
+                continue;
+            }
+            glm::vec3 p[3], q[3];
+            for(uint32_t j=0; j<3; j++) {
+                p[j] = glm::vec3(m_vertices[triangle[j]].position);
+                q[j] = triangle[j] == from ? target : p[j];
+            }
+            if(glm::dot(glm::cross(p[1] - p[0], p[2] - p[0]), glm::cross(q[1] - q[0], q[2] - q[0])) <= 0.0f) {
+                return false;
+            }
+        }
+
+        //vertices adjacent to both ends may only be the ones opposite of the collapsed edge
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        uint32_t numShared = 0;
+        for(uint32_t a=adjacencyOffsets[to]; a<adjacencyOffsets[to + 1]; a++) {
+            for(uint32_t j=0; j<3; j++) {
+                uint32_t v = indices[3 * adjacency[a] + j];
+                auto neighbor = std::lower_bound(neighbors.begin(), neighbors.end(), v);
+                if(v != from && v != to && neighbor != neighbors.end() && *neighbor == v) {
+                    numShared++;
+                    //every shared vertex is only counted once
+                    neighbors.erase(neighbor);
+                }
+            }
+        }
+        return numShared == numDegenerate;
+    };
+    auto touchSurroundings = [&](uint32_t v) {
+        for(uint32_t a=adjacencyOffsets[v]; a<adjacencyOffsets[v + 1]; a++) {
+            for(uint32_t j=0; j<3; j++) {
+                touched[indices[3 * adjacency[a] + j]] = true;
+            }
+        }
+    };
+
+    while(indices.size() / 3 > targetTriangles) {
+        auto numTriangles = static_cast<uint32_t>(indices.size() / 3);
+
+        //triangles adjacent to each vertex, stored consecutively
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for(auto index : indices) {
+            adjacencyOffsets[index + 1]++;
+        }
+        for(uint32_t v=0; v<numVertices; v++) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(indices.size());
+        std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for(uint32_t i=0; i<indices.size(); i++) {
+            adjacency[adjacencyFill[indices[i]]++] = i / 3;
+        }
+
+        //moving a vertex onto its neighbor costs the combined plane distances at the new position,
+        //differing normals are penalized relative to the length of the edge
+        collapses.clear();
+        for(uint32_t i=0; i<indices.size(); i++) {
+            uint32_t from = indices[i];
+            uint32_t to = indices[i - i % 3 + (i % 3 + 1) % 3];
+            for(uint32_t k=0; k<2; k++) {
+                bool allowed = kinds[from] == manifoldVertex || (kinds[from] != lockedVertex && kinds[from] == kinds[to]);
+                if(allowed) {
+                    Quadric quadric = quadrics[from];
+                    addQuadric(quadric, quadrics[to]);
+                    glm::vec3 target = glm::vec3(m_vertices[to].position);
+                    glm::vec3 edge = target - glm::vec3(m_vertices[from].position);
+                    double normalChange = 1.0 - glm::dot(m_vertices[from].normal, m_vertices[to].normal);
+                    collapses.emplace_back(Collapse{evaluateQuadric(quadric, target) + normalChange * glm::dot(edge, edge), from, to});
+                }
+                std::swap(from, to);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+            return a.cost < b.cost || (a.cost == b.cost && (a.from < b.from || (a.from == b.from && a.to < b.to)));
+        });
+
+        std::fill(touched.begin(), touched.end(), false);
+        for(uint32_t v=0; v<numVertices; v++) {
+            remap[v] = v;
+        }
+        uint32_t numRemoved = 0;
+        for(auto &collapse : collapses) {
+            if(numTriangles - numRemoved <= targetTriangles) {
+                break;
+            }
+            uint32_t from = collapse.from;
+            uint32_t to = collapse.to;
+            if(touched[from] || touched[to]) {
+                continue;
+            }
+
+            uint32_t numDegenerate;
+            if(!checkCollapse(from, to, numDegenerate)) {
+                continue;
+            }
+            //border and seam vertices only move along an edge with a single adjacent triangle,
+            //on a seam the twin on the other side has to follow along the matching edge
+            uint32_t numTwinDegenerate = 0;
+            if(kinds[from] != manifoldVertex) {
+                if(numDegenerate != 1) {
+                    continue;
+                }
+                if(kinds[from] == seamVertex && (touched[twins[from]] || touched[twins[to]]
+                    || !checkCollapse(twins[from], twins[to], numTwinDegenerate) || numTwinDegenerate != 1)) {
+                    continue;
+                }
+            }
+
+            //the surroundings of the collapse change, so they are left alone for the rest of the pass
+            touchSurroundings(from);
+            remap[from] = to;
+            addQuadric(quadrics[to], quadrics[from]);
+            if(kinds[from] == seamVertex) {
+                touchSurroundings(twins[from]);
+                remap[twins[from]] = twins[to];
+                addQuadric(quadrics[twins[to]], quadrics[twins[from]]);
+            }
+            maxCost = std::max(maxCost, collapse.cost);
+            numRemoved += numDegenerate + numTwinDegenerate;
+        }
+        if(numRemoved == 0) {
+            break;
+        }
+
+        //apply the collapses and drop triangles that became degenerate
+        uint32_t numKept = 0;
+        for(uint32_t i=0; i<indices.size(); i+=3) {
+            uint32_t a = remap[indices[i]];
+            uint32_t b = remap[indices[i + 1]];
+            uint32_t c = remap[indices[i + 2]];
+            if(a != b && b != c && c != a) {
+                indices[numKept++] = a;
+                indices[numKept++] = b;
+                indices[numKept++] = c;
+            }
+        }
+        indices.resize(numKept);
+    }
+
+    return static_cast<float>(std::sqrt(maxCost));
+}
+
+void Mesh::computeMeshletBounds(Meshlet &meshlet) {
+    const Vertex *vertices = m_mappedFile != nullptr ? m_mappedVertices : m_vertices.data();
+    const uint32_t *indices = m_mappedFile != nullptr ? m_mappedIndices : m_indices.data();
+    auto first = indices + meshlet.firstIndex;
+    auto last = first + meshlet.numIndices;
+
+    glm::vec3 minimum = glm::vec3(vertices[*first].position);
+    glm::vec3 maximum = minimum;
+    for(auto index = first; index != last; index++) {
+        minimum = glm::min(minimum, glm::vec3(vertices[*index].position));
+        maximum = glm::max(maximum, glm::vec3(vertices[*index].position));
+    }
+    glm::vec3 center = 0.5f * (minimum + maximum);
+    float radius = 0.0f;
+    for(auto index = first; index != last; index++) {
+        radius = std::max(radius, glm::distance(center, glm::vec3(vertices[*index].position)));
+    }
+    meshlet.boundingSphere = glm::vec4(center, radius);
+
+    //the cone axis is the average of the triangle normals, its opening angle covers all of them
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.numIndices / 3);
+    glm::vec3 axis = glm::vec3(0.0f);
+    for(auto index = first; index + 2 < last; index += 3) {
+        auto p0 = glm::vec3(vertices[index[0]].position);
+        auto normal = glm::cross(glm::vec3(vertices[index[1]].position) - p0, glm::vec3(vertices[index[2]].position) - p0);
+        float length = glm::length(normal);
+        if(length > 0.0f) {
+            normals.emplace_back(normal / length);
+            axis += normals.back();
+        }
+    }
+    meshlet.normalCone = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    if(glm::length(axis) == 0.0f) {
+        return;
+    }
+    axis = glm::normalize(axis);
+    float minDot = 1.0f;
+    for(auto &normal : normals) {
+        minDot = std::min(minDot, glm::dot(axis, normal));
+    }
+    //wide cones almost never allow culling, they are marked as never back-facing
+    if(minDot > 0.1f) {
+        meshlet.normalCone = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+    }
+}
+
+uint32_t Mesh::simulateVertexCache(const uint32_t *indices, uint32_t numIndices, uint32_t numVertices, uint32_t cacheSize) {
+    //a vertex is in the cache if fewer than cacheSize vertices have been added since it was added itself
+    std::vector<uint32_t> cacheTimes(numVertices, 0);
+    uint32_t time = cacheSize + 1;
+    uint32_t numMisses = 0;
+    for(uint32_t i=0; i<numIndices; i++) {
+        if(time - cacheTimes[indices[i]] > cacheSize) {
+            cacheTimes[indices[i]] = time++;
+            numMisses++;
+        }
+    }
+    return numMisses;
+}
+
+void Mesh::optimizeVertexCache(uint32_t firstIndex, uint32_t numIndices, uint32_t cacheSize) {
+    auto numVertices = static_cast<uint32_t>(m_vertices.size());
+    uint32_t numTriangles = numIndices / 3;
+    const uint32_t *indices = m_indices.data() + firstIndex;
+
+    //triangles adjacent to each vertex, stored consecutively
+    std::vector<uint32_t> liveTriangles(numVertices, 0);
+    for(uint32_t i=0; i<numTriangles*3; i++) {
+        liveTriangles[indices[i]]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+    for(uint32_t v=0; v<numVertices; v++) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(adjacencyOffsets[numVertices]);
+    std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for(uint32_t i=0; i<numTriangles*3; i++) {
+        adjacency[adjacencyFill[indices[i]]++] = i / 3;
+    }
+
+    std::vector<uint32_t> cacheTimes(numVertices, 0);
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> optimizedIndices;
+    optimizedIndices.reserve(numTriangles * 3);
+    uint32_t time = cacheSize + 1;
+    uint32_t cursor = 0;
+
+    //vertices that recently lost triangles are tried first, otherwise the next vertex with triangles left in input order
+    auto skipDeadEnd = [&]() -> int64_t {
+        while(!deadEnds.empty()) {
+            uint32_t v = deadEnds.back();
+            deadEnds.pop_back();
+            if(liveTriangles[v] > 0) {
+                return v;
+            }
+        }
+        while(cursor < numVertices) {
+            if(liveTriangles[cursor] > 0) {
+                return cursor;
+            }
+            cursor++;
+        }
+        return -1;
+    };
+
+    int64_t fanVertex = skipDeadEnd();
+    while(fanVertex >= 0) {
+        candidates.clear();
+        for(uint32_t a=adjacencyOffsets[fanVertex]; a<adjacencyOffsets[fanVertex + 1]; a++) {
+            uint32_t t = adjacency[a];
+            if(emitted[t]) {
+                continue;
+            }
+            for(uint32_t j=0; j<3; j++) {
+                uint32_t v = indices[3 * t + j];
+                optimizedIndices.emplace_back(v);
+                deadEnds.emplace_back(v);
+                candidates.emplace_back(v);
+                liveTriangles[v]--;
+                if(time - cacheTimes[v] > cacheSize) {
+                    cacheTimes[v] = time++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        //prefer the vertex that entered the cache first, as long as its remaining fan still fits into the cache
+        fanVertex = -1;
+        int64_t bestPriority = -1;
+        for(auto v : candidates) {
+            if(liveTriangles[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if(time - cacheTimes[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = time - cacheTimes[v];
+            }
+            if(priority > bestPriority) {
+                bestPriority = priority;
+                fanVertex = v;
+            }
+        }
+        if(fanVertex < 0) {
+            fanVertex = skipDeadEnd();
+        }
+    }
+
+    std::copy(optimizedIndices.begin(), optimizedIndices.end(), m_indices.begin() + firstIndex);
+}
+
+void Mesh::optimizeOverdraw(uint32_t firstIndex, uint32_t numIndices, uint32_t cacheSize, float threshold) {
+    uint32_t numTriangles = numIndices / 3;
+    auto numVertices = static_cast<uint32_t>(m_vertices.size());
+    const uint32_t *indices = m_indices.data() + firstIndex;
+    uint32_t numMisses = simulateVertexCache(indices, numTriangles * 3, numVertices, cacheSize);
+    float targetACMR = threshold * static_cast<float>(numMisses) / static_cast<float>(numTriangles);
+
+    //clusters may be drawn in any order, so the cache is simulated from scratch for each of them
+    std::vector<uint32_t> clusterStarts;
+    uint32_t clusterMisses = 0;
+    bool clusterComplete = true;
+    std::vector<uint32_t> cacheTimes(numVertices, 0);
+    uint32_t time = cacheSize + 1;
+    for(uint32_t t=0; t<numTriangles; t++) {
+        if(clusterComplete) {
+            clusterStarts.emplace_back(t);
+            clusterMisses = 0;
+            time += cacheSize + 1;
+        }
+        for(uint32_t j=0; j<3; j++) {
+            uint32_t v = indices[3 * t + j];
+            if(time - cacheTimes[v] > cacheSize) {
+                cacheTimes[v] = time++;
+                clusterMisses++;
+            }
+        }
+        clusterComplete = static_cast<float>(clusterMisses) <= targetACMR * static_cast<float>(t - clusterStarts.back() + 1);
+    }
+    clusterStarts.emplace_back(numTriangles);
+
+    //clusters facing away from the center are likely in front of the others and are drawn first
+    glm::vec3 meshCenter(0.0f);
+    for(auto &vertex : m_vertices) {
+        meshCenter += glm::vec3(vertex.position);
+    }
+    meshCenter /= static_cast<float>(std::max(1u, numVertices));
+
+    auto numClusters = static_cast<uint32_t>(clusterStarts.size() - 1);
+    std::vector<float> clusterKeys(numClusters);
+    for(uint32_t c=0; c<numClusters; c++) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for(uint32_t t=clusterStarts[c]; t<clusterStarts[c + 1]; t++) {
+            glm::vec3 p0 = glm::vec3(m_vertices[indices[3 * t]].position);
+            glm::vec3 p1 = glm::vec3(m_vertices[indices[3 * t + 1]].position);
+            glm::vec3 p2 = glm::vec3(m_vertices[indices[3 * t + 2]].position);
+            //the cross product is the area weighted normal of the triangle
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            float faceArea = glm::length(faceNormal);
+            centroid += faceArea * (p0 + p1 + p2) / 3.0f;
+            normal += faceNormal;
+            area += faceArea;
+        }
+        float normalLength = glm::length(normal);
+        if(area > 0.0f && normalLength > 0.0f) {
+            clusterKeys[c] = glm::dot(centroid / area - meshCenter, normal / normalLength);
+        } else {
+            clusterKeys[c] = 0.0f;
+        }
+    }
+
+    std::vector<uint32_t> clusterOrder(numClusters);
+    for(uint32_t c=0; c<numClusters; c++) {
+        clusterOrder[c] = c;
+    }
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b) {
+        return clusterKeys[a] > clusterKeys[b];
+    });
+
+    std::vector<uint32_t> sortedIndices;
+    sortedIndices.reserve(numTriangles * 3);
+    for(auto c : clusterOrder) {
+        sortedIndices.insert(sortedIndices.end(), indices + 3 * clusterStarts[c], indices + 3 * clusterStarts[c + 1]);
+    }
+    std::copy(sortedIndices.begin(), sortedIndices.end(), m_indices.begin() + firstIndex);
+}
+
+void Mesh::optimizeVertexFetch() {
+    const uint32_t unused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(m_vertices.size(), unused);
+    std::vector<Vertex> sortedVertices;
+    sortedVertices.reserve(m_vertices.size());
+    for(auto &index : m_indices) {
+        if(remap[index] == unused) {
+            remap[index] = static_cast<uint32_t>(sortedVertices.size());
+            sortedVertices.emplace_back(m_vertices[index]);
+        }
+        index = remap[index];
+    }
+    m_vertices = sortedVertices;
+}
+
+glm::vec2 Mesh::encodeOctahedral(glm::vec3 vector) {
+    //meshes without texture coordinates may have no valid tangents
+    auto sum = glm::abs(vector.x) + glm::abs(vector.y) + glm::abs(vector.z);
+    if(!(sum > 0.0f)) {
+        return glm::vec2(0.0f);
+    }
+    vector /= sum;
+    auto encoded = glm::vec2(vector.x, vector.y);
+    if(vector.z < 0.0f) {
+        //fold the lower half over the diagonals
+        encoded = glm::vec2(
+            (1.0f - glm::abs(vector.y)) * (vector.x >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - glm::abs(vector.x)) * (vector.y >= 0.0f ? 1.0f : -1.0f)
+        );
+    }
+    return encoded;
+}
+
+void Mesh::packVertices(const Vertex *vertices, std::vector<PackedVertex> &packedVertices) {
+    auto numVertices = getNumVertices();
+
+    auto extent = numVertices > 0 ? m_boundingBox.maximum - m_boundingBox.minimum : glm::vec3(0.0f);
+    m_positionOffset = glm::vec4(numVertices > 0 ? m_boundingBox.minimum : glm::vec3(0.0f), 0.0f);
+    m_positionScale = glm::vec4(extent, 1.0f);
+
+    //flat axes keep all positions at the offset
+    glm::vec3 inverseExtent;
+    for(int axis=0; axis<3; axis++) {
+        inverseExtent[axis] = extent[axis] > 0.0f ? 1.0f / extent[axis] : 0.0f;
+    }
+
+    packedVertices.resize(numVertices);
+    for(uint32_t v=0; v<numVertices; v++) {
+        auto &vertex = vertices[v];
+        auto &packed = packedVertices[v];
+
+        auto position = (glm::vec3(vertex.position) - glm::vec3(m_positionOffset)) * inverseExtent;
+        for(int axis=0; axis<3; axis++) {
+            packed.position[axis] = glm::packUnorm1x16(position[axis]);
+        }
+        packed.position[3] = glm::packUnorm1x16(vertex.tangent.w > 0.0f ? 1.0f : 0.0f);
+
+        auto normal = encodeOctahedral(vertex.normal);
+        auto tangent = encodeOctahedral(glm::vec3(vertex.tangent));
+        for(int c=0; c<2; c++) {
+            packed.normal[c] = static_cast<int16_t>(glm::packSnorm1x16(normal[c]));
+            packed.texCoord[c] = glm::packHalf1x16(vertex.texCoord[c]);
+            packed.tangent[c] = static_cast<int16_t>(glm::packSnorm1x16(tangent[c]));
+        }
+    }
+}
+
+void Mesh::copyMappedGeometry() {
+    if(m_mappedFile == nullptr) {
+        return;
+    }
+
+    m_vertices.assign(m_mappedVertices, m_mappedVertices + m_numMappedVertices);
+    m_indices.assign(m_mappedIndices, m_mappedIndices + m_numMappedIndices);
+    m_mappedFile = nullptr;
+    m_mappedVertices = nullptr;
+    m_mappedIndices = nullptr;
+    m_numMappedVertices = 0;
+    m_numMappedIndices = 0;
+}
+
+void Mesh::writeGeometry(unsigned char *vertices, unsigned char *attributes, void *indices, VkIndexType indexType) {
+    if(m_boundingBox.isEmpty()) {
+        computeBounds();
+    }
+
+    //mapped geometry is copied straight from the file into the staging memory
+    const Vertex *vertexData = m_mappedFile != nullptr ? m_mappedVertices : m_vertices.data();
+    const uint32_t *indexData = m_mappedFile != nullptr ? m_mappedIndices : m_indices.data();
+
+    auto vertexSize = static_cast<VkDeviceSize>(sizeof(Vertex));
+    auto positionSize = static_cast<VkDeviceSize>(offsetof(Vertex, normal));
+
+    //packed vertices are converted right before the upload, the vertex list and model cache keep the full format
+    std::vector<PackedVertex> packedVertices;
+    auto uploadedVertexData = reinterpret_cast<const unsigned char*>(vertexData);
+    if(m_vertexFormat == packedVertexFormat) {
+        packVertices(vertexData, packedVertices);
+        uploadedVertexData = reinterpret_cast<const unsigned char*>(packedVertices.data());
+        vertexSize = static_cast<VkDeviceSize>(sizeof(PackedVertex));
+        positionSize = static_cast<VkDeviceSize>(offsetof(PackedVertex, normal));
+    }
+
+    if(m_splitVertexStreams) {
+        //the position leads each vertex, the remaining bytes make up the attribute stream
+        auto attributeSize = vertexSize - positionSize;
+        for(uint32_t v=0; v<getNumVertices(); v++) {
+            memcpy(vertices + v * positionSize, uploadedVertexData + v * vertexSize, (size_t) positionSize);
+            memcpy(attributes + v * attributeSize, uploadedVertexData + v * vertexSize + positionSize, (size_t) attributeSize);
+        }
+    } else {
+        memcpy(vertices, uploadedVertexData, (size_t) (getNumVertices() * vertexSize));
+    }
+
+    if(indexType == VK_INDEX_TYPE_UINT16) {
+        auto shortIndices = static_cast<uint16_t*>(indices);
+        for(uint32_t i=0; i<getNumIndices(); i++) {
+            shortIndices[i] = static_cast<uint16_t>(indexData[i]);
+        }
+    } else {
+        memcpy(indices, indexData, getNumIndices() * sizeof(uint32_t));
+    }
+}
+
+void Mesh::createBuffers(std::shared_ptr<Context> &context, uint32_t firstVertex, uint32_t firstIndex, VkIndexType indexType) {
     if(m_hasBuffers) {
         throw std::runtime_error("MESH ERROR: Buffers have already been created.");
     }
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    void* data;
-
-    //fill staging buffer with vertex data
-    auto vertexSize = static_cast<VkDeviceSize>(m_vertices.size() * sizeof(Vertex));
-    context->createBuffer(vertexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-    vkMapMemory(context->getDevice(), stagingBufferMemory, 0, vertexSize, 0, &data);
-    memcpy(data, m_vertices.data(), (size_t) vertexSize);
-    vkUnmapMemory(context->getDevice(), stagingBufferMemory);
-
-    //transfer staging buffer to vertex buffer
-    context->createBuffer(vertexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertexBuffer, m_vertexMemory);
-    context->copyBuffer(stagingBuffer, m_vertexBuffer, vertexSize);
-    vkDestroyBuffer(context->getDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(context->getDevice(), stagingBufferMemory, nullptr);
-
-    //fill staging buffer with index data
-    auto indexSize = static_cast<VkDeviceSize>(m_indices.size() * sizeof(uint32_t));
-    context->createBuffer(indexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-    vkMapMemory(context->getDevice(), stagingBufferMemory, 0, indexSize, 0, &data);
-    memcpy(data, m_indices.data(), (size_t) indexSize);
-    vkUnmapMemory(context->getDevice(), stagingBufferMemory);
-
-    //transfer staging buffer to index buffer
-    context->createBuffer(indexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indexBuffer, m_indexMemory);
-    context->copyBuffer(stagingBuffer, m_indexBuffer, indexSize);
-    vkDestroyBuffer(context->getDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(context->getDevice(), stagingBufferMemory, nullptr);
-
+    m_firstVertex = firstVertex;
+    m_firstIndex = firstIndex;
+    m_indexType = indexType;
     m_hasBuffers = true;
 }
 
-void Mesh::render(VkCommandBuffer commandBuffer, uint32_t numInstances) {
-    VkDeviceSize offsets[] = {0};
-    VkBuffer vertexBuffers[] = {m_vertexBuffer};
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-    vkCmdDrawIndexed(commandBuffer, m_indices.size(), numInstances, 0, 0, 0);
+VkIndexType Mesh::getIndexType() {
+    return m_indexType;
+}
+
+VkDrawIndexedIndirectCommand Mesh::getDrawCommand(uint32_t numInstances, uint32_t lod) {
+    auto range = getLod(std::min(lod, getNumLods() - 1));
+    VkDrawIndexedIndirectCommand command{};
+    command.indexCount = range.numIndices;
+    command.instanceCount = numInstances;
+    command.firstIndex = m_firstIndex + range.firstIndex;
+    command.vertexOffset = static_cast<int32_t>(m_firstVertex);
+    command.firstInstance = 0;
+    return command;
+}
+
+void Mesh::render(VkCommandBuffer commandBuffer, uint32_t numInstances, uint32_t lod) {
+    auto command = getDrawCommand(numInstances, lod);
+    vkCmdDrawIndexed(commandBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
 }
 
 void Mesh::cleanUp(std::shared_ptr<Context> &context) {
-    vkDestroyBuffer(context->getDevice(), m_vertexBuffer, nullptr);
-    vkFreeMemory(context->getDevice(), m_vertexMemory, nullptr);
-    vkDestroyBuffer(context->getDevice(), m_indexBuffer, nullptr);
-    vkFreeMemory(context->getDevice(), m_indexMemory, nullptr);
+    m_mappedFile = nullptr;
+    m_mappedVertices = nullptr;
+    m_mappedIndices = nullptr;
+    m_numMappedVertices = 0;
+    m_numMappedIndices = 0;
 
     m_hasBuffers = false;
 }
\ No newline at end of file
@@ -1,9 +1,12 @@
 #ifndef SLBVULKAN_MESH_H
 #define SLBVULKAN_MESH_H
 
+#include <limits>
+
 #include <glm/ext.hpp>
 
 #include "Context.h"
+#include "MappedFile.h"
 
 /**
  * Vertex definition describing attributes and their bindings in the shader.
@@ -12,7 +15,7 @@ struct Vertex {
     glm::vec4 position; /**< Position in local, homogeneous coordinates */
     glm::vec3 normal; /**< Normal in local coordinates */
     glm::vec2 texCoord; /**< Texture coordinates in uv coordinates */
-    glm::vec3 tangent; /**< Tangent in local coordinates */
+    glm::vec4 tangent; /**< Tangent in local coordinates, w is the handedness (1 or -1) of the bitangent cross(normal, tangent) */
 
     static VkVertexInputBindingDescription getBindingDescription() {
         VkVertexInputBindingDescription bindingDescription{};
@@ -37,12 +40,196 @@ struct Vertex {
         attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
         attributeDescriptions[3].binding = 0;
         attributeDescriptions[3].location = 3;
-        attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[3].format = VK_FORMAT_R32G32B32A32_SFLOAT;
         attributeDescriptions[3].offset = offsetof(Vertex, tangent);
         return attributeDescriptions;
     };
 };
 
+/**
+ * Layout of the vertices in the vertex buffers, shared by all meshes and render steps.
+ */
+enum VertexFormat {
+    fullVertexFormat, /**< Vertex with 32 bit floats for all attributes, 52 bytes */
+    packedVertexFormat /**< PackedVertex with quantized attributes, 20 bytes */
+};
+
+/**
+ * Compact vertex definition created from a Vertex when the buffers of a mesh are created.
+ * 
+ * Positions are quantized to 16 bits per axis relative to the bounding box of the mesh,
+ * which is undone in the shader using the offset and scale passed as push constants.
+ * Normal and tangent are unit vectors mapped onto an octahedron and stored as two 16 bit values each.
+ * Texture coordinates are half floats.
+ */
+struct PackedVertex {
+    uint16_t position[4]; /**< Position inside the bounding box, w is 1 for a tangent handedness of 1 and 0 for -1 */
+    int16_t normal[2]; /**< Octahedral encoding of the normal */
+    uint16_t texCoord[2]; /**< Texture coordinates as half floats */
+    int16_t tangent[2]; /**< Octahedral encoding of the tangent */
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(PackedVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescription;
+    };
+    static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset = offsetof(PackedVertex, position);
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+        attributeDescriptions[1].offset = offsetof(PackedVertex, normal);
+        attributeDescriptions[2].binding = 0;
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(PackedVertex, texCoord);
+        attributeDescriptions[3].binding = 0;
+        attributeDescriptions[3].location = 3;
+        attributeDescriptions[3].format = VK_FORMAT_R16G16_SNORM;
+        attributeDescriptions[3].offset = offsetof(PackedVertex, tangent);
+        return attributeDescriptions;
+    };
+};
+
+/**
+ * Number of vertices assumed to fit into the post-transform vertex cache.
+ * Used by Mesh::optimize and as default for the cache statistics.
+ */
+const uint32_t vertexCacheSize = 16;
+
+/**
+ * Number of triangles or vertices processed at once by a thread during tangent generation.
+ */
+const uint32_t tangentChunkSize = 4096;
+
+/**
+ * Number of triangles whose tangents are computed side by side, should be a multiple of the SIMD width.
+ */
+const uint32_t tangentBatchSize = 8;
+
+/**
+ * Number of vertices whose positions are compared side by side when computing bounds, should be a multiple of the SIMD width.
+ */
+const uint32_t boundsBatchSize = 8;
+
+/**
+ * Maximum number of levels of detail of a mesh, including the full resolution.
+ */
+const uint32_t maxMeshLods = 4;
+
+/**
+ * Axis aligned box enclosing a set of points.
+ * 
+ * A default constructed box is empty, its minimum lies above its maximum.
+ */
+struct BoundingBox {
+    glm::vec3 minimum{std::numeric_limits<float>::max()}; /**< Corner with the smallest coordinates */
+    glm::vec3 maximum{-std::numeric_limits<float>::max()}; /**< Corner with the largest coordinates */
+
+    /**
+     * Check if the box does not contain any point.
+     */
+    bool isEmpty() const {
+        return minimum.x > maximum.x || minimum.y > maximum.y || minimum.z > maximum.z;
+    }
+
+    /**
+     * Grow the box until it also encloses another box.
+     * 
+     * @param box box to be enclosed, empty boxes leave this one unchanged
+     */
+    void extend(const BoundingBox &box) {
+        minimum = glm::min(minimum, box.minimum);
+        maximum = glm::max(maximum, box.maximum);
+    }
+
+    /**
+     * Compute the axis aligned box enclosing this box after a transformation.
+     * 
+     * The half extent along each new axis is the sum of the old half extents weighted by the absolute matrix entries.
+     * 
+     * @param matrix affine transformation, e.g. a model matrix
+     * @return transformed box, empty if this box is empty
+     */
+    BoundingBox transform(const glm::mat4 &matrix) const {
+        if(isEmpty()) {
+            return BoundingBox();
+        }
+        auto center = glm::vec3(matrix * glm::vec4(0.5f * (minimum + maximum), 1.0f));
+        auto absolute = glm::mat3(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+        auto halfExtent = absolute * (0.5f * (maximum - minimum));
+        return BoundingBox{center - halfExtent, center + halfExtent};
+    }
+};
+
+/**
+ * Range of the index list making up one level of detail.
+ * 
+ * All levels of a mesh share the same vertices.
+ */
+struct MeshLod {
+    uint32_t firstIndex; /**< Position of the first index of the level in the index list */
+    uint32_t numIndices; /**< Number of indices of the level */
+    float error; /**< Approximate geometric deviation from the full resolution in local coordinates */
+};
+
+/**
+ * Maximum number of vertices referenced by a meshlet.
+ */
+const uint32_t maxMeshletVertices = 64;
+
+/**
+ * Maximum number of triangles in a meshlet.
+ */
+const uint32_t maxMeshletTriangles = 124;
+
+/**
+ * Small cluster of neighboring triangles of the full resolution level, used for culling parts of a mesh.
+ * 
+ * The triangles of a meshlet are a consecutive range of the index list, so each meshlet
+ * can be drawn on its own, e.g. by an indirect draw command written after culling.
+ * Meshlets stay on the CPU and in the model cache until a culling pass reads them,
+ * their layout matches std430 so the list can later be copied into a storage buffer as is.
+ */
+struct Meshlet {
+    glm::vec4 boundingSphere; /**< Center in local coordinates and radius as w component */
+    glm::vec4 normalCone; /**< Average triangle normal and, as w component, the sine of the largest deviation from it, 1 if the meshlet cannot be back-facing */
+    uint32_t firstIndex; /**< Position of the first index of the meshlet in the index list */
+    uint32_t numIndices; /**< Number of indices of the meshlet */
+    uint32_t numVertices; /**< Number of distinct vertices referenced by the meshlet */
+    uint32_t pad; /**< Padding to a multiple of 16 bytes */
+};
+
+/**
+ * Symmetric 4x4 matrix summing up squared distances to a set of planes.
+ * 
+ * Used to estimate the error introduced by collapsing edges during simplification.
+ * Each plane is weighted by the area of its triangle.
+ */
+struct Quadric {
+    double xx = 0.0, xy = 0.0, xz = 0.0, xw = 0.0; /**< First row */
+    double yy = 0.0, yz = 0.0, yw = 0.0; /**< Second row starting at the diagonal */
+    double zz = 0.0, zw = 0.0; /**< Third row starting at the diagonal */
+    double ww = 0.0; /**< Last diagonal element */
+    double weight = 0.0; /**< Sum of the plane weights */
+};
+
+/**
+ * Role of a vertex during simplification, determining which edges it can be collapsed along.
+ */
+enum VertexKind {
+    manifoldVertex, /**< Interior vertex that can be moved onto any neighbor */
+    borderVertex, /**< Vertex on an open border, only moved along the border */
+    seamVertex, /**< One of two vertices sharing a position on a texture or normal seam, moved along the seam together with its twin */
+    lockedVertex /**< Vertex that is never moved, e.g. where several seams meet */
+};
+
 /**
  * Geometry composed of triangles defined on a set of vertices.
  * Rendering is indexed by default.
@@ -52,7 +239,7 @@ public:
     /**
      * Create an empty mesh.
      * 
-     * Mesh is not initialized until createBuffers is called.
+     * Mesh is not initialized until it is uploaded by a geometry arena.
      */
     Mesh();
     ~Mesh() = default;
@@ -64,6 +251,48 @@ public:
      */
     bool hasBuffers();
 
+    /**
+     * Return the number of vertices added to the mesh.
+     * 
+     * @return size of the vertex list
+     */
+    uint32_t getNumVertices();
+
+    /**
+     * Return the number of indices added to the mesh.
+     * 
+     * @return size of the index list, three times the number of triangles
+     */
+    uint32_t getNumIndices();
+
+    /**
+     * Return the vertex list of the mesh.
+     * 
+     * @return list of vertices with all attributes
+     */
+    std::vector<Vertex> &getVertices();
+
+    /**
+     * Return the index list of the mesh.
+     * 
+     * @return list of indices assembling the vertices into triangles
+     */
+    std::vector<uint32_t> &getIndices();
+
+    /**
+     * Use geometry stored in a memory-mapped file instead of the vertex and index lists.
+     * 
+     * The data is not copied, the mapping is kept alive by the mesh until cleanUp is called.
+     * If the geometry is accessed for modification it is copied into the vertex and index lists first.
+     * 
+     * @param file mapped file containing the geometry
+     * @param vertices first vertex inside the mapped file
+     * @param numVertices number of vertices
+     * @param indices first index inside the mapped file
+     * @param numIndices number of indices
+     */
+    void setMappedGeometry(std::shared_ptr<MappedFile> &file, const Vertex *vertices, uint32_t numVertices, const uint32_t *indices, uint32_t numIndices);
+
     /**
      * Add a vertex in local coordinates to the vertex list.
      * 
@@ -107,37 +336,294 @@ public:
     /**
      * Reassign tangents for all added vertices.
      * 
-     * Tangents are generated for the triangles defined via the index list.
-     * Positions and texture coordinates of the vertices are used to calculate the tangents.
+     * Tangent and bitangent directions are derived for each triangle from the positions and texture coordinates.
+     * Each vertex sums up the directions of its triangles weighted by their area and the angle at the vertex,
+     * so the result does not depend on the triangle order.
+     * The tangent is then made orthogonal to the normal, its handedness is stored as w component.
+     * Triangles are processed in batches the compiler can vectorize, chunks of triangles and vertices are distributed over multiple threads.
+     * 
+     * @param numThreads maximum number of threads, 0 uses all hardware threads
+     */
+    void calculateTangents(uint32_t numThreads = 0);
+
+    /**
+     * Return the number of levels of detail.
+     * 
+     * @return 1 if no simplified levels have been generated
+     */
+    uint32_t getNumLods();
+
+    /**
+     * Return the index range of a level of detail.
+     * 
+     * Level 0 is the full resolution mesh, which covers all indices if no levels have been generated.
+     * 
+     * @param level level of detail, has to be smaller than getNumLods
+     * @return range of the index list making up the level
+     */
+    MeshLod getLod(uint32_t level);
+
+    /**
+     * Replace the levels of detail, e.g. by ones stored in a model cache.
+     * 
+     * @param lods index ranges of all levels, starting with the full resolution
+     */
+    void setLods(const std::vector<MeshLod> &lods);
+
+    /**
+     * Compute the bounding box and sphere of all vertices.
+     * 
+     * Has to be called again after the vertices have been changed through getVertices.
+     * The positions are compared in batches of boundsBatchSize, which the compiler can vectorize.
+     * The center of the box is used as center of the sphere, which is not the smallest sphere but close enough.
      */
-    void calculateTangents();
+    void computeBounds();
+
+    /**
+     * Return the axis aligned box enclosing all vertices.
+     * 
+     * Only available once computeBounds has been called or the box has been set, writeGeometry computes it if missing.
+     * 
+     * @return box in local coordinates, empty if the bounds are not available
+     */
+    BoundingBox getBoundingBox();
+
+    /**
+     * Change the box enclosing all vertices, e.g. to the one stored in a model cache.
+     * 
+     * @param boundingBox box in local coordinates
+     */
+    void setBoundingBox(const BoundingBox &boundingBox);
+
+    /**
+     * Return the sphere enclosing all vertices.
+     * 
+     * Available together with the bounding box.
+     * 
+     * @return center in local coordinates and radius as w component
+     */
+    glm::vec4 getBoundingSphere();
+
+    /**
+     * Change the sphere enclosing all vertices, e.g. to the one stored in a model cache.
+     * 
+     * @param boundingSphere center in local coordinates and radius as w component
+     */
+    void setBoundingSphere(glm::vec4 boundingSphere);
+
+    /**
+     * Generate simplified levels of detail.
+     * 
+     * Each level has about half the triangles of the previous one, generation stops early if the mesh
+     * cannot be reduced any further or becomes too small to be worth simplifying.
+     * Edges are collapsed in the order of their quadric error, which also accounts for the change of normals.
+     * A collapse moves one vertex onto another, so no vertices are added and all levels share the vertex list.
+     * Vertices on open borders only move along the border and the two vertices on either side of a texture
+     * or normal seam only move along the seam together, so the silhouette stays intact and seams do not tear.
+     * Previously generated levels and meshlets are replaced.
+     * 
+     * @param numLevels maximum number of levels including the full resolution
+     */
+    void generateLods(uint32_t numLevels = maxMeshLods);
+
+    /**
+     * Choose the coarsest level of detail whose error stays below a threshold on screen.
+     * 
+     * @param pixelsPerUnit number of pixels covered by a length of 1 in local coordinates at the distance of the mesh
+     * @param maxPixelError largest allowed error in pixels
+     * @return selected level of detail
+     */
+    uint32_t selectLod(float pixelsPerUnit, float maxPixelError);
+
+    /**
+     * Split the full resolution level into meshlets.
+     * 
+     * Triangles are assigned in the order of the index list, a new meshlet is started when
+     * the next triangle would exceed maxMeshletVertices or maxMeshletTriangles.
+     * Since optimize sorts triangles for vertex locality, it should be called first,
+     * consecutive triangles then share most of their vertices and form compact clusters.
+     * The index list is not changed. Previously generated meshlets are replaced.
+     */
+    void generateMeshlets();
+
+    /**
+     * Return the meshlets of the full resolution level.
+     * 
+     * @return list of meshlets, empty if none have been generated
+     */
+    const std::vector<Meshlet> &getMeshlets();
+
+    /**
+     * Replace the meshlets, e.g. by ones stored in a model cache.
+     * 
+     * @param meshlets list of meshlets covering the full resolution level
+     */
+    void setMeshlets(const std::vector<Meshlet> &meshlets);
+
+    /**
+     * Test whether all triangles of a meshlet face away from the camera.
+     * 
+     * Conservative test using the normal cone and bounding sphere, the same one can be done on the GPU.
+     * 
+     * @param meshlet meshlet of the mesh
+     * @param cameraPosition position of the camera in the local coordinates of the mesh
+     * @return true if the meshlet can be skipped
+     */
+    static bool isMeshletBackFacing(const Meshlet &meshlet, glm::vec3 cameraPosition);
+
+    /**
+     * Reorder triangles and vertices for faster rendering.
+     * 
+     * Should be called once the geometry is complete and before it is uploaded.
+     * Each level of detail is reordered separately.
+     * First the triangles are sorted for post-transform vertex cache locality (Tipsify by Sander et al.).
+     * The result is split into clusters that stay cache efficient on their own,
+     * which are then ordered to draw outward facing clusters first and reduce overdraw.
+     * Finally the vertices are sorted by their first use, vertices not used by any triangle are removed.
+     * The rendered image does not change.
+     * Meshlets are removed since they depend on the triangle order.
+     */
+    void optimize();
+
+    /**
+     * Return the average cache miss ratio of the mesh.
+     * 
+     * A FIFO cache is simulated over the full resolution level.
+     * Values range from 3 (no vertex reuse) down to about 0.5 for large regular meshes.
+     * 
+     * @param cacheSize number of vertices in the simulated cache
+     * @return number of transformed vertices per triangle
+     */
+    float getACMR(uint32_t cacheSize = vertexCacheSize);
+
+    /**
+     * Return the average transform to vertex ratio of the mesh.
+     * 
+     * A FIFO cache is simulated over the full resolution level, 1 is optimal.
+     * 
+     * @param cacheSize number of vertices in the simulated cache
+     * @return number of transformed vertices per vertex in the vertex list
+     */
+    float getATVR(uint32_t cacheSize = vertexCacheSize);
+
+    /**
+     * Choose the layout of the vertex buffers.
+     * 
+     * Has to be called before any buffers are created and before the render steps are initialized,
+     * since it also determines the vertex input of the pipelines and shaders.
+     * 
+     * @param format layout used by all meshes
+     */
+    static void setVertexFormat(VertexFormat format);
+
+    /**
+     * Return the layout of the vertex buffers.
+     * 
+     * @return layout used by all meshes
+     */
+    static VertexFormat getVertexFormat();
+
+    /**
+     * Choose whether positions are stored in a separate vertex buffer.
+     * 
+     * With split streams the vertex buffer (binding 0) only contains positions and all other attributes
+     * are stored in a second buffer (binding 1), so passes only reading positions fetch less memory.
+     * Has to be called before any buffers are created and before the render steps are initialized.
+     * 
+     * @param split true for separate position and attribute streams, false for interleaved vertices
+     */
+    static void setSplitVertexStreams(bool split);
+
+    /**
+     * Return whether positions are stored in a separate vertex buffer.
+     * 
+     * @return true for separate position and attribute streams
+     */
+    static bool hasSplitVertexStreams();
+
+    /**
+     * Return the vertex bindings and attributes matching the vertex format and streams of all meshes.
+     * 
+     * @param readsAttributes false if the vertex shader only reads the position
+     * @param[out] bindings descriptions of the bound vertex buffers
+     * @param[out] attributes descriptions of the attributes read by the shader
+     */
+    static void getVertexInput(bool readsAttributes, std::vector<VkVertexInputBindingDescription> &bindings, std::vector<VkVertexInputAttributeDescription> &attributes);
+
+    /**
+     * Return the offset restoring positions of packed vertices.
+     * 
+     * @return minimum corner of the bounding box, 0 for the full vertex format
+     */
+    glm::vec4 getPositionOffset();
+
+    /**
+     * Return the scale restoring positions of packed vertices.
+     * 
+     * @return extent of the bounding box, 1 for the full vertex format
+     */
+    glm::vec4 getPositionScale();
+
+    /**
+     * Write the geometry into the staging memory of a geometry arena.
+     * 
+     * Vertices are converted to the current vertex format and split into positions and attributes if streams are split.
+     * Indices stay relative to the first vertex of the mesh, the draw commands add its position in the arena as vertex offset.
+     * The bounds are computed first if they are missing, since packed vertices are quantized relative to the bounding box.
+     * 
+     * @param[out] vertices destination of the vertices, or only of the positions with split streams
+     * @param[out] attributes destination of the attributes with split streams, unused otherwise
+     * @param[out] indices destination of the indices
+     * @param indexType size of the indices in the arena, VK_INDEX_TYPE_UINT16 requires at most 65536 vertices
+     */
+    void writeGeometry(unsigned char *vertices, unsigned char *attributes, void *indices, VkIndexType indexType);
 
     /**
      * Create vulkan representation of the mesh.
      * 
-     * Has to be called before rendering the mesh.
+     * Called by the geometry arena once the vertices and indices have been uploaded into its buffers.
      * The geometry cannot be changed after.
-     * Vertex and index buffers are created, memory is allocated and filled with the specified data.
      * A pointer to the vulkan context is used to access the logical device.
      * 
      * @param context pointer to the vulkan context
+     * @param firstVertex position of the first vertex of the mesh in the vertex buffer of the arena
+     * @param firstIndex position of the first index of the mesh in the index buffer of the arena
+     * @param indexType size of the indices, decides which index buffer of the arena contains them
+     */
+    void createBuffers(std::shared_ptr<Context> &context, uint32_t firstVertex, uint32_t firstIndex, VkIndexType indexType);
+
+    /**
+     * Return the size of the indices in the geometry arena.
+     */
+    VkIndexType getIndexType();
+
+    /**
+     * Return the parameters of a draw command for the mesh inside its geometry arena.
+     * 
+     * Can be written into an indirect buffer to draw many meshes with a single vkCmdDrawIndexedIndirect.
+     * 
+     * @param numInstances number of instances of the mesh
+     * @param lod level of detail that is drawn, clamped to the available levels
+     * @return index range and vertex offset of the level of detail inside the arena
      */
-    void createBuffers(std::shared_ptr<Context> &context);
+    VkDrawIndexedIndirectCommand getDrawCommand(uint32_t numInstances, uint32_t lod = 0);
 
     /**
      * Add draw command to a provided command buffer.
      * 
+     * The buffers of the geometry arena containing the mesh have to be bound, including the index buffer matching getIndexType.
      * Instanced rendering is used if numInstances > 1.
      * 
      * @param commandBuffer graphics command buffer
      * @param numInstances number of instances of the mesh
+     * @param lod level of detail that is drawn, clamped to the available levels
      */
-    void render(VkCommandBuffer commandBuffer, uint32_t numInstances);
+    void render(VkCommandBuffer commandBuffer, uint32_t numInstances, uint32_t lod = 0);
 
     /**
      * Destroy all vulkan components.
      * 
-     * Vertex and index buffers are destroyed and the associated memory is freed up.
+     * The meshlet buffer is destroyed and the associated memory is freed up, vertices and indices belong to the geometry arena.
      * A pointer to the vulkan context is used to access the logical device.
      * 
      * @param context pointer to the vulkan context
@@ -146,28 +632,171 @@ public:
     
 private:
     /**
-     * Calculate the tangent for a vertex from position and texture coordinates.
+     * Calculate the tangent directions and corner angles of a batch of triangles.
+     * 
+     * @param firstTriangle index of the first triangle of the batch
+     * @param numTriangles number of triangles, at most tangentBatchSize
+     * @param[out] tangents tangent direction of each triangle scaled by its area
+     * @param[out] bitangents bitangent direction of each triangle scaled by its area
+     * @param[out] angles interior angle at each corner of the triangles
+     */
+    void calculateTriangleTangents(uint32_t firstTriangle, uint32_t numTriangles, glm::vec3 *tangents, glm::vec3 *bitangents, float *angles);
+
+    /**
+     * Simulate a FIFO vertex cache while processing triangles.
+     * 
+     * @param indices list of indices to process
+     * @param numIndices number of indices
+     * @param numVertices number of vertices referenced by the indices
+     * @param cacheSize number of vertices in the simulated cache
+     * @return total number of cache misses
+     */
+    static uint32_t simulateVertexCache(const uint32_t *indices, uint32_t numIndices, uint32_t numVertices, uint32_t cacheSize);
+
+    /**
+     * Compute a quadric measuring the squared distance to the plane of a triangle.
+     * 
+     * @param p0 first corner of the triangle
+     * @param p1 second corner of the triangle
+     * @param p2 third corner of the triangle
+     * @return quadric of the plane weighted by the triangle area, zero for degenerate triangles
+     */
+    static Quadric getPlaneQuadric(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2);
+
+    /**
+     * Add a quadric to another one.
+     * 
+     * @param[out] target quadric receiving the sum
+     * @param source added quadric
+     */
+    static void addQuadric(Quadric &target, const Quadric &source);
+
+    /**
+     * Evaluate a quadric for a point.
+     * 
+     * @param quadric quadric of a set of planes
+     * @param point point in local coordinates
+     * @return weighted average of the squared distances of the point to the planes
+     */
+    static double evaluateQuadric(const Quadric &quadric, glm::vec3 point);
+
+    /**
+     * Determine how each vertex may be moved during simplification.
+     * 
+     * Vertices sharing their position with another vertex lie on a texture or normal seam.
+     * Positions on edges with only one adjacent triangle lie on a border.
+     * Positions shared by more than two vertices, on non-manifold edges or on both a seam and a border are locked.
+     * 
+     * @param numIndices number of indices of the full resolution level
+     * @param[out] kinds kind of each vertex
+     * @param[out] twins other vertex at the same position for seam vertices, the vertex itself otherwise
+     */
+    void classifyVertices(uint32_t numIndices, std::vector<VertexKind> &kinds, std::vector<uint32_t> &twins);
+
+    /**
+     * Collapse edges until a triangle count is reached.
+     * 
+     * Collapses are done in passes: all edges are sorted by their cost and applied greedily,
+     * skipping edges whose surroundings have already changed during the pass or which would flip triangles.
+     * 
+     * @param[out] indices index list that is simplified
+     * @param[out] quadrics quadric of each vertex, accumulated when vertices are collapsed
+     * @param kinds kind of each vertex (see classifyVertices)
+     * @param twins other vertex at the same position for seam vertices
+     * @param targetTriangles number of triangles to reduce the mesh to
+     * @return square root of the highest collapse cost, an estimate of the geometric error
+     */
+    float collapseEdges(std::vector<uint32_t> &indices, std::vector<Quadric> &quadrics, const std::vector<VertexKind> &kinds, const std::vector<uint32_t> &twins, uint32_t targetTriangles);
+
+    /**
+     * Compute the bounding sphere and normal cone of a meshlet.
+     * 
+     * @param[out] meshlet meshlet with a valid index range
+     */
+    void computeMeshletBounds(Meshlet &meshlet);
+
+    /**
+     * Reorder the triangles of an index range for vertex cache locality.
      * 
-     * The tangent is determined for the vertex with index i0.
-     * The other vertices making up the triangle also have to be specified as index parameters.
+     * Triangles are emitted as fans around a vertex, the next fan vertex is chosen among the vertices
+     * that are still in the cache and have triangles left.
      * 
-     * @param i0 index of the vertex the tangent is assigned to
-     * @param i1 index of the next vertex in the triangle
-     * @param i2 index of the previous vertex in the triangle
-     * @return normalized tangent of the vertex with index i0
+     * @param firstIndex position of the first index of the range
+     * @param numIndices number of indices in the range, a multiple of 3
+     * @param cacheSize number of vertices in the targeted cache
      */
-    glm::vec3 getTangent(uint32_t i0, uint32_t i1, uint32_t i2);
+    void optimizeVertexCache(uint32_t firstIndex, uint32_t numIndices, uint32_t cacheSize);
+
+    /**
+     * Reorder clusters of triangles of an index range to reduce overdraw.
+     * 
+     * Expects triangles already ordered by optimizeVertexCache.
+     * A cluster ends as soon as its own cache miss ratio, starting from an empty cache, is
+     * close enough to that of the whole range, so the cache efficiency is mostly kept.
+     * 
+     * @param firstIndex position of the first index of the range
+     * @param numIndices number of indices in the range, a multiple of 3
+     * @param cacheSize number of vertices in the targeted cache
+     * @param threshold allowed increase of the cache miss ratio, e.g. 1.05
+     */
+    void optimizeOverdraw(uint32_t firstIndex, uint32_t numIndices, uint32_t cacheSize, float threshold);
+
+    /**
+     * Sort the vertices in the order they are first referenced by the index list.
+     * 
+     * Unreferenced vertices are removed.
+     * Since the full resolution level comes first, the vertices of all levels are ordered by their use in it.
+     */
+    void optimizeVertexFetch();
+
+    /**
+     * Map a unit vector onto the octahedron and unfold it into a square.
+     * 
+     * @param vector normalized vector
+     * @return coordinates in [-1, 1]
+     */
+    static glm::vec2 encodeOctahedral(glm::vec3 vector);
+
+    /**
+     * Convert vertices to the packed vertex format.
+     * 
+     * Determines the offset and scale of the positions from the bounding box of the vertices.
+     * 
+     * @param vertices first vertex to convert
+     * @param[out] packedVertices converted vertices, one for each vertex of the mesh
+     */
+    void packVertices(const Vertex *vertices, std::vector<PackedVertex> &packedVertices);
+
+    /**
+     * Copy mapped geometry into the vertex and index lists and release the mapping.
+     * 
+     * Does nothing if the mesh does not use mapped geometry.
+     */
+    void copyMappedGeometry();
 
     std::vector<Vertex> m_vertices; /**< List of vertices with required attributes */
     std::vector<uint32_t> m_indices; /**< List of indices assembling the vertices into triangles */
+    std::vector<MeshLod> m_lods; /**< Index ranges of the levels of detail, empty if there is only the full resolution */
+    BoundingBox m_boundingBox; /**< Axis aligned box enclosing all vertices */
+    glm::vec4 m_boundingSphere{0.0f}; /**< Center and radius of a sphere enclosing all vertices */
+    std::vector<Meshlet> m_meshlets; /**< Clusters of the full resolution level, empty if none have been generated */
+    glm::vec4 m_positionOffset{0.0f}; /**< Offset added to the positions of packed vertices in the shader */
+    glm::vec4 m_positionScale{1.0f}; /**< Scale applied to the positions of packed vertices in the shader */
 
-    bool m_hasBuffers = false; /**< Status of the buffers required for rendering */
+    static VertexFormat m_vertexFormat; /**< Layout of the vertex buffers of all meshes */
+    static bool m_splitVertexStreams; /**< If true positions and the other attributes are stored in separate buffers */
 
-    VkBuffer m_vertexBuffer = VK_NULL_HANDLE; /**< Vulkan handle of the vertex buffer */
-    VkDeviceMemory m_vertexMemory = VK_NULL_HANDLE; /**< Memory containing the vertex data */
+    std::shared_ptr<MappedFile> m_mappedFile = nullptr; /**< File containing the geometry if it is not stored in the lists */
+    const Vertex *m_mappedVertices = nullptr; /**< First vertex inside the mapped file */
+    const uint32_t *m_mappedIndices = nullptr; /**< First index inside the mapped file */
+    uint32_t m_numMappedVertices = 0; /**< Number of vertices inside the mapped file */
+    uint32_t m_numMappedIndices = 0; /**< Number of indices inside the mapped file */
+
+    bool m_hasBuffers = false; /**< Status of the buffers required for rendering */
 
-    VkBuffer m_indexBuffer = VK_NULL_HANDLE; /**< Vulkan handle of the index buffer */
-    VkDeviceMemory m_indexMemory = VK_NULL_HANDLE; /**< Memory containing the index data */
+    uint32_t m_firstVertex = 0; /**< Position of the first vertex in the vertex buffer of the geometry arena */
+    uint32_t m_firstIndex = 0; /**< Position of the first index in the index buffer of the geometry arena */
+    VkIndexType m_indexType = VK_INDEX_TYPE_UINT32; /**< Size of the indices, 16 bits if the mesh has no more than 65536 vertices */
 
 };
 
@@ -17,6 +17,10 @@ RenderMode RenderStep::getRenderMode() {
     return m_renderMode;
 }
 
+bool RenderStep::readsVertexAttributes() {
+    return m_readsVertexAttributes;
+}
+
 uint32_t RenderStep::getRenderSize() {
     return m_renderSize;
 }
@@ -55,12 +59,18 @@ void RenderStep::createShaderModules(const std::vector<std::string> &shaderFiles
             throw std::runtime_error("RENDER STEP ERROR: Could not create shader module: " + shaderFiles[shader]);
         }
         m_shaderStages.emplace_back(getShaderStage(shaderFiles[shader]));
+        if(m_shaderStages.back() == VK_SHADER_STAGE_VERTEX_BIT) {
+            m_readsVertexAttributes = ResourceLoader::readsVertexAttributes(shaderFiles[shader]);
+        }
     }
 
     m_descriptorSets.resize(m_numFramesInFlight);
     for(auto descriptorSetIndex : m_requiredDescriptorSets) {
         if(descriptorSetIndex < descriptorSets.size()) {
             m_descriptorSetLayouts.emplace_back(descriptorSets[descriptorSetIndex].getLayout());
+            if(descriptorSets[descriptorSetIndex].hasDynamicOffsets()) {
+                m_dynamicDescriptorSets.emplace_back(&descriptorSets[descriptorSetIndex]);
+            }
             for(uint32_t frame=0; frame<m_numFramesInFlight; frame++) {
                 m_descriptorSets[frame].emplace_back(descriptorSets[descriptorSetIndex].getSet(frame));
             }
@@ -116,12 +126,13 @@ void RenderStep::initRenderStep(RenderOutput &output, uint32_t subPassIndex) {
     pipelineInfo.pStages = shaderInfos.data();
 
     //vertex input as defined in Mesh
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+    Mesh::getVertexInput(m_readsVertexAttributes, bindingDescriptions, attributeDescriptions);
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
     pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -285,7 +296,11 @@ void RenderStep::start(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
     }
 
     vkCmdBindPipeline(commandBuffer, m_bindPoint, m_pipeline);
-    vkCmdBindDescriptorSets(commandBuffer, m_bindPoint, m_pipelineLayout, 0, m_descriptorSets[frameIndex].size(), m_descriptorSets[frameIndex].data(), 0, nullptr);
+    std::vector<uint32_t> dynamicOffsets;
+    for(auto descriptorSet : m_dynamicDescriptorSets) {
+        descriptorSet->getDynamicOffsets(frameIndex, dynamicOffsets);
+    }
+    vkCmdBindDescriptorSets(commandBuffer, m_bindPoint, m_pipelineLayout, 0, m_descriptorSets[frameIndex].size(), m_descriptorSets[frameIndex].data(), dynamicOffsets.size(), dynamicOffsets.data());
 }
 
 void RenderStep::end(VkCommandBuffer commandBuffer) {
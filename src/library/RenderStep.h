@@ -46,6 +46,13 @@ public:
      */
     RenderMode getRenderMode();
 
+    /**
+     * Return whether the vertex shader reads attributes other than the position.
+     * 
+     * @return false if only the position stream has to be bound
+     */
+    bool readsVertexAttributes();
+
     /**
      * Return the dispatch size or number of instances of the compute or draw call.
      */
@@ -157,10 +164,12 @@ private:
 
     std::vector<VkShaderModule> m_shaderModules; /**< Vulkan handles of the shader modules */
     std::vector<VkShaderStageFlagBits> m_shaderStages; /**< Vulkan shader stage flags for each shader module */
+    bool m_readsVertexAttributes = true; /**< If false the vertex shader only reads positions */
 
     std::vector<uint32_t> m_requiredDescriptorSets; /**< Absolute indices of the required descriptor sets */
     std::vector<VkDescriptorSetLayout> m_descriptorSetLayouts; /**< Layouts of the required descriptor sets */
     std::vector<std::vector<VkDescriptorSet>> m_descriptorSets; /**< Required descriptor sets for each frame in flight */
+    std::vector<DescriptorSet*> m_dynamicDescriptorSets; /**< Required descriptor sets with dynamic offsets, in the order they are bound */
 
     VkPrimitiveTopology m_primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; /**< Topology dictating how primitives are assembled for the rendered geometry */
     VkCullModeFlags m_cullMode = VK_CULL_MODE_NONE; /**< Culling settings */
@@ -94,7 +94,9 @@ void Renderer::setUpRenderOutput() {
 }
 
 void Renderer::setUpDescriptorSets() {
-    m_descriptorSets.resize(2, DescriptorSet(m_context, m_numSwapChainImages));
+    //uniforms of all descriptor sets are allocated from a single buffer
+    m_frameAllocator = std::make_shared<FrameAllocator>(m_context, m_numSwapChainImages);
+    m_descriptorSets.resize(2, DescriptorSet(m_context, m_numSwapChainImages, m_frameAllocator));
     m_descriptorSets[0].addBuffer("Camera", VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(CameraUniforms), false);
     m_descriptorSets[0].addBuffer("Renderer", VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(RendererUniforms), false);
 
@@ -160,6 +162,11 @@ void Renderer::createSyncObjects() {
 void Renderer::update() {
     uint32_t frameIndex = m_currentFrame % m_numSwapChainImages;
 
+    //the uniforms of this frame in flight are overwritten once the GPU is done with them
+    VkFence inFlightFences[] = {m_computeInFlightFences[frameIndex], m_graphicsInFlightFences[frameIndex]};
+    vkWaitForFences(m_context->getDevice(), 2, inFlightFences, VK_TRUE, UINT64_MAX);
+    m_frameAllocator->beginFrame(frameIndex);
+
     //update uniforms
     CameraUniforms camUniforms{
         m_camera->getViewMatrix(),
@@ -178,6 +185,7 @@ void Renderer::update() {
     m_descriptorSets[0].updateBuffer("Renderer", frameIndex, &rendererUniforms);
 
     m_scene->updateUniforms(m_descriptorSets, frameIndex);
+    m_frameAllocator->flush();
 
     compute();
 }
@@ -213,6 +221,9 @@ void Renderer::compute() {
             std::cout << "RENDERER ERROR: Could not record compute command buffer" << std::endl;
         }
 
+        //uploads recorded since the last submission start copying
+        m_context->getUploadManager()->flush();
+
         //submit compute command buffer to queue
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -270,6 +281,9 @@ void Renderer::render() {
         std::cout << "RENDERER ERROR: Could not record command buffer" << std::endl;
     }
 
+    //uploads recorded since the last frame start copying, finished ones are handed over to the graphics queue
+    m_context->getUploadManager()->flush();
+
     std::vector<VkSemaphore> waitSemaphores = {m_imageAvailableSemaphores[frameIndex]};
     if(false) { //!m_computePipelines.empty()
         waitSemaphores.emplace_back(m_computeFinishedSemaphores[frameIndex]);
@@ -322,6 +336,8 @@ void Renderer::recordGraphicsCommandBuffer() {
     uint32_t subPassIndex = 0;
     m_renderOutput[outputIndex].start(commandBuffer, frameIndex);
 
+    auto lodSelection = m_camera->getLodSelection(static_cast<float>(m_imageExtent.height));
+
 
     for(auto &renderStep : m_renderSteps) {
         if(renderStep.getOutputIndex() > outputIndex) {
@@ -337,9 +353,9 @@ void Renderer::recordGraphicsCommandBuffer() {
 
         renderStep.start(commandBuffer, frameIndex);
         if(renderStep.getRenderMode() == renderMeshes) {
-            m_scene->renderMeshes(commandBuffer, renderStep.getPipelineLayout(), renderStep.getRenderSize());
+            m_scene->renderMeshes(commandBuffer, renderStep.getPipelineLayout(), lodSelection, renderStep.getRenderSize(), renderStep.readsVertexAttributes());
         } else if(renderStep.getRenderMode() == renderLightProxies) {
-            m_scene->renderLightProxies(commandBuffer, renderStep.getPipelineLayout());
+            m_scene->renderLightProxies(commandBuffer, renderStep.getPipelineLayout(), renderStep.readsVertexAttributes());
         }
         renderStep.end(commandBuffer);
     }
@@ -357,6 +373,9 @@ void Renderer::cleanUp() {
     for(auto &descriptorSet : m_descriptorSets) {
         descriptorSet.cleanUp();
     }
+    if(m_frameAllocator != nullptr) {
+        m_frameAllocator->cleanUp();
+    }
     for(auto &step : m_renderSteps) {
         step.cleanUp();
     }
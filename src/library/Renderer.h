@@ -105,6 +105,7 @@ protected:
     VkFormat m_swapChainFormat = VK_FORMAT_R8G8B8A8_SRGB; /**< Color format used for swap chain images */
     VkFormat m_depthFormat; /**< Format suitable for depth buffers */
 
+    std::shared_ptr<FrameAllocator> m_frameAllocator; /**< Linear allocator for the uniforms of each frame, shared by all descriptor sets */
     std::vector<DescriptorSet> m_descriptorSets; /**< List of descriptor sets added to render steps as requested in the shaders */
     std::vector<RenderOutput> m_renderOutput; /**< List of output image sets to render to */
     std::vector<RenderStep> m_renderSteps; /**< Individual rendering steps iterated for every frame */
@@ -1,5 +1,16 @@
 #include "ResourceLoader.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+std::map<std::string, std::shared_future<std::shared_ptr<Image>>> ResourceLoader::m_pendingTextures;
+std::mutex ResourceLoader::m_pendingTexturesMutex;
+std::atomic<bool> ResourceLoader::m_compressTextures(true);
+
 std::vector<char> ResourceLoader::loadFile(const std::string &fileName) {
     std::ifstream file("../resources/shaders/spir-v/" + fileName, std::ios::ate | std::ios::binary);
     if(!file.is_open()) {
@@ -28,6 +39,9 @@ void ResourceLoader::findRequiredDescriptorSets(const std::string &fileName, std
     while(std::getline(file, line)) {
         if(line.substr(0, 8) == "#include") {
             auto descriptorName = line.substr(9, line.length() - 9);
+            if(descriptorName == "VertexPosition" || descriptorName == "VertexInput") {
+                continue;
+            }
             auto absoluteIndex = getDescriptorSetIndex(descriptorName);
             
             size_t setIndex = 0;
@@ -43,6 +57,22 @@ void ResourceLoader::findRequiredDescriptorSets(const std::string &fileName, std
     }
 }
 
+bool ResourceLoader::readsVertexAttributes(const std::string &fileName) {
+    std::ifstream file("../resources/shaders/" + fileName, std::ios::ate | std::ios::binary);
+    if(!file.is_open()) {
+        throw std::runtime_error("RESOURCE LOADER ERROR: Could not read file: " + fileName);
+    }
+
+    file.seekg(0);
+    std::string line;
+    while(std::getline(file, line)) {
+        if(line.substr(0, 20) == "#include VertexInput") {
+            return true;
+        }
+    }
+    return false;
+}
+
 uint32_t ResourceLoader::getDescriptorSetIndex(std::string descriptorName) {
     if(descriptorName == "Camera" || descriptorName == "Renderer") {
         return 0;
@@ -82,6 +112,11 @@ std::string ResourceLoader::compileShader(const std::string &fileName, std::vect
         }
         if(line.substr(0, 8) == "#include") {
             auto descriptorName = line.substr(9, line.length() - 9);
+            if(descriptorName == "VertexPosition" || descriptorName == "VertexInput") {
+                //vertex attributes do not belong to a descriptor set
+                outputFile << getDescriptorText(descriptorName, 0, sceneCounts);
+                continue;
+            }
             auto absoluteIndex = getDescriptorSetIndex(descriptorName);
 
             uint32_t setIndex = 0;
@@ -170,8 +205,59 @@ std::string ResourceLoader::getDescriptorText(std::string descriptorName, uint32
     } else if(descriptorName == "SceneNodeConstants") {
         return std::string("layout(push_constant, std430) uniform SceneNodeConstants {\n")
         + "   mat4 model;\n"
+        + "   vec4 positionOffset;\n"
+        + "   vec4 positionScale;\n"
         + "   uint currentIndex;\n"
         + "};\n\n";
+    } else if(descriptorName == "VertexPosition" || descriptorName == "VertexInput") {
+        bool packed = Mesh::getVertexFormat() == packedVertexFormat;
+        std::string text = "layout(location = 0) in vec4 inPosition;\n\n";
+        if(packed) {
+            text = text + "vec4 getPosition() {\n"
+            + "   return vec4(positionOffset.xyz + inPosition.xyz * positionScale.xyz, 1.0);\n"
+            + "}\n\n";
+        } else {
+            text = text + "vec4 getPosition() {\n"
+            + "   return inPosition;\n"
+            + "}\n\n";
+        }
+        if(descriptorName == "VertexPosition") {
+            return text;
+        }
+
+        if(packed) {
+            return text + "layout(location = 1) in vec2 inNormal;\n"
+            + "layout(location = 2) in vec2 inTexCoord;\n"
+            + "layout(location = 3) in vec2 inTangent;\n\n"
+            + "vec3 decodeOctahedral(vec2 encoded) {\n"
+            + "   vec3 vector = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));\n"
+            + "   float fold = max(-vector.z, 0.0);\n"
+            + "   vector.x += vector.x >= 0.0 ? -fold : fold;\n"
+            + "   vector.y += vector.y >= 0.0 ? -fold : fold;\n"
+            + "   return normalize(vector);\n"
+            + "}\n\n"
+            + "vec3 getNormal() {\n"
+            + "   return decodeOctahedral(inNormal);\n"
+            + "}\n\n"
+            + "vec2 getTexCoord() {\n"
+            + "   return inTexCoord;\n"
+            + "}\n\n"
+            + "vec4 getTangent() {\n"
+            + "   return vec4(decodeOctahedral(inTangent), inPosition.w * 2.0 - 1.0);\n"
+            + "}\n\n";
+        }
+        return text + "layout(location = 1) in vec3 inNormal;\n"
+        + "layout(location = 2) in vec2 inTexCoord;\n"
+        + "layout(location = 3) in vec4 inTangent;\n\n"
+        + "vec3 getNormal() {\n"
+        + "   return inNormal;\n"
+        + "}\n\n"
+        + "vec2 getTexCoord() {\n"
+        + "   return inTexCoord;\n"
+        + "}\n\n"
+        + "vec4 getTangent() {\n"
+        + "   return inTangent;\n"
+        + "}\n\n";
     } else if(descriptorName == "GBuffer") {
         return "layout(input_attachment_index = 0, set = " + std::to_string(setIndex) + ", binding = 0) uniform subpassInputMS gBufferNormals;\n"
         + "layout(input_attachment_index = 1, set = " + std::to_string(setIndex) + ", binding = 1) uniform subpassInputMS gBufferMaterials1;\n"
@@ -182,158 +268,1415 @@ std::string ResourceLoader::getDescriptorText(std::string descriptorName, uint32
     throw std::runtime_error("RESOURCE LOADER ERROR: There is no descriptor with name " + descriptorName);
 }
 
-void ResourceLoader::loadModel(const std::string &fileName, std::unique_ptr<SceneNode> &parent) {
+void ResourceLoader::loadModel(const std::string &fileName, std::unique_ptr<SceneNode> &parent, uint32_t numThreads, bool useCache, bool optimizeMeshes) {
+    auto extension = fileName.substr(std::min(fileName.size(), fileName.find_last_of('.')));
+    if(extension == ".glb" || extension == ".gltf") {
+        loadGltfModel(fileName, parent, numThreads, optimizeMeshes);
+        return;
+    }
+
+    //the cache only contains optimized meshes
+    useCache = useCache && optimizeMeshes;
+    if(useCache && loadModelCache(fileName, parent)) {
+        return;
+    }
+
+    if(numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
     //load materials first
     std::vector<std::shared_ptr<Material>> materials;
+    loadMaterials(fileName, materials);
 
-    size_t startPos, endPos;
+    MappedFile objFile("../resources/models/" + fileName + ".obj");
 
-    std::ifstream mtlFile("../resources/models/" + fileName + ".mtl", std::ios::ate | std::ios::binary);
-    if(!mtlFile.is_open()) {
-        throw std::runtime_error("RESOURCE LOADER ERROR: Could not read file: " + fileName + ".mtl");
+    //split the file into chunks ending at line breaks, small files are not worth splitting
+    const size_t minChunkSize = 256 * 1024;
+    size_t numChunks = std::max(static_cast<size_t>(1), std::min(static_cast<size_t>(numThreads), objFile.getSize() / minChunkSize));
+    std::vector<const char*> chunkBounds = {objFile.begin()};
+    for(size_t c=1; c<numChunks; c++) {
+        const char *bound = std::max(chunkBounds.back(), objFile.begin() + c * (objFile.getSize() / numChunks));
+        findLineEnd(bound, objFile.end(), bound);
+        chunkBounds.emplace_back(bound);
     }
+    chunkBounds.emplace_back(objFile.end());
 
-    mtlFile.seekg(0);
-    std::string line;
-    while(std::getline(mtlFile, line)) {
-        if(line.substr(0, 6) == "newmtl") {
+    //tokenize all chunks in parallel
+    std::vector<ObjChunk> chunks(numChunks);
+    runParallel(static_cast<uint32_t>(numChunks), [&](uint32_t c) {
+        parseObjChunk(chunkBounds[c], chunkBounds[c + 1], chunks[c]);
+    });
+
+    //concatenate the attributes and convert chunk relative indices into global ones
+    std::vector<glm::vec3> loadedPositions;
+    std::vector<glm::vec3> loadedNormals;
+    std::vector<glm::vec2> loadedTexCoords;
+    glm::ivec3 offsets(0);
+    for(auto &chunk : chunks) {
+        for(auto relativeIndex : chunk.relativeIndices) {
+            chunk.faceVertices[relativeIndex / 3][relativeIndex % 3] += offsets[relativeIndex % 3];
+        }
+        loadedPositions.insert(loadedPositions.end(), chunk.positions.begin(), chunk.positions.end());
+        loadedTexCoords.insert(loadedTexCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        loadedNormals.insert(loadedNormals.end(), chunk.normals.begin(), chunk.normals.end());
+        offsets += glm::ivec3(chunk.positions.size(), chunk.texCoords.size(), chunk.normals.size());
+        std::vector<glm::vec3>().swap(chunk.positions);
+        std::vector<glm::vec2>().swap(chunk.texCoords);
+        std::vector<glm::vec3>().swap(chunk.normals);
+    }
+
+    //replay the object and material statements to find the faces belonging to each mesh
+    std::vector<ObjMeshRange> meshRanges;
+    bool hasCurrentMesh = false;
+    std::string currentMatName;
+    for(uint32_t c=0; c<numChunks; c++) {
+        auto &chunk = chunks[c];
+        uint32_t firstFace = 0;
+        for(size_t s=0; s<=chunk.statements.size(); s++) {
+            auto lastFace = s < chunk.statements.size() ? chunk.statements[s].faceIndex : static_cast<uint32_t>(chunk.faceStarts.size());
+            if(lastFace > firstFace) {
+                if(!hasCurrentMesh) {
+                    meshRanges.emplace_back();
+                    meshRanges.back().materialName = currentMatName;
+                    hasCurrentMesh = true;
+                }
+                meshRanges.back().segments.emplace_back(c, firstFace, lastFace);
+                firstFace = lastFace;
+            }
+            if(s == chunk.statements.size()) {
+                break;
+            }
+
+            auto &statement = chunk.statements[s];
+            if(statement.startsObject) {
+                hasCurrentMesh = false;
+            } else if(statement.materialName != currentMatName) {
+                currentMatName = statement.materialName;
+                hasCurrentMesh = false;
+            }
+        }
+    }
+
+    std::vector<size_t> matIndices(meshRanges.size());
+    for(size_t m=0; m<meshRanges.size(); m++) {
+        size_t matIndex = 0;
+        while(matIndex < materials.size() && materials[matIndex]->getName() != meshRanges[m].materialName) {
+            matIndex++;
+        }
+        if(matIndex >= materials.size()) {
+            if(!meshRanges[m].materialName.empty()) {
+                throw std::runtime_error("RESOURCE LOADER ERROR: Could not assign a material to name " + meshRanges[m].materialName);
+            }
+            //faces without any material statement get a default material
             materials.emplace_back(std::make_shared<Material>());
-            materials.back()->setName(line.substr(7));
+        }
+        matIndices[m] = matIndex;
+    }
 
-        } else if(line.substr(0, 2) == "Kd") {
-            materials.back()->setColor(textToVec3(line.substr(3)));
+    //meshes are independent of each other and can be assembled in parallel
+    std::vector<std::shared_ptr<Mesh>> meshes(meshRanges.size());
+    std::atomic<uint32_t> nextMesh(0);
+    runParallel(std::min(numThreads, static_cast<uint32_t>(meshRanges.size())), [&](uint32_t) {
+        for(uint32_t m = nextMesh++; m < meshRanges.size(); m = nextMesh++) {
+            meshes[m] = std::make_shared<Mesh>();
+            buildObjMesh(chunks, meshRanges[m], loadedPositions, loadedNormals, loadedTexCoords, meshes[m]);
 
-        } else if(line.substr(0, 6) == "map_Kd") {
-            startPos = line.find_last_of('/');
-            materials.back()->setDiffuseTexture(line.substr(startPos+1));
-        } else if(line.substr(0, 2) == "Ks") {
-            auto specular = textToVec3(line.substr(3));
-            materials.back()->setSpecular((specular.x + specular.y + specular.z) / 3.0f);
+            if(materials[matIndices[m]]->hasNormalTexture()) {
+                //threads not needed for other meshes help with the tangents
+                meshes[m]->calculateTangents(std::max(1u, numThreads / static_cast<uint32_t>(meshRanges.size())));
+            }
+            meshes[m]->computeBounds();
+            if(optimizeMeshes) {
+                meshes[m]->generateLods();
+                meshes[m]->optimize();
+                meshes[m]->generateMeshlets();
+            }
+        }
+    });
+
+    if(useCache) {
+        writeModelCache(fileName, materials, meshes, matIndices);
+    }
+
+    for(size_t m=0; m<meshes.size(); m++) {
+        auto sceneNode = std::make_unique<SceneNode>(meshes[m], materials[matIndices[m]]);
+        parent->addChild(sceneNode);
+    }
+}
+
+std::future<std::unique_ptr<SceneNode>> ResourceLoader::loadModelAsync(const std::string &fileName, uint32_t numThreads) {
+    //the pool runs one worker per hardware thread, parsing threads started from a worker only add to that
+    numThreads = std::max(1u, numThreads);
+    return getThreadPool().submit([fileName, numThreads]() {
+        auto modelNode = std::make_unique<SceneNode>();
+        loadModel(fileName, modelNode, numThreads);
+
+        //start decoding the textures right away instead of waiting for the scene to ask for them
+        loadNodeTexturesAsync(modelNode);
+
+        return modelNode;
+    });
+}
+
+void ResourceLoader::loadMaterialTexturesAsync(std::shared_ptr<Material> &material) {
+    if(material->hasDiffuseTexture()) {
+        loadTextureAsync(material->getDiffuseTexture(), getTextureEncoding(bc7Encoding));
+    }
+    if(material->hasNormalTexture()) {
+        loadTextureAsync(material->getNormalTexture(), getTextureEncoding(bc5Encoding));
+    }
+    if(material->hasRoughnessTexture()) {
+        loadTextureAsync(material->getRoughnessTexture(), getTextureEncoding(bc4Encoding));
+    }
+    if(material->hasMetallicTexture()) {
+        loadTextureAsync(material->getMetallicTexture(), getTextureEncoding(bc4Encoding));
+    }
+}
+
+std::shared_future<std::shared_ptr<Image>> ResourceLoader::loadTextureAsync(const std::string &fileName, TextureEncoding encoding) {
+    auto key = normalizePath(fileName) + ":" + BlockEncoder::getName(encoding);
+    std::lock_guard<std::mutex> lock(m_pendingTexturesMutex);
+    auto pending = m_pendingTextures.find(key);
+    if(pending != m_pendingTextures.end()) {
+        return pending->second;
+    }
 
-        } else if(line.substr(0, 2) == "Ns") {
-            materials.back()->setRoughness(1.0f - 0.001f * std::stof(line.substr(3)));
+    std::shared_future<std::shared_ptr<Image>> texture = getThreadPool().submit([fileName, encoding]() {
+        //the pool already runs one task per hardware thread, so each texture is encoded on its worker alone
+        auto image = std::make_shared<Image>(0, 0);
+        image->decodeTexture(fileName, encoding, 1);
+        return image;
+    }).share();
+    m_pendingTextures[key] = texture;
+    return texture;
+}
 
-        } else if(line.substr(0, 6) == "map_Ns") {
-            startPos = line.find_last_of('/');
-            materials.back()->setRoughnessTexture(line.substr(startPos+1));
-        } else if(line.substr(0, 8) == "map_Bump") {
-            startPos = line.find_last_of('/');
-            materials.back()->setNormalTexture(line.substr(startPos+1));
+std::shared_ptr<Image> ResourceLoader::takeTexture(const std::string &fileName, TextureEncoding encoding) {
+    std::shared_future<std::shared_ptr<Image>> texture;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingTexturesMutex);
+        auto pending = m_pendingTextures.find(normalizePath(fileName) + ":" + BlockEncoder::getName(encoding));
+        if(pending != m_pendingTextures.end()) {
+            texture = pending->second;
+            m_pendingTextures.erase(pending);
         }
     }
-    mtlFile.close();
 
-    std::ifstream objFile("../resources/models/" + fileName + ".obj", std::ios::ate | std::ios::binary);
-    if(!objFile.is_open()) {
-        throw std::runtime_error("RESOURCE LOADER ERROR: Could not read file: " + fileName + ".obj");
+    if(texture.valid()) {
+        return texture.get();
     }
+    auto image = std::make_shared<Image>(0, 0);
+    image->decodeTexture(fileName, encoding);
+    return image;
+}
 
-    std::vector<glm::vec3> loadedPositions;
-    std::vector<glm::vec3> loadedNormals;
-    std::vector<glm::vec2> loadedTexCoords;
-    size_t numVertsPerFace;
-    uint32_t vertexOffset = 0;
-    size_t indexStart, indexEnd;
+void ResourceLoader::setTextureCompression(bool enable) {
+    m_compressTextures = enable;
+    if(enable) {
+        return;
+    }
 
-    std::vector<std::shared_ptr<Mesh>> meshes;
-    std::vector<std::string> matNames;
+    //compressed textures requested before are never taken, they are dropped once their task finishes
+    std::string suffix = ":" + BlockEncoder::getName(rgbaEncoding);
+    std::lock_guard<std::mutex> lock(m_pendingTexturesMutex);
+    auto pending = m_pendingTextures.begin();
+    while(pending != m_pendingTextures.end()) {
+        auto &key = pending->first;
+        if(key.size() >= suffix.size() && key.compare(key.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            pending++;
+        } else {
+            pending = m_pendingTextures.erase(pending);
+        }
+    }
+}
+
+TextureEncoding ResourceLoader::getTextureEncoding(TextureEncoding compressedEncoding) {
+    return m_compressTextures ? compressedEncoding : rgbaEncoding;
+}
+
+std::string ResourceLoader::normalizePath(const std::string &path) {
+    std::vector<std::string> segments;
+    size_t start = 0;
+    while(start <= path.size()) {
+        size_t end = path.find_first_of("/\\", start);
+        if(end == std::string::npos) {
+            end = path.size();
+        }
+        auto segment = path.substr(start, end - start);
+        if(segment == ".." && !segments.empty() && segments.back() != "..") {
+            segments.pop_back();
+        } else if(!segment.empty() && segment != ".") {
+            segments.emplace_back(segment);
+        }
+        start = end + 1;
+    }
 
-    objFile.seekg(0);
-    while(std::getline(objFile, line)) {
-        if(line.substr(0, 1) == "o" || line.length() == 0) {
-            meshes.emplace_back(std::make_shared<Mesh>());
-            vertexOffset = 0;
+    std::string normalized;
+    for(auto &segment : segments) {
+        if(!normalized.empty()) {
+            normalized += '/';
+        }
+        normalized += segment;
+    }
+#ifdef _WIN32
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+#endif
+    return normalized;
+}
 
-        } else if(line.substr(0, 6) == "usemtl") {
-            matNames.emplace_back(line.substr(7));
+ThreadPool &ResourceLoader::getThreadPool() {
+    static ThreadPool threadPool;
+    return threadPool;
+}
 
-        } else if(line.substr(0, 2) == "vn") {
-            loadedNormals.emplace_back(ResourceLoader::textToVec3(line.substr(3)));
-            
-        } else if(line.substr(0, 2) == "vt") {
-            loadedTexCoords.emplace_back(ResourceLoader::textToVec2(line.substr(3)));
-
-        } else if(line.substr(0, 1) == "v") {
-            loadedPositions.emplace_back(ResourceLoader::textToVec3(line.substr(2)));
-
-        } else if(line.substr(0, 1) == "f") {
-            numVertsPerFace = 0;
-            startPos = 2;
-            while(startPos >= 2 && startPos < line.length()) {
-                endPos = line.find(' ', startPos);
-                auto indices = line.substr(startPos, glm::min(endPos, line.length())-startPos);
-
-                indexStart = 0;
-                indexEnd = indices.find('/', indexStart);
-                auto posIndex = static_cast<uint32_t>(std::stoul(indices.substr(indexStart, indexEnd-indexStart)) - 1);
-                indexStart = indexEnd+1;
-                indexEnd = indices.find('/', indexStart);
-                auto texCoordIndex = static_cast<uint32_t>(std::stoul(indices.substr(indexStart, indexEnd-indexStart)) - 1);
-                indexStart = indexEnd+1;
-                auto normalIndex = static_cast<uint32_t>(std::stoul(indices.substr(indexStart, indices.length()-indexStart)) - 1);
-                meshes.back()->addVertex(
-                    loadedPositions[posIndex],
-                    loadedNormals[normalIndex],
-                    loadedTexCoords[texCoordIndex],
-                    glm::vec3(0.0f)
-                );
+bool ResourceLoader::getModelSourceStatus(const std::string &fileName, ModelCacheHeader &header, bool computeHash) {
+    std::string objPath = "../resources/models/" + fileName + ".obj";
+    std::string mtlPath = "../resources/models/" + fileName + ".mtl";
+    if(!MappedFile::getFileStatus(objPath, header.objSize, header.objModificationTime)
+        || !MappedFile::getFileStatus(mtlPath, header.mtlSize, header.mtlModificationTime)) {
+        return false;
+    }
 
-                numVertsPerFace++;
-                startPos = endPos+1;
-            }
-            if(numVertsPerFace == 3) {
-                meshes.back()->addIndex(vertexOffset);
-                meshes.back()->addIndex(vertexOffset + 1);
-                meshes.back()->addIndex(vertexOffset + 2);
-            } else if(numVertsPerFace == 4) {
-                meshes.back()->addIndex(vertexOffset);
-                meshes.back()->addIndex(vertexOffset + 1);
-                meshes.back()->addIndex(vertexOffset + 2);
-                meshes.back()->addIndex(vertexOffset + 2);
-                meshes.back()->addIndex(vertexOffset + 3);
-                meshes.back()->addIndex(vertexOffset);
+    header.contentHash = 0;
+    if(computeHash) {
+        header.contentHash = MappedFile(objPath).computeHash(MappedFile(mtlPath).computeHash());
+    }
+    return true;
+}
+
+bool ResourceLoader::loadModelCache(const std::string &fileName, std::unique_ptr<SceneNode> &parent) {
+    std::string cachePath = "../resources/models/" + fileName + ".slbmesh";
+    uint64_t cacheSize, cacheModificationTime;
+    ModelCacheHeader sourceStatus;
+    if(!MappedFile::getFileStatus(cachePath, cacheSize, cacheModificationTime) || cacheSize < sizeof(ModelCacheHeader)
+        || !getModelSourceStatus(fileName, sourceStatus, false)) {
+        return false;
+    }
+
+    auto cacheFile = std::make_shared<MappedFile>(cachePath);
+    ModelCacheHeader header;
+    std::memcpy(&header, cacheFile->begin(), sizeof(header));
+    if(std::memcmp(header.magic, "SLBMESH", 8) != 0 || header.version != modelCacheVersion || header.vertexSize != sizeof(Vertex)
+        || header.objSize != sourceStatus.objSize || header.mtlSize != sourceStatus.mtlSize) {
+        return false;
+    }
+    //touched but unchanged source files are recognized by their contents
+    if(header.objModificationTime != sourceStatus.objModificationTime || header.mtlModificationTime != sourceStatus.mtlModificationTime) {
+        getModelSourceStatus(fileName, sourceStatus, true);
+        if(header.contentHash != sourceStatus.contentHash) {
+            return false;
+        }
+    }
+
+    //materials
+    const char *cursor = cacheFile->begin() + sizeof(header);
+    std::vector<std::shared_ptr<Material>> materials;
+    for(uint32_t m=0; m<header.numMaterials; m++) {
+        ModelCacheMaterial record;
+        if(static_cast<size_t>(cacheFile->end() - cursor) < sizeof(record)) {
+            return false;
+        }
+        std::memcpy(&record, cursor, sizeof(record));
+        cursor += sizeof(record);
+
+        std::string strings[5];
+        for(int i=0; i<5; i++) {
+            if(static_cast<size_t>(cacheFile->end() - cursor) < record.stringLengths[i]) {
+                return false;
             }
-            
-            vertexOffset += numVertsPerFace;
+            strings[i].assign(cursor, record.stringLengths[i]);
+            cursor += record.stringLengths[i];
+        }
+
+        materials.emplace_back(std::make_shared<Material>(record.parameters.color, record.parameters.roughness));
+        materials.back()->setName(strings[0]);
+        materials.back()->setMetallic(record.parameters.metallic);
+        materials.back()->setSpecular(record.parameters.specular);
+        materials.back()->setSpecularTint(record.parameters.specularTint);
+        materials.back()->setSheen(record.parameters.sheen);
+        materials.back()->setSheenTint(record.parameters.sheenTint);
+        materials.back()->setDiffuseTexture(strings[1]);
+        materials.back()->setNormalTexture(strings[2]);
+        materials.back()->setRoughnessTexture(strings[3]);
+        materials.back()->setMetallicTexture(strings[4]);
+    }
+
+    //meshes referencing the mapped geometry
+    if(static_cast<size_t>(cacheFile->end() - cursor) / sizeof(ModelCacheMesh) < header.numMeshes) {
+        return false;
+    }
+    std::vector<std::shared_ptr<Mesh>> meshes;
+    std::vector<size_t> matIndices;
+    for(uint32_t m=0; m<header.numMeshes; m++) {
+        ModelCacheMesh record;
+        std::memcpy(&record, cursor, sizeof(record));
+        cursor += sizeof(record);
+
+        if(record.materialIndex >= materials.size() || record.vertexOffset % 16 != 0 || record.indexOffset % 4 != 0
+            || record.vertexOffset > cacheSize || (cacheSize - record.vertexOffset) / sizeof(Vertex) < record.numVertices
+            || record.indexOffset > cacheSize || (cacheSize - record.indexOffset) / sizeof(uint32_t) < record.numIndices
+            || record.numLods == 0 || record.numLods > maxMeshLods
+            || record.meshletOffset % 16 != 0 || record.meshletOffset > cacheSize || (cacheSize - record.meshletOffset) / sizeof(Meshlet) < record.numMeshlets) {
+            return false;
+        }
+        std::vector<MeshLod> lods(record.lods, record.lods + record.numLods);
+        for(auto &lod : lods) {
+            if(lod.firstIndex > record.numIndices || record.numIndices - lod.firstIndex < lod.numIndices) {
+                return false;
+            }
+        }
+
+        meshes.emplace_back(std::make_shared<Mesh>());
+        meshes.back()->setMappedGeometry(
+            cacheFile,
+            reinterpret_cast<const Vertex*>(cacheFile->begin() + record.vertexOffset),
+            record.numVertices,
+            reinterpret_cast<const uint32_t*>(cacheFile->begin() + record.indexOffset),
+            record.numIndices
+        );
+        if(lods.size() > 1) {
+            meshes.back()->setLods(lods);
         }
+        meshes.back()->setBoundingBox(record.boundingBox);
+        meshes.back()->setBoundingSphere(record.boundingSphere);
+        //meshlets are small enough to be copied out of the mapping
+        std::vector<Meshlet> meshlets(record.numMeshlets);
+        std::memcpy(meshlets.data(), cacheFile->begin() + record.meshletOffset, meshlets.size() * sizeof(Meshlet));
+        for(auto &meshlet : meshlets) {
+            if(meshlet.firstIndex > record.numIndices || record.numIndices - meshlet.firstIndex < meshlet.numIndices) {
+                return false;
+            }
+        }
+        meshes.back()->setMeshlets(meshlets);
+        matIndices.emplace_back(record.materialIndex);
     }
-    objFile.close();
 
     for(size_t m=0; m<meshes.size(); m++) {
-        size_t matIndex = 0;
-        while(matIndex < materials.size() && materials[matIndex]->getName() != matNames[m]) {
-            matIndex++;
+        auto sceneNode = std::make_unique<SceneNode>(meshes[m], materials[matIndices[m]]);
+        parent->addChild(sceneNode);
+    }
+
+    return true;
+}
+
+void ResourceLoader::writeModelCache(const std::string &fileName, std::vector<std::shared_ptr<Material>> &materials,
+    std::vector<std::shared_ptr<Mesh>> &meshes, std::vector<size_t> &matIndices) {
+    ModelCacheHeader header{};
+    std::memcpy(header.magic, "SLBMESH", 8);
+    header.version = modelCacheVersion;
+    header.vertexSize = sizeof(Vertex);
+    header.numMaterials = static_cast<uint32_t>(materials.size());
+    header.numMeshes = static_cast<uint32_t>(meshes.size());
+    if(!getModelSourceStatus(fileName, header, true)) {
+        return;
+    }
+
+    //write to a temporary file first so an interrupted write never leaves a broken cache behind
+    std::string cachePath = "../resources/models/" + fileName + ".slbmesh";
+    std::ofstream cacheFile(cachePath + ".tmp", std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!cacheFile.is_open()) {
+        std::cout << "   RESOURCE LOADER: Could not write model cache " << cachePath << std::endl;
+        return;
+    }
+
+    uint64_t offset = sizeof(header);
+    cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for(auto &material : materials) {
+        std::string strings[5] = {
+            material->getName(),
+            material->getDiffuseTexture(),
+            material->getNormalTexture(),
+            material->getRoughnessTexture(),
+            material->getMetallicTexture()
+        };
+        ModelCacheMaterial record{};
+        record.parameters = material->getUniformData();
+        for(int i=0; i<5; i++) {
+            record.stringLengths[i] = static_cast<uint32_t>(strings[i].size());
         }
-        if(matIndex >= materials.size()) {
-            throw std::runtime_error("RESOURCE LOADER ERROR: Could not assign a material to name " + matNames[m]);
+        cacheFile.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        offset += sizeof(record);
+        for(int i=0; i<5; i++) {
+            cacheFile.write(strings[i].data(), strings[i].size());
+            offset += strings[i].size();
+        }
+    }
+
+    //geometry starts behind the mesh records, aligned to 16 bytes
+    std::vector<ModelCacheMesh> records(meshes.size());
+    uint64_t dataOffset = offset + meshes.size() * sizeof(ModelCacheMesh);
+    for(size_t m=0; m<meshes.size(); m++) {
+        records[m].materialIndex = static_cast<uint32_t>(matIndices[m]);
+        records[m].numVertices = meshes[m]->getNumVertices();
+        records[m].numIndices = meshes[m]->getNumIndices();
+        records[m].numLods = meshes[m]->getNumLods();
+        records[m].boundingSphere = meshes[m]->getBoundingSphere();
+        records[m].boundingBox = meshes[m]->getBoundingBox();
+        for(uint32_t l=0; l<records[m].numLods; l++) {
+            records[m].lods[l] = meshes[m]->getLod(l);
+        }
+        dataOffset = (dataOffset + 15) & ~static_cast<uint64_t>(15);
+        records[m].vertexOffset = dataOffset;
+        dataOffset += records[m].numVertices * sizeof(Vertex);
+        dataOffset = (dataOffset + 15) & ~static_cast<uint64_t>(15);
+        records[m].indexOffset = dataOffset;
+        dataOffset += records[m].numIndices * sizeof(uint32_t);
+        dataOffset = (dataOffset + 15) & ~static_cast<uint64_t>(15);
+        records[m].numMeshlets = static_cast<uint32_t>(meshes[m]->getMeshlets().size());
+        records[m].meshletOffset = dataOffset;
+        dataOffset += records[m].numMeshlets * sizeof(Meshlet);
+    }
+    cacheFile.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(ModelCacheMesh));
+    offset += records.size() * sizeof(ModelCacheMesh);
+
+    const char padding[16] = {};
+    for(size_t m=0; m<meshes.size(); m++) {
+        cacheFile.write(padding, records[m].vertexOffset - offset);
+        cacheFile.write(reinterpret_cast<const char*>(meshes[m]->getVertices().data()), records[m].numVertices * sizeof(Vertex));
+        offset = records[m].vertexOffset + records[m].numVertices * sizeof(Vertex);
+        cacheFile.write(padding, records[m].indexOffset - offset);
+        cacheFile.write(reinterpret_cast<const char*>(meshes[m]->getIndices().data()), records[m].numIndices * sizeof(uint32_t));
+        offset = records[m].indexOffset + records[m].numIndices * sizeof(uint32_t);
+        cacheFile.write(padding, records[m].meshletOffset - offset);
+        cacheFile.write(reinterpret_cast<const char*>(meshes[m]->getMeshlets().data()), records[m].numMeshlets * sizeof(Meshlet));
+        offset = records[m].meshletOffset + records[m].numMeshlets * sizeof(Meshlet);
+    }
+
+    cacheFile.close();
+    if(cacheFile.fail()) {
+        std::remove((cachePath + ".tmp").c_str());
+        std::cout << "   RESOURCE LOADER: Could not write model cache " << cachePath << std::endl;
+        return;
+    }
+    std::remove(cachePath.c_str());
+    std::rename((cachePath + ".tmp").c_str(), cachePath.c_str());
+}
+
+void ResourceLoader::loadGltfModel(const std::string &fileName, std::unique_ptr<SceneNode> &parent, uint32_t numThreads, bool optimizeMeshes) {
+    if(numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    //buffers are located relative to the model file
+    std::string directory = fileName.substr(0, fileName.find_last_of("/\\") + 1);
+    MappedFile file("../resources/models/" + fileName);
+
+    //a .glb file starts with a header followed by a JSON chunk and an optional binary chunk, a .gltf file is only JSON
+    const char *jsonBegin = file.begin();
+    const char *jsonEnd = file.end();
+    GltfBuffer binaryChunk;
+    uint32_t header[3] = {0, 0, 0};
+    if(file.getSize() >= sizeof(header)) {
+        std::memcpy(header, file.begin(), sizeof(header));
+    }
+    if(header[0] == 0x46546C67) { //"glTF"
+        if(header[1] != 2 || header[2] > file.getSize()) {
+            throw std::runtime_error("RESOURCE LOADER ERROR: Invalid GLB header in " + fileName);
+        }
+        const char *cursor = file.begin() + sizeof(header);
+        const char *end = file.begin() + header[2];
+        bool hasJson = false;
+        while(end - cursor >= 8) {
+            uint32_t chunkHeader[2];
+            std::memcpy(chunkHeader, cursor, sizeof(chunkHeader));
+            cursor += sizeof(chunkHeader);
+            if(chunkHeader[0] > static_cast<size_t>(end - cursor)) {
+                throw std::runtime_error("RESOURCE LOADER ERROR: Invalid GLB chunk in " + fileName);
+            }
+            if(!hasJson) {
+                if(chunkHeader[1] != 0x4E4F534A) { //"JSON"
+                    throw std::runtime_error("RESOURCE LOADER ERROR: The first chunk of " + fileName + " does not contain JSON");
+                }
+                jsonBegin = cursor;
+                jsonEnd = cursor + chunkHeader[0];
+                hasJson = true;
+            } else if(chunkHeader[1] == 0x004E4942 && binaryChunk.begin == nullptr) { //"BIN"
+                binaryChunk.begin = cursor;
+                binaryChunk.size = chunkHeader[0];
+            }
+            //chunks are padded to four bytes
+            cursor += std::min(static_cast<size_t>((chunkHeader[0] + 3) & ~3u), static_cast<size_t>(end - cursor));
+        }
+        if(!hasJson) {
+            throw std::runtime_error("RESOURCE LOADER ERROR: " + fileName + " does not contain JSON");
+        }
+    }
+
+    auto document = JsonValue::parse(jsonBegin, jsonEnd);
+    if(document["asset"]["version"].getString().compare(0, 2, "2.") != 0) {
+        throw std::runtime_error("RESOURCE LOADER ERROR: " + fileName + " is not a glTF 2.0 file");
+    }
+
+    //buffers are used straight from the mapped files
+    std::vector<std::unique_ptr<MappedFile>> bufferFiles;
+    std::vector<GltfBuffer> buffers;
+    auto &bufferList = document["buffers"];
+    for(size_t b=0; b<bufferList.size(); b++) {
+        auto &uri = bufferList[b]["uri"];
+        GltfBuffer buffer;
+        if(uri.isNull()) {
+            //only the first buffer of a .glb file has no uri, it refers to the binary chunk
+            if(b != 0 || binaryChunk.begin == nullptr) {
+                throw std::runtime_error("RESOURCE LOADER ERROR: Buffer " + std::to_string(b) + " of " + fileName + " has no data");
+            }
+            buffer = binaryChunk;
+        } else {
+            if(uri.getString().compare(0, 5, "data:") == 0) {
+                throw std::runtime_error("RESOURCE LOADER ERROR: Buffers embedded as data uri are not supported in " + fileName);
+            }
+            bufferFiles.emplace_back(std::make_unique<MappedFile>("../resources/models/" + directory + decodeGltfUri(uri.getString())));
+            buffer.begin = bufferFiles.back()->begin();
+            buffer.size = bufferFiles.back()->getSize();
+        }
+        if(bufferList[b]["byteLength"].getIndex(0) > buffer.size) {
+            throw std::runtime_error("RESOURCE LOADER ERROR: Buffer " + std::to_string(b) + " of " + fileName + " is too short");
+        }
+        buffers.emplace_back(buffer);
+    }
+
+    //textures are referenced by the file names of their images
+    bool skippedImages = false;
+    auto findTextureFile = [&](const JsonValue &textureInfo) {
+        auto &texture = document["textures"][textureInfo["index"].getIndex(missingGltfIndex)];
+        auto &image = document["images"][texture["source"].getIndex(missingGltfIndex)];
+        if(image.isNull()) {
+            return std::string();
+        }
+        if(!image.has("uri") || image["uri"].getString().compare(0, 5, "data:") == 0) {
+            skippedImages = true;
+            return std::string();
+        }
+        auto path = decodeGltfUri(image["uri"].getString());
+        return path.substr(path.find_last_of("/\\") + 1);
+    };
+
+    std::vector<std::shared_ptr<Material>> materials;
+    auto &materialList = document["materials"];
+    for(size_t m=0; m<materialList.size(); m++) {
+        auto &pbr = materialList[m]["pbrMetallicRoughness"];
+        auto &color = pbr["baseColorFactor"];
+        materials.emplace_back(std::make_shared<Material>());
+        materials.back()->setName(materialList[m]["name"].getString());
+        materials.back()->setColor(
+            static_cast<float>(color[0].getNumber(1.0)),
+            static_cast<float>(color[1].getNumber(1.0)),
+            static_cast<float>(color[2].getNumber(1.0))
+        );
+        materials.back()->setRoughness(static_cast<float>(pbr["roughnessFactor"].getNumber(1.0)));
+        materials.back()->setMetallic(static_cast<float>(pbr["metallicFactor"].getNumber(1.0)));
+        auto diffuseTexture = findTextureFile(pbr["baseColorTexture"]);
+        if(!diffuseTexture.empty()) {
+            materials.back()->setDiffuseTexture(diffuseTexture);
+        }
+        auto normalTexture = findTextureFile(materialList[m]["normalTexture"]);
+        if(!normalTexture.empty()) {
+            materials.back()->setNormalTexture(normalTexture);
+        }
+    }
+    if(skippedImages) {
+        std::cout << "   RESOURCE LOADER: Images embedded in " << fileName << " are not supported and were skipped" << std::endl;
+    }
+
+    //every primitive becomes a mesh, primitives without material share a default one
+    std::vector<const JsonValue*> primitives;
+    std::vector<std::shared_ptr<Material>> primitiveMaterials;
+    std::vector<uint32_t> firstPrimitives;
+    std::shared_ptr<Material> defaultMaterial = nullptr;
+    auto &meshList = document["meshes"];
+    for(size_t m=0; m<meshList.size(); m++) {
+        firstPrimitives.emplace_back(static_cast<uint32_t>(primitives.size()));
+        auto &primitiveList = meshList[m]["primitives"];
+        for(size_t p=0; p<primitiveList.size(); p++) {
+            auto &primitive = primitiveList[p];
+            //4 is a triangle list, points, lines and strips are not supported by the renderers
+            if(primitive["mode"].getIndex(4) == 4) {
+                primitives.emplace_back(&primitive);
+            } else {
+                std::cout << "   RESOURCE LOADER: Skipped primitive of mesh " << m << " in " << fileName << " which is not a triangle list" << std::endl;
+                primitives.emplace_back(nullptr);
+            }
+
+            auto materialIndex = primitive["material"].getIndex(missingGltfIndex);
+            if(materialIndex < materials.size()) {
+                primitiveMaterials.emplace_back(materials[materialIndex]);
+            } else {
+                if(defaultMaterial == nullptr) {
+                    defaultMaterial = std::make_shared<Material>();
+                }
+                primitiveMaterials.emplace_back(defaultMaterial);
+            }
+        }
+    }
+    firstPrimitives.emplace_back(static_cast<uint32_t>(primitives.size()));
+
+    std::vector<std::shared_ptr<Mesh>> meshes(primitives.size());
+    std::atomic<uint32_t> nextPrimitive(0);
+    runParallel(std::min(numThreads, static_cast<uint32_t>(primitives.size())), [&](uint32_t) {
+        for(uint32_t p = nextPrimitive++; p < primitives.size(); p = nextPrimitive++) {
+            if(primitives[p] == nullptr) {
+                continue;
+            }
+            auto mesh = std::make_shared<Mesh>();
+            bool hasTangents = buildGltfMesh(document, buffers, *primitives[p], mesh);
+
+            if(!hasTangents && primitiveMaterials[p]->hasNormalTexture()) {
+                //threads not needed for other meshes help with the tangents
+                mesh->calculateTangents(std::max(1u, numThreads / static_cast<uint32_t>(primitives.size())));
+            }
+            mesh->computeBounds();
+            if(optimizeMeshes) {
+                mesh->generateLods();
+                mesh->optimize();
+                mesh->generateMeshlets();
+            }
+            meshes[p] = mesh;
         }
+    });
 
-        if(materials[matIndex]->hasNormalTexture()) {
-            meshes[m]->calculateTangents();
+    //the nodes of the default scene are the roots, without scenes every node that is not a child is one
+    auto &nodeList = document["nodes"];
+    std::vector<uint32_t> rootNodes;
+    if(document["scenes"].size() > 0) {
+        auto &sceneNodes = document["scenes"][document["scene"].getIndex(0)]["nodes"];
+        for(size_t n=0; n<sceneNodes.size(); n++) {
+            rootNodes.emplace_back(sceneNodes[n].getIndex(missingGltfIndex));
+        }
+    } else {
+        std::vector<bool> isChild(nodeList.size(), false);
+        for(size_t n=0; n<nodeList.size(); n++) {
+            auto &children = nodeList[n]["children"];
+            for(size_t c=0; c<children.size(); c++) {
+                auto childIndex = children[c].getIndex(missingGltfIndex);
+                if(childIndex < isChild.size()) {
+                    isChild[childIndex] = true;
+                }
+            }
+        }
+        for(size_t n=0; n<nodeList.size(); n++) {
+            if(!isChild[n]) {
+                rootNodes.emplace_back(static_cast<uint32_t>(n));
+            }
         }
-        
-        auto sceneNode = std::make_unique<SceneNode>(meshes[m], materials[matIndex]);
+    }
+
+    std::vector<bool> visited(nodeList.size(), false);
+    for(auto nodeIndex : rootNodes) {
+        auto sceneNode = buildGltfNode(document, nodeIndex, meshes, firstPrimitives, primitiveMaterials, visited);
         parent->addChild(sceneNode);
     }
 }
 
-glm::vec2 ResourceLoader::textToVec2(std::string text) {
-    size_t startPos = 0;
-    size_t endPos = text.find(' ', startPos);
-    float x = std::stof(text.substr(startPos, endPos-startPos));
-    startPos = endPos+1;
-    float y = std::stof(text.substr(startPos, text.length()-startPos));
+GltfAccessor ResourceLoader::getGltfAccessor(const JsonValue &document, const std::vector<GltfBuffer> &buffers, uint32_t index) {
+    auto &accessor = document["accessors"][index];
+    auto &bufferView = document["bufferViews"][accessor["bufferView"].getIndex(missingGltfIndex)];
+    auto bufferIndex = bufferView["buffer"].getIndex(missingGltfIndex);
+    if(accessor.isNull() || bufferView.isNull() || accessor.has("sparse") || bufferIndex >= buffers.size()) {
+        throw std::runtime_error("RESOURCE LOADER ERROR: glTF accessor " + std::to_string(index) + " is missing or not supported");
+    }
+
+    GltfAccessor result;
+    result.count = accessor["count"].getIndex(0);
+    result.componentType = accessor["componentType"].getIndex(0);
+    result.normalized = accessor["normalized"].getBool(false);
+    uint32_t componentSize = 0;
+    switch(result.componentType) {
+        case gltfByte:
+        case gltfUnsignedByte:
+            componentSize = 1;
+            break;
+        case gltfShort:
+        case gltfUnsignedShort:
+            componentSize = 2;
+            break;
+        case gltfUnsignedInt:
+        case gltfFloat:
+            componentSize = 4;
+            break;
+    }
+    const char *types[4] = {"SCALAR", "VEC2", "VEC3", "VEC4"};
+    for(uint32_t t=0; t<4; t++) {
+        if(accessor["type"].getString() == types[t]) {
+            result.numComponents = t + 1;
+        }
+    }
+    if(componentSize == 0 || result.numComponents == 0) {
+        throw std::runtime_error("RESOURCE LOADER ERROR: glTF accessor " + std::to_string(index) + " has an unsupported type");
+    }
+
+    //tightly packed elements do not specify a stride
+    uint32_t elementSize = componentSize * result.numComponents;
+    result.stride = bufferView["byteStride"].getIndex(elementSize);
+    uint64_t viewOffset = bufferView["byteOffset"].getIndex(0);
+    uint64_t viewLength = bufferView["byteLength"].getIndex(0);
+    uint64_t offset = accessor["byteOffset"].getIndex(0);
+    if(viewOffset + viewLength > buffers[bufferIndex].size
+        || (result.count > 0 && offset + (result.count - 1) * static_cast<uint64_t>(result.stride) + elementSize > viewLength)) {
+        throw std::runtime_error("RESOURCE LOADER ERROR: glTF accessor " + std::to_string(index) + " reaches outside of its buffer");
+    }
+    result.data = buffers[bufferIndex].begin + viewOffset + offset;
+    return result;
+}
+
+glm::vec4 ResourceLoader::readGltfElement(const GltfAccessor &accessor, uint32_t element) {
+    glm::vec4 result(0.0f);
+    const char *data = accessor.data + static_cast<size_t>(element) * accessor.stride;
+    for(uint32_t c=0; c<accessor.numComponents; c++) {
+        switch(accessor.componentType) {
+            case gltfByte: {
+                int8_t value;
+                std::memcpy(&value, data + c, sizeof(value));
+                result[c] = accessor.normalized ? std::max(value / 127.0f, -1.0f) : value;
+                break;
+            }
+            case gltfUnsignedByte: {
+                uint8_t value;
+                std::memcpy(&value, data + c, sizeof(value));
+                result[c] = accessor.normalized ? value / 255.0f : value;
+                break;
+            }
+            case gltfShort: {
+                int16_t value;
+                std::memcpy(&value, data + 2 * c, sizeof(value));
+                result[c] = accessor.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+                break;
+            }
+            case gltfUnsignedShort: {
+                uint16_t value;
+                std::memcpy(&value, data + 2 * c, sizeof(value));
+                result[c] = accessor.normalized ? value / 65535.0f : value;
+                break;
+            }
+            case gltfUnsignedInt: {
+                uint32_t value;
+                std::memcpy(&value, data + 4 * c, sizeof(value));
+                result[c] = static_cast<float>(value);
+                break;
+            }
+            default: {
+                std::memcpy(&result[c], data + 4 * c, sizeof(float));
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+bool ResourceLoader::buildGltfMesh(const JsonValue &document, const std::vector<GltfBuffer> &buffers, const JsonValue &primitive, std::shared_ptr<Mesh> &mesh) {
+    auto &attributes = primitive["attributes"];
+    auto positions = getGltfAccessor(document, buffers, attributes["POSITION"].getIndex(missingGltfIndex));
+    if(positions.componentType != gltfFloat || positions.numComponents != 3) {
+        throw std::runtime_error("RESOURCE LOADER ERROR: glTF positions have to be float vectors with three components");
+    }
+    auto checkAttribute = [&](const GltfAccessor &accessor, uint32_t numComponents, bool floatOnly) {
+        if(accessor.count != positions.count || accessor.numComponents != numComponents || (floatOnly && accessor.componentType != gltfFloat)) {
+            throw std::runtime_error("RESOURCE LOADER ERROR: glTF vertex attribute does not match the positions");
+        }
+    };
+
+    //float attributes are copied straight from the mapped buffers into the vertices
+    auto &vertices = mesh->getVertices();
+    vertices.resize(positions.count);
+    for(uint32_t v=0; v<positions.count; v++) {
+        std::memcpy(&vertices[v].position, positions.data + static_cast<size_t>(v) * positions.stride, 3 * sizeof(float));
+        vertices[v].position.w = 1.0f;
+    }
+
+    bool hasNormals = attributes.has("NORMAL");
+    if(hasNormals) {
+        auto normals = getGltfAccessor(document, buffers, attributes["NORMAL"].getIndex(missingGltfIndex));
+        checkAttribute(normals, 3, true);
+        for(uint32_t v=0; v<normals.count; v++) {
+            std::memcpy(&vertices[v].normal, normals.data + static_cast<size_t>(v) * normals.stride, 3 * sizeof(float));
+        }
+    }
+
+    //glTF places the origin of texture coordinates at the top left
+    if(attributes.has("TEXCOORD_0")) {
+        auto texCoords = getGltfAccessor(document, buffers, attributes["TEXCOORD_0"].getIndex(missingGltfIndex));
+        checkAttribute(texCoords, 2, false);
+        for(uint32_t v=0; v<texCoords.count; v++) {
+            auto texCoord = readGltfElement(texCoords, v);
+            vertices[v].texCoord = glm::vec2(texCoord.x, 1.0f - texCoord.y);
+        }
+    } else {
+        for(auto &vertex : vertices) {
+            vertex.texCoord = glm::vec2(0.0f);
+        }
+    }
+
+    //tangents are only valid together with the normals they were computed for
+    bool hasTangents = hasNormals && attributes.has("TANGENT");
+    if(hasTangents) {
+        auto tangents = getGltfAccessor(document, buffers, attributes["TANGENT"].getIndex(missingGltfIndex));
+        checkAttribute(tangents, 4, true);
+        for(uint32_t v=0; v<tangents.count; v++) {
+            std::memcpy(&vertices[v].tangent, tangents.data + static_cast<size_t>(v) * tangents.stride, 4 * sizeof(float));
+            //flipping the texture coordinates mirrors the bitangent
+            vertices[v].tangent.w = -vertices[v].tangent.w;
+        }
+    } else {
+        for(auto &vertex : vertices) {
+            vertex.tangent = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+
+    auto &indices = mesh->getIndices();
+    if(primitive.has("indices")) {
+        auto indexAccessor = getGltfAccessor(document, buffers, primitive["indices"].getIndex(missingGltfIndex));
+        if(indexAccessor.numComponents != 1 || (indexAccessor.componentType != gltfUnsignedByte
+            && indexAccessor.componentType != gltfUnsignedShort && indexAccessor.componentType != gltfUnsignedInt)) {
+            throw std::runtime_error("RESOURCE LOADER ERROR: glTF indices have to be unsigned integers");
+        }
+        indices.resize(indexAccessor.count);
+        for(uint32_t i=0; i<indexAccessor.count; i++) {
+            const char *element = indexAccessor.data + static_cast<size_t>(i) * indexAccessor.stride;
+            if(indexAccessor.componentType == gltfUnsignedByte) {
+                indices[i] = static_cast<uint8_t>(*element);
+            } else if(indexAccessor.componentType == gltfUnsignedShort) {
+                uint16_t index;
+                std::memcpy(&index, element, sizeof(index));
+                indices[i] = index;
+            } else {
+                std::memcpy(&indices[i], element, sizeof(uint32_t));
+            }
+            if(indices[i] >= positions.count) {
+                throw std::runtime_error("RESOURCE LOADER ERROR: glTF index out of range");
+            }
+        }
+    } else {
+        indices.resize(positions.count);
+        for(uint32_t i=0; i<positions.count; i++) {
+            indices[i] = i;
+        }
+    }
+    indices.resize(indices.size() / 3 * 3);
+
+    if(!hasNormals) {
+        for(auto &vertex : vertices) {
+            vertex.normal = glm::vec3(0.0f);
+        }
+        for(size_t i=0; i<indices.size(); i+=3) {
+            auto p0 = glm::vec3(vertices[indices[i]].position);
+            auto faceNormal = glm::cross(glm::vec3(vertices[indices[i + 1]].position) - p0, glm::vec3(vertices[indices[i + 2]].position) - p0);
+            for(int corner=0; corner<3; corner++) {
+                vertices[indices[i + corner]].normal += faceNormal;
+            }
+        }
+        for(auto &vertex : vertices) {
+            float length = glm::length(vertex.normal);
+            vertex.normal = length > 0.0f ? vertex.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    return hasTangents;
+}
+
+std::unique_ptr<SceneNode> ResourceLoader::buildGltfNode(const JsonValue &document, uint32_t nodeIndex, std::vector<std::shared_ptr<Mesh>> &meshes,
+    const std::vector<uint32_t> &firstPrimitives, std::vector<std::shared_ptr<Material>> &primitiveMaterials, std::vector<bool> &visited) {
+    if(nodeIndex >= visited.size() || visited[nodeIndex]) {
+        throw std::runtime_error("RESOURCE LOADER ERROR: glTF node " + std::to_string(nodeIndex) + " is missing or appears twice in the hierarchy");
+    }
+    visited[nodeIndex] = true;
+    auto &node = document["nodes"][nodeIndex];
+    auto sceneNode = std::make_unique<SceneNode>();
+
+    auto &matrix = node["matrix"];
+    if(matrix.size() == 16) {
+        //the matrix is split into translation, rotation and scale, shearing cannot be represented by a scene node
+        glm::mat4 transform;
+        for(int i=0; i<16; i++) {
+            transform[i / 4][i % 4] = static_cast<float>(matrix[i].getNumber());
+        }
+        auto scale = glm::vec3(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])));
+        if(glm::determinant(glm::mat3(transform)) < 0.0f) {
+            scale.x = -scale.x;
+        }
+        glm::mat3 rotation(1.0f);
+        for(int axis=0; axis<3; axis++) {
+            if(scale[axis] != 0.0f) {
+                rotation[axis] = glm::vec3(transform[axis]) / scale[axis];
+            }
+        }
+        sceneNode->setPosition(glm::vec3(transform[3]));
+        sceneNode->setRotation(glm::normalize(glm::quat_cast(rotation)));
+        sceneNode->setScale(scale);
+    } else {
+        auto &translation = node["translation"];
+        auto &rotation = node["rotation"];
+        auto &scale = node["scale"];
+        sceneNode->setPosition(glm::vec3(translation[0].getNumber(0.0), translation[1].getNumber(0.0), translation[2].getNumber(0.0)));
+        //glTF stores quaternions as (x, y, z, w)
+        sceneNode->setRotation(glm::quat(
+            static_cast<float>(rotation[3].getNumber(1.0)),
+            static_cast<float>(rotation[0].getNumber(0.0)),
+            static_cast<float>(rotation[1].getNumber(0.0)),
+            static_cast<float>(rotation[2].getNumber(0.0))
+        ));
+        sceneNode->setScale(glm::vec3(scale[0].getNumber(1.0), scale[1].getNumber(1.0), scale[2].getNumber(1.0)));
+    }
+
+    //a single primitive is attached to the node itself, multiple primitives become child nodes
+    auto meshIndex = node["mesh"].getIndex(missingGltfIndex);
+    if(meshIndex < firstPrimitives.size() - 1) {
+        std::vector<uint32_t> loadedPrimitives;
+        for(uint32_t p=firstPrimitives[meshIndex]; p<firstPrimitives[meshIndex + 1]; p++) {
+            if(meshes[p] != nullptr) {
+                loadedPrimitives.emplace_back(p);
+            }
+        }
+        if(loadedPrimitives.size() == 1) {
+            sceneNode->addMesh(meshes[loadedPrimitives[0]], primitiveMaterials[loadedPrimitives[0]]);
+        } else {
+            for(auto p : loadedPrimitives) {
+                auto primitiveNode = std::make_unique<SceneNode>(meshes[p], primitiveMaterials[p]);
+                sceneNode->addChild(primitiveNode);
+            }
+        }
+    }
+
+    auto &children = node["children"];
+    for(size_t c=0; c<children.size(); c++) {
+        auto childNode = buildGltfNode(document, children[c].getIndex(missingGltfIndex), meshes, firstPrimitives, primitiveMaterials, visited);
+        sceneNode->addChild(childNode);
+    }
+    return sceneNode;
+}
+
+std::string ResourceLoader::decodeGltfUri(const std::string &uri) {
+    std::string decoded;
+    for(size_t c=0; c<uri.size(); c++) {
+        if(uri[c] == '%' && c + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[c + 1])) && std::isxdigit(static_cast<unsigned char>(uri[c + 2]))) {
+            decoded += static_cast<char>(std::stoi(uri.substr(c + 1, 2), nullptr, 16));
+            c += 2;
+        } else {
+            decoded += uri[c];
+        }
+    }
+    return decoded;
+}
+
+void ResourceLoader::loadNodeTexturesAsync(std::unique_ptr<SceneNode> &sceneNode) {
+    if(sceneNode->hasMesh()) {
+        loadMaterialTexturesAsync(sceneNode->getMaterial());
+    }
+    for(auto &child : sceneNode->getChildren()) {
+        loadNodeTexturesAsync(child);
+    }
+}
+
+void ResourceLoader::parseObjChunk(const char *begin, const char *end, ObjChunk &chunk) {
+    //rough guess to avoid most reallocations, a vertex line takes about 30 characters
+    auto estimatedSize = static_cast<size_t>(end - begin) / 96;
+    chunk.positions.reserve(estimatedSize);
+    chunk.normals.reserve(estimatedSize);
+    chunk.texCoords.reserve(estimatedSize);
+
+    const char *nextLine = begin;
+    const char *tokenStart;
+    while(nextLine < end) {
+        const char *cursor = nextLine;
+        const char *lineEnd = findLineEnd(cursor, end, nextLine);
+        const char *tokenEnd = readToken(cursor, lineEnd, tokenStart);
+        if(tokenEnd == tokenStart) {
+            continue;
+        }
+
+        if(tokenEquals(tokenStart, tokenEnd, "v")) {
+            chunk.positions.emplace_back(textToVec3(cursor, lineEnd));
+
+        } else if(tokenEquals(tokenStart, tokenEnd, "vn")) {
+            chunk.normals.emplace_back(textToVec3(cursor, lineEnd));
+
+        } else if(tokenEquals(tokenStart, tokenEnd, "vt")) {
+            chunk.texCoords.emplace_back(textToVec2(cursor, lineEnd));
+
+        } else if(tokenEquals(tokenStart, tokenEnd, "f")) {
+            auto faceStart = chunk.faceVertices.size();
+            auto relativeStart = chunk.relativeIndices.size();
+            while(true) {
+                skipSpaces(cursor, lineEnd);
+                if(cursor >= lineEnd) {
+                    break;
+                }
+
+                //v, v/vt, v//vn or v/vt/vn
+                glm::ivec3 vertexIndices(missingObjIndex);
+                int64_t counts[3] = {
+                    static_cast<int64_t>(chunk.positions.size()),
+                    static_cast<int64_t>(chunk.texCoords.size()),
+                    static_cast<int64_t>(chunk.normals.size())
+                };
+                for(int a=0; a<3; a++) {
+                    if(a > 0) {
+                        if(cursor >= lineEnd || *cursor != '/') {
+                            break;
+                        }
+                        cursor++;
+                        if(cursor < lineEnd && *cursor == '/') {
+                            continue;
+                        }
+                    }
+                    //negative indices count back from the last attribute, which is only known relative to the chunk start
+                    int64_t index = parseInteger(cursor, lineEnd);
+                    if(index < 0) {
+                        index += counts[a];
+                        chunk.relativeIndices.emplace_back(3 * chunk.faceVertices.size() + a);
+                    } else {
+                        index--;
+                    }
+                    index = std::max(index, static_cast<int64_t>(missingObjIndex) + 1);
+                    vertexIndices[a] = static_cast<int32_t>(std::min(index, static_cast<int64_t>(std::numeric_limits<int32_t>::max())));
+                }
+                chunk.faceVertices.emplace_back(vertexIndices);
+
+                //ignore anything else attached to the vertex
+                while(cursor < lineEnd && *cursor != ' ' && *cursor != '\t') {
+                    cursor++;
+                }
+            }
+            if(chunk.faceVertices.size() - faceStart < 3) {
+                chunk.faceVertices.resize(faceStart);
+                chunk.relativeIndices.resize(relativeStart);
+            } else {
+                chunk.faceStarts.emplace_back(static_cast<uint32_t>(faceStart));
+            }
+
+        } else if(tokenEquals(tokenStart, tokenEnd, "o") || tokenEquals(tokenStart, tokenEnd, "g")) {
+            chunk.statements.emplace_back();
+            chunk.statements.back().faceIndex = static_cast<uint32_t>(chunk.faceStarts.size());
+            chunk.statements.back().startsObject = true;
+
+        } else if(tokenEquals(tokenStart, tokenEnd, "usemtl")) {
+            skipSpaces(cursor, lineEnd);
+            chunk.statements.emplace_back();
+            chunk.statements.back().faceIndex = static_cast<uint32_t>(chunk.faceStarts.size());
+            chunk.statements.back().materialName.assign(cursor, lineEnd);
+        }
+    }
+}
+
+void ResourceLoader::buildObjMesh(const std::vector<ObjChunk> &chunks, const ObjMeshRange &meshRange,
+    const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &normals, const std::vector<glm::vec2> &texCoords, std::shared_ptr<Mesh> &mesh) {
+    //unique index triplets of the mesh
+    VertexWeldTable weldTable;
+    std::vector<uint32_t> faceIndices;
+
+    for(auto &segment : meshRange.segments) {
+        auto &chunk = chunks[segment.x];
+        for(uint32_t f=segment.y; f<segment.z; f++) {
+            auto faceStart = chunk.faceVertices.begin() + chunk.faceStarts[f];
+            auto faceEnd = f + 1 < chunk.faceStarts.size() ? chunk.faceVertices.begin() + chunk.faceStarts[f + 1] : chunk.faceVertices.end();
+
+            for(auto vertexIndices = faceStart; vertexIndices != faceEnd; vertexIndices++) {
+                if(vertexIndices->x < 0 || vertexIndices->x >= static_cast<int32_t>(positions.size())
+                    || (vertexIndices->y != missingObjIndex && (vertexIndices->y < 0 || vertexIndices->y >= static_cast<int32_t>(texCoords.size())))
+                    || (vertexIndices->z != missingObjIndex && (vertexIndices->z < 0 || vertexIndices->z >= static_cast<int32_t>(normals.size())))) {
+                    throw std::runtime_error("RESOURCE LOADER ERROR: Invalid vertex index in .obj file");
+                }
+            }
+
+            glm::vec3 faceNormal(0.0f, 0.0f, 1.0f);
+            if(faceStart->z == missingObjIndex) {
+                auto cross = glm::cross(
+                    positions[faceStart[1].x] - positions[faceStart[0].x],
+                    positions[faceStart[2].x] - positions[faceStart[0].x]
+                );
+                if(glm::dot(cross, cross) > 0.0f) {
+                    faceNormal = cross;
+                }
+            }
+
+            faceIndices.clear();
+            for(auto vertexIndices = faceStart; vertexIndices != faceEnd; vertexIndices++) {
+                //vertices with a face normal are unique to their face
+                bool isNew = true;
+                uint32_t index = mesh->getNumVertices();
+                if(vertexIndices->z != missingObjIndex) {
+                    index = weldVertex(weldTable, *vertexIndices, index, isNew);
+                }
+                if(isNew) {
+                    mesh->addVertex(
+                        positions[vertexIndices->x],
+                        vertexIndices->z == missingObjIndex ? faceNormal : normals[vertexIndices->z],
+                        vertexIndices->y == missingObjIndex ? glm::vec2(0.0f) : texCoords[vertexIndices->y],
+                        glm::vec3(0.0f)
+                    );
+                }
+                faceIndices.emplace_back(index);
+            }
+
+            //triangle fan, quads result in triangles (0,1,2) and (0,2,3)
+            for(size_t i=1; i+1<faceIndices.size(); i++) {
+                mesh->addIndex(faceIndices[0]);
+                mesh->addIndex(faceIndices[i]);
+                mesh->addIndex(faceIndices[i + 1]);
+            }
+        }
+    }
+}
+
+void ResourceLoader::runParallel(uint32_t numThreads, const std::function<void(uint32_t)> &task) {
+    if(numThreads <= 1) {
+        task(0);
+        return;
+    }
+
+    //errors are passed on to the calling thread
+    std::vector<std::exception_ptr> errors(numThreads);
+    std::vector<std::thread> threads;
+    for(uint32_t t=0; t<numThreads; t++) {
+        threads.emplace_back([&task, &errors, t]() {
+            try {
+                task(t);
+            } catch(...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    for(auto &thread : threads) {
+        thread.join();
+    }
+    for(auto &error : errors) {
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+void ResourceLoader::loadMaterials(const std::string &fileName, std::vector<std::shared_ptr<Material>> &materials) {
+    MappedFile mtlFile("../resources/models/" + fileName + ".mtl");
+
+    const char *nextLine = mtlFile.begin();
+    const char *tokenStart;
+    while(nextLine < mtlFile.end()) {
+        const char *cursor = nextLine;
+        const char *lineEnd = findLineEnd(cursor, mtlFile.end(), nextLine);
+        const char *tokenEnd = readToken(cursor, lineEnd, tokenStart);
+        if(tokenEnd == tokenStart) {
+            continue;
+        }
+
+        if(tokenEquals(tokenStart, tokenEnd, "newmtl")) {
+            skipSpaces(cursor, lineEnd);
+            materials.emplace_back(std::make_shared<Material>());
+            materials.back()->setName(std::string(cursor, lineEnd));
+            continue;
+        }
+        if(materials.empty()) {
+            continue;
+        }
+
+        if(tokenEquals(tokenStart, tokenEnd, "Kd")) {
+            materials.back()->setColor(textToVec3(cursor, lineEnd));
+
+        } else if(tokenEquals(tokenStart, tokenEnd, "Ks")) {
+            auto specular = textToVec3(cursor, lineEnd);
+            materials.back()->setSpecular((specular.x + specular.y + specular.z) / 3.0f);
+
+        } else if(tokenEquals(tokenStart, tokenEnd, "Ns")) {
+            materials.back()->setRoughness(1.0f - 0.001f * parseFloat(cursor, lineEnd));
+
+        } else if(tokenEquals(tokenStart, tokenEnd, "map_Kd")) {
+            materials.back()->setDiffuseTexture(textToFileName(cursor, lineEnd));
+
+        } else if(tokenEquals(tokenStart, tokenEnd, "map_Ns")) {
+            materials.back()->setRoughnessTexture(textToFileName(cursor, lineEnd));
+
+        } else if(tokenEquals(tokenStart, tokenEnd, "map_Bump") || tokenEquals(tokenStart, tokenEnd, "map_bump") || tokenEquals(tokenStart, tokenEnd, "bump")) {
+            materials.back()->setNormalTexture(textToFileName(cursor, lineEnd));
+        }
+    }
+}
+
+uint32_t ResourceLoader::weldVertex(VertexWeldTable &table, glm::ivec3 key, uint32_t newIndex, bool &isNew) {
+    //keep the load factor below one half
+    if(2 * (table.numEntries + 1) > table.keys.size()) {
+        std::vector<glm::ivec3> oldKeys(std::max(static_cast<size_t>(1024), 2 * table.keys.size()), glm::ivec3(-1));
+        std::vector<uint32_t> oldIndices(oldKeys.size());
+        oldKeys.swap(table.keys);
+        oldIndices.swap(table.vertexIndices);
+        table.numEntries = 0;
+        bool reinserted;
+        for(size_t i=0; i<oldKeys.size(); i++) {
+            if(oldKeys[i].x >= 0) {
+                weldVertex(table, oldKeys[i], oldIndices[i], reinserted);
+            }
+        }
+    }
+
+    uint64_t hash = static_cast<uint32_t>(key.x) * 0x9E3779B97F4A7C15ull;
+    hash ^= static_cast<uint32_t>(key.y) * 0xC2B2AE3D27D4EB4Full;
+    hash ^= static_cast<uint32_t>(key.z) * 0x165667B19E3779F9ull;
+    hash ^= hash >> 29;
+
+    //linear probing, the table size is a power of two
+    size_t mask = table.keys.size() - 1;
+    size_t slot = static_cast<size_t>(hash) & mask;
+    while(table.keys[slot].x >= 0) {
+        if(table.keys[slot] == key) {
+            isNew = false;
+            return table.vertexIndices[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    table.keys[slot] = key;
+    table.vertexIndices[slot] = newIndex;
+    table.numEntries++;
+    isNew = true;
+    return newIndex;
+}
+
+const char *ResourceLoader::findLineEnd(const char *cursor, const char *end, const char *&nextLine) {
+    auto lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+    if(lineEnd == nullptr) {
+        lineEnd = end;
+        nextLine = end;
+    } else {
+        nextLine = lineEnd + 1;
+    }
+    if(lineEnd > cursor && lineEnd[-1] == '\r') {
+        lineEnd--;
+    }
+    return lineEnd;
+}
+
+void ResourceLoader::skipSpaces(const char *&cursor, const char *lineEnd) {
+    while(cursor < lineEnd && (*cursor == ' ' || *cursor == '\t')) {
+        cursor++;
+    }
+}
+
+const char *ResourceLoader::readToken(const char *&cursor, const char *lineEnd, const char *&tokenStart) {
+    skipSpaces(cursor, lineEnd);
+    tokenStart = cursor;
+    while(cursor < lineEnd && *cursor != ' ' && *cursor != '\t') {
+        cursor++;
+    }
+    return cursor;
+}
+
+bool ResourceLoader::tokenEquals(const char *tokenStart, const char *tokenEnd, const char *keyword) {
+    while(tokenStart < tokenEnd && *keyword != '\0') {
+        if(*tokenStart != *keyword) {
+            return false;
+        }
+        tokenStart++;
+        keyword++;
+    }
+    return tokenStart == tokenEnd && *keyword == '\0';
+}
+
+float ResourceLoader::parseFloat(const char *&cursor, const char *lineEnd) {
+    //exactly representable powers of ten
+    static const double powersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    skipSpaces(cursor, lineEnd);
+
+    bool negative = false;
+    if(cursor < lineEnd && (*cursor == '-' || *cursor == '+')) {
+        negative = *cursor == '-';
+        cursor++;
+    }
+
+    //up to 19 significant digits fit into the mantissa, the rest only shifts the exponent
+    uint64_t mantissa = 0;
+    int64_t exponent = 0;
+    while(cursor < lineEnd && *cursor >= '0' && *cursor <= '9') {
+        if(mantissa < 1000000000000000000ull) {
+            mantissa = 10 * mantissa + static_cast<uint64_t>(*cursor - '0');
+        } else {
+            exponent++;
+        }
+        cursor++;
+    }
+    if(cursor < lineEnd && *cursor == '.') {
+        cursor++;
+        while(cursor < lineEnd && *cursor >= '0' && *cursor <= '9') {
+            if(mantissa < 1000000000000000000ull) {
+                mantissa = 10 * mantissa + static_cast<uint64_t>(*cursor - '0');
+                exponent--;
+            }
+            cursor++;
+        }
+    }
+    if(cursor < lineEnd && (*cursor == 'e' || *cursor == 'E')) {
+        cursor++;
+        exponent += parseInteger(cursor, lineEnd);
+    }
+
+    //anything beyond this range overflows to infinity or underflows to zero anyway
+    exponent = std::max(std::min(exponent, static_cast<int64_t>(400)), static_cast<int64_t>(-400));
+
+    auto value = static_cast<double>(mantissa);
+    if(mantissa != 0) {
+        while(exponent > 22) {
+            value *= powersOfTen[22];
+            exponent -= 22;
+        }
+        while(exponent < -22) {
+            value /= powersOfTen[22];
+            exponent += 22;
+        }
+        value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+    }
+
+    return static_cast<float>(negative ? -value : value);
+}
+
+int64_t ResourceLoader::parseInteger(const char *&cursor, const char *lineEnd) {
+    skipSpaces(cursor, lineEnd);
+
+    bool negative = false;
+    if(cursor < lineEnd && (*cursor == '-' || *cursor == '+')) {
+        negative = *cursor == '-';
+        cursor++;
+    }
+
+    //the value saturates instead of overflowing, no valid index or exponent comes close
+    int64_t value = 0;
+    while(cursor < lineEnd && *cursor >= '0' && *cursor <= '9') {
+        if(value < 100000000000000000ll) {
+            value = 10 * value + (*cursor - '0');
+        }
+        cursor++;
+    }
+
+    return negative ? -value : value;
+}
+
+std::string ResourceLoader::textToFileName(const char *cursor, const char *lineEnd) {
+    while(lineEnd > cursor && (lineEnd[-1] == ' ' || lineEnd[-1] == '\t')) {
+        lineEnd--;
+    }
+    //the file is the last token, options like "-bm 1.0" come before it
+    const char *fileStart = lineEnd;
+    while(fileStart > cursor && fileStart[-1] != ' ' && fileStart[-1] != '\t') {
+        fileStart--;
+    }
+    //only the file name is used, textures are expected in resources/textures
+    for(const char *c = fileStart; c < lineEnd; c++) {
+        if(*c == '/' || *c == '\\') {
+            fileStart = c + 1;
+        }
+    }
+    return std::string(fileStart, lineEnd);
+}
+
+glm::vec2 ResourceLoader::textToVec2(const char *&cursor, const char *lineEnd) {
+    float x = parseFloat(cursor, lineEnd);
+    float y = parseFloat(cursor, lineEnd);
     return glm::vec2(x, y);
 }
 
-glm::vec3 ResourceLoader::textToVec3(std::string text) {
-    size_t startPos = 0;
-    size_t endPos = text.find(' ', startPos);
-    float x = std::stof(text.substr(startPos, endPos-startPos));
-    startPos = endPos+1;
-    endPos = text.find(' ', startPos);
-    float y = std::stof(text.substr(startPos, endPos-startPos));
-    startPos = endPos+1;
-    float z = std::stof(text.substr(startPos, text.length()-startPos));
+glm::vec3 ResourceLoader::textToVec3(const char *&cursor, const char *lineEnd) {
+    float x = parseFloat(cursor, lineEnd);
+    float y = parseFloat(cursor, lineEnd);
+    float z = parseFloat(cursor, lineEnd);
     return glm::vec3(x, y, z);
-}
\ No newline at end of file
+}
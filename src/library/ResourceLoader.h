@@ -2,12 +2,156 @@
 #define SLBVULKAN_RESOURCELOADER_H
 
 #include <string>
+#include <atomic>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <functional>
+#include <future>
+#include <limits>
+#include <map>
+#include <mutex>
 
 #include "path_config.h"
+#include "Image.h"
+#include "JsonValue.h"
+#include "MappedFile.h"
 #include "SceneNode.h"
+#include "ThreadPool.h"
+
+/**
+ * Marks a face vertex without texture coordinates or normal in an .obj file.
+ */
+const int32_t missingObjIndex = std::numeric_limits<int32_t>::min();
+
+/**
+ * Statement in an .obj file that influences how faces are grouped into meshes.
+ */
+struct ObjStatement {
+    uint32_t faceIndex = 0; /**< Number of faces in the chunk preceding the statement */
+    bool startsObject = false; /**< True for "o" and "g", which always start a new mesh */
+    std::string materialName; /**< Material selected by "usemtl", a new mesh is started if it changes */
+};
+
+/**
+ * Data of a section of an .obj file that can be parsed independently of the rest.
+ */
+struct ObjChunk {
+    std::vector<glm::vec3> positions; /**< Positions in the order they appear in the chunk */
+    std::vector<glm::vec3> normals; /**< Normals in the order they appear in the chunk */
+    std::vector<glm::vec2> texCoords; /**< Texture coordinates in the order they appear in the chunk */
+    std::vector<glm::ivec3> faceVertices; /**< Indices of position, texture coordinates and normal per face vertex */
+    std::vector<uint32_t> faceStarts; /**< Index of the first face vertex per face */
+    std::vector<size_t> relativeIndices; /**< Face vertex components (3 * vertex + component) counted from the chunk start instead of the file start */
+    std::vector<ObjStatement> statements; /**< Object and material statements in the order they appear in the chunk */
+};
+
+/**
+ * Faces of an .obj file that are combined into one mesh.
+ */
+struct ObjMeshRange {
+    std::string materialName; /**< Name of the material assigned to all faces */
+    std::vector<glm::uvec3> segments; /**< Chunk index, first face and end face per consecutive range of faces */
+};
+
+/**
+ * Version of the binary model cache layout, caches with a different version are ignored.
+ */
+const uint32_t modelCacheVersion = 6;
+
+/**
+ * Header at the start of a binary model cache file.
+ * 
+ * The cache is only valid if the sizes of the source files match and either the modification times or the content hash match as well.
+ */
+struct ModelCacheHeader {
+    char magic[8]; /**< "SLBMESH" identifying the file type */
+    uint32_t version; /**< Version of the cache layout */
+    uint32_t vertexSize; /**< Size of the Vertex struct the cache was written with */
+    uint64_t objSize; /**< Size of the source .obj file */
+    uint64_t objModificationTime; /**< Time of the last modification of the source .obj file */
+    uint64_t mtlSize; /**< Size of the source .mtl file */
+    uint64_t mtlModificationTime; /**< Time of the last modification of the source .mtl file */
+    uint64_t contentHash; /**< Combined hash of the contents of both source files */
+    uint32_t numMaterials; /**< Number of material records following the header */
+    uint32_t numMeshes; /**< Number of mesh records following the material records */
+};
+
+/**
+ * Material record in a binary model cache file.
+ * 
+ * The record is followed by the characters of the material name and the diffuse, normal, roughness and metallic texture files.
+ */
+struct ModelCacheMaterial {
+    MaterialUniforms parameters; /**< Brdf parameters of the material */
+    uint32_t stringLengths[5]; /**< Number of characters of the name and the four texture files */
+};
+
+/**
+ * Mesh record in a binary model cache file.
+ */
+struct ModelCacheMesh {
+    uint32_t materialIndex; /**< Index of the material record assigned to the mesh */
+    uint32_t numVertices; /**< Number of vertices in the mesh */
+    uint32_t numIndices; /**< Number of indices in the mesh, including all levels of detail */
+    uint32_t numLods; /**< Number of valid entries in lods */
+    uint64_t vertexOffset; /**< Position of the first vertex in the file */
+    uint64_t indexOffset; /**< Position of the first index in the file */
+    uint64_t meshletOffset; /**< Position of the first meshlet in the file */
+    uint32_t numMeshlets; /**< Number of meshlets of the mesh */
+    uint32_t pad; /**< Padding to keep the following members aligned */
+    glm::vec4 boundingSphere; /**< Center and radius of a sphere enclosing the mesh */
+    BoundingBox boundingBox; /**< Axis aligned box enclosing the mesh */
+    MeshLod lods[maxMeshLods]; /**< Index ranges of the levels of detail */
+};
+
+/**
+ * Hash table mapping the (v, vt, vn) index triplets of an .obj file to the vertices of a mesh.
+ * 
+ * Uses open addressing with linear probing, slots with a negative position index are empty.
+ */
+struct VertexWeldTable {
+    std::vector<glm::ivec3> keys; /**< Index triplet per slot */
+    std::vector<uint32_t> vertexIndices; /**< Index of the mesh vertex created for the triplet per slot */
+    size_t numEntries = 0; /**< Number of occupied slots */
+};
+
+/**
+ * Marks a missing index in a glTF file, e.g. of a primitive without material.
+ */
+const uint32_t missingGltfIndex = std::numeric_limits<uint32_t>::max();
+
+/**
+ * Component types of glTF accessors, the values are the matching OpenGL enums.
+ */
+enum GltfComponentType {
+    gltfByte = 5120,
+    gltfUnsignedByte = 5121,
+    gltfShort = 5122,
+    gltfUnsignedShort = 5123,
+    gltfUnsignedInt = 5125,
+    gltfFloat = 5126
+};
+
+/**
+ * Range of binary data referenced by the buffers of a glTF file.
+ */
+struct GltfBuffer {
+    const char *begin = nullptr; /**< First byte of the buffer */
+    size_t size = 0; /**< Number of bytes in the buffer */
+};
+
+/**
+ * Typed view of the elements of a glTF accessor inside a buffer.
+ */
+struct GltfAccessor {
+    const char *data = nullptr; /**< First byte of the first element */
+    uint32_t count = 0; /**< Number of elements */
+    uint32_t stride = 0; /**< Distance between the starts of consecutive elements in bytes */
+    uint32_t componentType = 0; /**< Type of the components as OpenGL enum, e.g. 5126 for float */
+    uint32_t numComponents = 0; /**< Number of components per element, e.g. 3 for VEC3 */
+    bool normalized = false; /**< True if integer components are mapped to [0, 1] or [-1, 1] */
+};
 
 class ResourceLoader {
 public:
@@ -34,6 +178,16 @@ public:
      */
     static void findRequiredDescriptorSets(const std::string &fileName, std::vector<uint32_t> &requiredDescriptorSets);
 
+    /**
+     * Check whether a vertex shader reads vertex attributes other than the position.
+     * 
+     * Shaders including "VertexInput" read all attributes, shaders including "VertexPosition" only the position.
+     * 
+     * @param fileName name of a shader file in the resources/shaders/ folder
+     * @return true if the shader includes "VertexInput"
+     */
+    static bool readsVertexAttributes(const std::string &fileName);
+
     /**
      * Compile a shader from glsl to spir-v.
      * 
@@ -53,11 +207,113 @@ public:
      * 
      * Both an .obj and an -mtl file with the given name have to be located in the resources/models folder.
      * Each separate mesh in the file is stored in a new scene node added to parent.
+     * A new mesh is started for every object ("o"), group ("g") and change of material ("usemtl").
+     * Both files are memory-mapped and parsed in place without allocating memory per line.
+     * The .obj file is split into chunks at line breaks which are tokenized in parallel, then the meshes are assembled in parallel.
+     * The result does not depend on the number of threads.
+     * After parsing, the meshes and materials are written to a binary cache (.slbmesh) next to the model.
+     * Later calls map the cache instead of parsing the model again, as long as the source files are unchanged.
+     * Faces with more than three vertices are triangulated as a fan, missing normals are replaced by the face normal.
+     * Face vertices sharing the same position, texture coordinate and normal indices are welded into a single vertex.
+     * Simplified levels of detail are generated for each mesh (see Mesh::generateLods),
+     * then the triangles and vertices are reordered for rendering (see Mesh::optimize).
+     * 
+     * File names ending in .glb or .gltf are loaded as glTF 2.0 instead (see loadGltfModel), they do not use the cache.
      * 
      * @param fileName name of a pair of .obj and .mtl files in resources/models
      * @param parent scene node receiving the loaded geometry as children
+     * @param numThreads maximum number of threads used for parsing, 0 uses all hardware threads
+     * @param useCache false to neither read nor write the binary model cache
+     * @param optimizeMeshes false to keep the order of the file without levels of detail, the binary model cache is not used in that case
+     */
+    static void loadModel(const std::string &fileName, std::unique_ptr<SceneNode> &parent, uint32_t numThreads = 0, bool useCache = true, bool optimizeMeshes = true);
+
+    //loading in the background
+
+    /**
+     * Load a model on the resource loader's worker pool.
+     * 
+     * Works like loadModel but returns immediately.
+     * Once the model is loaded the textures of its materials are decoded in the background as well (see loadTextureAsync).
+     * The returned future resolves to a scene node containing the loaded meshes as children.
+     * Exceptions thrown while loading are rethrown by the future's get().
+     * 
+     * @param fileName name of a pair of .obj and .mtl files in resources/models
+     * @param numThreads maximum number of threads used for parsing including the pool worker, 0 is treated as 1 since the pool already occupies the hardware threads
+     * @return future resolving to the scene node of the loaded model
+     */
+    static std::future<std::unique_ptr<SceneNode>> loadModelAsync(const std::string &fileName, uint32_t numThreads = 1);
+
+    /**
+     * Decode all textures of a material on the resource loader's worker pool.
+     * 
+     * Each texture is block compressed according to its purpose (see getTextureEncoding):
+     * BC7 for diffuse colors, BC5 for normal maps and BC4 for roughness and metallic maps.
+     * 
+     * @param material material referencing texture files
+     */
+    static void loadMaterialTexturesAsync(std::shared_ptr<Material> &material);
+
+    /**
+     * Decode a texture on the resource loader's worker pool.
+     * 
+     * The decoded image is kept until it is claimed by takeTexture.
+     * Requesting a texture that is already being decoded, under any spelling of its path, returns the existing future.
+     * The same file requested with different encodings results in separate images.
+     * 
+     * @param fileName name of an image file in the resources/textures folder
+     * @param encoding format the texture is converted to
+     * @return future resolving to an image with decoded pixel data but without vulkan handles
+     */
+    static std::shared_future<std::shared_ptr<Image>> loadTextureAsync(const std::string &fileName, TextureEncoding encoding = rgbaEncoding);
+
+    /**
+     * Claim the decoded pixel data of a texture.
+     * 
+     * Waits for a pending decode started by loadTextureAsync, otherwise the file is decoded on the calling thread.
+     * The texture is removed from the pending textures, so the caller is responsible for uploading it.
+     * 
+     * @param fileName name of an image file in the resources/textures folder
+     * @param encoding format the texture was requested with
+     * @return image with decoded pixel data but without vulkan handles
+     */
+    static std::shared_ptr<Image> takeTexture(const std::string &fileName, TextureEncoding encoding = rgbaEncoding);
+
+    /**
+     * Enable or disable block compression of material textures.
+     * 
+     * Enabled by default, the vulkan context disables it on creation if the device cannot sample BC formats.
+     * Disabling it drops pending compressed textures.
+     * 
+     * @param enable true if material textures should be block compressed
+     */
+    static void setTextureCompression(bool enable);
+
+    /**
+     * Return the encoding used for a material texture.
+     * 
+     * @param compressedEncoding encoding used if texture compression is enabled
+     * @return the given encoding or rgbaEncoding if texture compression is disabled
+     */
+    static TextureEncoding getTextureEncoding(TextureEncoding compressedEncoding);
+
+    /**
+     * Bring a relative file path into a unique form.
+     * 
+     * Backslashes are replaced by slashes, empty and "." segments are removed and ".." segments are resolved.
+     * On Windows the path is also converted to lower case since the file system ignores case.
+     * 
+     * @param path relative path of a file
+     * @return normalized path, equal for all spellings of the same file
      */
-    static void loadModel(const std::string &fileName, std::unique_ptr<SceneNode> &parent);
+    static std::string normalizePath(const std::string &path);
+
+    /**
+     * Return the worker pool used for loading resources in the background.
+     * 
+     * The pool is created on first use with one worker per hardware thread.
+     */
+    static ThreadPool &getThreadPool();
 
 private:
 
@@ -76,6 +332,9 @@ private:
      * 
      * The resulting string can be used to replace lines starting with "#include ..." in the shader.
      * The index of the descriptor set has to be relative to the local descriptor set list of the shader set.
+     * "VertexInput" is not a descriptor but the vertex attributes of the current vertex format,
+     * accessed via getPosition, getNormal, getTexCoord, and getTangent.
+     * "VertexPosition" only defines getPosition, for shaders that do not need the other attributes.
      * 
      * @param descriptorName unique name identifying the descriptor
      * @param setIndex relative index of the descriptor set
@@ -84,23 +343,276 @@ private:
      */
     static std::string getDescriptorText(std::string descriptorName, uint32_t setIndex, std::vector<uint32_t> &sceneCounts);
 
+    /**
+     * Parse the materials of an .mtl file.
+     * 
+     * The file is memory-mapped and tokenized in place.
+     * 
+     * @param fileName name of an .mtl file in resources/models without the file ending
+     * @param[out] materials list receiving one material per "newmtl" statement
+     */
+    static void loadMaterials(const std::string &fileName, std::vector<std::shared_ptr<Material>> &materials);
+
+    /**
+     * Fill in the size, modification time and content hash of the source files of a model.
+     * 
+     * @param fileName name of a pair of .obj and .mtl files in resources/models
+     * @param[out] header cache header receiving the source file information
+     * @param computeHash false to skip hashing the file contents
+     * @return true if both source files exist
+     */
+    static bool getModelSourceStatus(const std::string &fileName, ModelCacheHeader &header, bool computeHash);
+
+    /**
+     * Try to load a model from its binary cache.
+     * 
+     * The meshes reference the mapped cache directly, the geometry is not copied until the vertex buffers are created.
+     * 
+     * @param fileName name of a pair of .obj and .mtl files in resources/models
+     * @param parent scene node receiving the loaded geometry as children
+     * @return false if there is no valid cache for the current source files
+     */
+    static bool loadModelCache(const std::string &fileName, std::unique_ptr<SceneNode> &parent);
+
+    /**
+     * Write the parsed meshes and materials of a model into a binary cache.
+     * 
+     * Failing to write the cache is not an error, the model is simply parsed again next time.
+     * 
+     * @param fileName name of a pair of .obj and .mtl files in resources/models
+     * @param materials materials of the model
+     * @param meshes meshes of the model
+     * @param matIndices index of the material assigned to each mesh
+     */
+    static void writeModelCache(const std::string &fileName, std::vector<std::shared_ptr<Material>> &materials,
+        std::vector<std::shared_ptr<Mesh>> &meshes, std::vector<size_t> &matIndices);
+
+    /**
+     * Load a glTF 2.0 model, either a binary .glb file or a .gltf file with external .bin buffers.
+     * 
+     * The file and its buffers are mapped, accessor data is copied from the mapping straight into the vertex and index lists.
+     * The node hierarchy of the default scene is rebuilt with scene nodes, nodes using the same glTF mesh share its Mesh objects
+     * and primitives using the same glTF material share its Material.
+     * A glTF mesh with multiple primitives becomes one child node per primitive.
+     * Only triangle lists are loaded, skins, morph targets, animations and cameras are ignored.
+     * Textures are referenced by the file name of their image, which has to be in resources/textures.
+     * The combined metallic-roughness texture of glTF does not match the separate textures of Material and is not used.
+     * 
+     * @param fileName name of a .glb or .gltf file in resources/models
+     * @param parent scene node receiving the root nodes of the scene as children
+     * @param numThreads maximum number of threads used for building the meshes
+     * @param optimizeMeshes false to keep the order of the file without levels of detail
+     */
+    static void loadGltfModel(const std::string &fileName, std::unique_ptr<SceneNode> &parent, uint32_t numThreads, bool optimizeMeshes);
+
+    /**
+     * Resolve an accessor of a glTF file to the data it refers to.
+     * 
+     * Throws an error if the accessor is sparse, has no buffer view or reaches outside of its buffer view.
+     * 
+     * @param document parsed JSON of the glTF file
+     * @param buffers data of all buffers of the file
+     * @param index index of the accessor
+     * @return typed view of the accessor elements
+     */
+    static GltfAccessor getGltfAccessor(const JsonValue &document, const std::vector<GltfBuffer> &buffers, uint32_t index);
+
+    /**
+     * Read an element of a glTF accessor and convert it to floats.
+     * 
+     * @param accessor accessor with up to four components per element
+     * @param element index of the element
+     * @return components of the element, missing components are 0
+     */
+    static glm::vec4 readGltfElement(const GltfAccessor &accessor, uint32_t element);
+
+    /**
+     * Assemble a glTF primitive into a mesh.
+     * 
+     * Texture coordinates are flipped vertically to match the bottom-up images, which also flips the handedness of tangents.
+     * Missing normals are replaced by the area weighted normals of the adjacent triangles.
+     * 
+     * @param document parsed JSON of the glTF file
+     * @param buffers data of all buffers of the file
+     * @param primitive JSON of the primitive
+     * @param mesh empty mesh receiving vertices and indices
+     * @return true if the primitive contains tangents
+     */
+    static bool buildGltfMesh(const JsonValue &document, const std::vector<GltfBuffer> &buffers, const JsonValue &primitive, std::shared_ptr<Mesh> &mesh);
+
+    /**
+     * Create the scene node of a glTF node including all of its descendants.
+     * 
+     * @param document parsed JSON of the glTF file
+     * @param nodeIndex index of the glTF node
+     * @param meshes meshes of all primitives, nullptr for primitives that are not loaded
+     * @param firstPrimitives index of the first primitive of each glTF mesh in meshes, followed by the total number of primitives
+     * @param primitiveMaterials material of each primitive
+     * @param[out] visited marks the nodes that have been created already, nodes must not appear twice in the hierarchy
+     * @return scene node of the glTF node
+     */
+    static std::unique_ptr<SceneNode> buildGltfNode(const JsonValue &document, uint32_t nodeIndex, std::vector<std::shared_ptr<Mesh>> &meshes,
+        const std::vector<uint32_t> &firstPrimitives, std::vector<std::shared_ptr<Material>> &primitiveMaterials, std::vector<bool> &visited);
+
+    /**
+     * Resolve percent encoded characters in the uri of a glTF buffer or image.
+     * 
+     * @param uri relative uri
+     * @return decoded path
+     */
+    static std::string decodeGltfUri(const std::string &uri);
+
+    /**
+     * Start decoding the textures of all materials in a scene node and its descendants.
+     * 
+     * @param sceneNode node whose subtree is searched for materials
+     */
+    static void loadNodeTexturesAsync(std::unique_ptr<SceneNode> &sceneNode);
+
+    /**
+     * Tokenize a section of an .obj file.
+     * 
+     * The section has to start at the beginning of a line and end after a line break or at the end of the file.
+     * Attribute indices of faces are not validated yet since the attributes of the other chunks are unknown.
+     * 
+     * @param begin first character of the chunk
+     * @param end position directly behind the last character of the chunk
+     * @param[out] chunk parsed attributes, faces and statements
+     */
+    static void parseObjChunk(const char *begin, const char *end, ObjChunk &chunk);
+
+    /**
+     * Assemble the faces of a mesh range into a mesh.
+     * 
+     * Face vertices sharing the same index triplet are welded, faces are triangulated as a fan.
+     * 
+     * @param chunks parsed chunks of the .obj file with global attribute indices
+     * @param meshRange faces making up the mesh
+     * @param positions positions of the whole file
+     * @param normals normals of the whole file
+     * @param texCoords texture coordinates of the whole file
+     * @param mesh empty mesh receiving vertices and indices
+     */
+    static void buildObjMesh(const std::vector<ObjChunk> &chunks, const ObjMeshRange &meshRange,
+        const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &normals, const std::vector<glm::vec2> &texCoords, std::shared_ptr<Mesh> &mesh);
+
+    /**
+     * Execute a task on multiple threads and wait for all of them to finish.
+     * 
+     * The first error thrown by any of the threads is rethrown afterwards.
+     * 
+     * @param numThreads number of threads, the task is executed on the calling thread if this is 1 or less
+     * @param task function receiving the index of the thread
+     */
+    static void runParallel(uint32_t numThreads, const std::function<void(uint32_t)> &task);
+
+    /**
+     * Find the mesh vertex belonging to an index triplet or register a new one.
+     * 
+     * @param table weld table of the current mesh
+     * @param key indices of position, texture coordinates and normal
+     * @param newIndex index the vertex receives in the mesh if it has not been added yet
+     * @param[out] isNew true if the triplet was not in the table and the vertex has to be added to the mesh
+     * @return index of the mesh vertex
+     */
+    static uint32_t weldVertex(VertexWeldTable &table, glm::ivec3 key, uint32_t newIndex, bool &isNew);
+
+    /**
+     * Find the end of the line starting at the cursor.
+     * 
+     * The returned position points at the line break, or at end if the file ends without one.
+     * A carriage return preceding the line break is excluded from the line.
+     * 
+     * @param cursor start of the line
+     * @param end end of the file text
+     * @param[out] nextLine start of the following line
+     * @return position directly behind the last character of the line
+     */
+    static const char *findLineEnd(const char *cursor, const char *end, const char *&nextLine);
+
+    /**
+     * Advance the cursor past spaces and tabs.
+     * 
+     * @param[in,out] cursor current position in the line
+     * @param lineEnd end of the line
+     */
+    static void skipSpaces(const char *&cursor, const char *lineEnd);
+
+    /**
+     * Read the next whitespace-separated token of a line without copying it.
+     * 
+     * @param[in,out] cursor current position in the line, moved behind the token
+     * @param lineEnd end of the line
+     * @param[out] tokenStart first character of the token
+     * @return position directly behind the last character of the token, equal to tokenStart if the line is exhausted
+     */
+    static const char *readToken(const char *&cursor, const char *lineEnd, const char *&tokenStart);
+
+    /**
+     * Compare a token in the file text to a keyword.
+     * 
+     * @param tokenStart first character of the token
+     * @param tokenEnd position directly behind the last character of the token
+     * @param keyword null-terminated keyword
+     * @return true if the token matches the keyword exactly
+     */
+    static bool tokenEquals(const char *tokenStart, const char *tokenEnd, const char *keyword);
+
+    /**
+     * Parse a decimal floating point number from the file text.
+     * 
+     * Independent of the current locale, the decimal separator is always a period.
+     * Leading spaces are skipped, an exponent in scientific notation is supported.
+     * 
+     * @param[in,out] cursor current position in the line, moved behind the number
+     * @param lineEnd end of the line
+     * @return parsed value, 0 if no digits were found
+     */
+    static float parseFloat(const char *&cursor, const char *lineEnd);
+
+    /**
+     * Parse a signed decimal integer from the file text.
+     * 
+     * @param[in,out] cursor current position in the line, moved behind the number
+     * @param lineEnd end of the line
+     * @return parsed value, 0 if no digits were found, saturated at about 10^18 for longer digit runs
+     */
+    static int64_t parseInteger(const char *&cursor, const char *lineEnd);
+
+    /**
+     * Extract the name of a texture file from a texture map statement.
+     * 
+     * The file is assumed to be the last token of the line, any directories are removed from the name.
+     * 
+     * @param cursor start of the statement arguments
+     * @param lineEnd end of the line
+     * @return name of the texture file
+     */
+    static std::string textToFileName(const char *cursor, const char *lineEnd);
+
     /**
      * Convert the file text representing a 2-component vector into a glm vector.
      * 
-     * The coordinates are assumed to be divided by a space character in the file text.
+     * The coordinates are assumed to be divided by whitespace in the file text.
      * 
-     * @param text section of the file text containing only the vector data
+     * @param[in,out] cursor start of the vector data, moved behind the last coordinate
+     * @param lineEnd end of the line
      */
-    static glm::vec2 textToVec2(std::string text);
+    static glm::vec2 textToVec2(const char *&cursor, const char *lineEnd);
 
     /**
      * Convert the file text representing a 3-component vector into a glm vector.
      * 
-     * The coordinates are assumed to be divided by a space character in the file text.
+     * The coordinates are assumed to be divided by whitespace in the file text.
      * 
-     * @param text section of the file text containing only the vector data
+     * @param[in,out] cursor start of the vector data, moved behind the last coordinate
+     * @param lineEnd end of the line
      */
-    static glm::vec3 textToVec3(std::string text);
+    static glm::vec3 textToVec3(const char *&cursor, const char *lineEnd);
+
+    static std::map<std::string, std::shared_future<std::shared_ptr<Image>>> m_pendingTextures; /**< Textures decoded in the background that have not been claimed yet */
+    static std::mutex m_pendingTexturesMutex; /**< Protects the pending textures which are accessed from worker threads */
+    static std::atomic<bool> m_compressTextures; /**< True if material textures are block compressed */
 
 };
 
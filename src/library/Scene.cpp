@@ -57,6 +57,10 @@ void Scene::addSceneNode(std::unique_ptr<SceneNode> &sceneNode) {
     m_rootNode->addChild(sceneNode);
 }
 
+void Scene::addSceneNode(std::future<std::unique_ptr<SceneNode>> &pendingNode) {
+    m_pendingNodes.emplace_back(std::move(pendingNode));
+}
+
 void Scene::addSun(float theta, float phi, glm::vec3 color, float intensity) {
     auto sunDirection = glm::vec3(
         glm::sin(glm::radians(phi)) * glm::cos(glm::radians(theta)),
@@ -71,7 +75,21 @@ void Scene::addSun(float theta, float phi, glm::vec3 color, float intensity) {
 }
 
 void Scene::init(std::shared_ptr<Context> &context, std::vector<DescriptorSet> &descriptorSets) {
+    for(auto &pendingNode : m_pendingNodes) {
+        auto sceneNode = pendingNode.get();
+        m_rootNode->addChild(sceneNode);
+    }
+    m_pendingNodes.clear();
+
+    //decode all textures in parallel while the meshes are being initialized
+    requestTextures(m_rootNode);
     initSceneNode(context, m_rootNode);
+    for(auto &mesh : m_defaultMeshes) {
+        m_geometryArena.addMesh(mesh);
+    }
+    m_geometryArena.createBuffers(context);
+    updateBounds();
+    Image::uploadTextures(context, m_textures);
 
     descriptorSets[1].addBuffer("Materials", VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_numMaterials * sizeof(MaterialUniforms), false, nullptr);
     descriptorSets[1].addBuffer("Lights", VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_numLights * sizeof(LightUniforms), false, nullptr);
@@ -80,12 +98,26 @@ void Scene::init(std::shared_ptr<Context> &context, std::vector<DescriptorSet> &
 
     std::vector<VkImageView> textureImageViews;
     for(auto &texture : m_textures) {
-        textureImageViews.emplace_back(texture.getView());
+        textureImageViews.emplace_back(texture->getView());
     }
     descriptorSets[1].addImages(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textureImageViews);
 
-    for(auto &mesh : m_defaultMeshes) {
-        mesh->createBuffers(context);
+    //start the copies of all scene resources while the renderer sets up its pipelines,
+    //the first frame needs them all, so the graphics queue waits for them instead of the host
+    auto &uploads = context->getUploadManager();
+    uploads->handOver(uploads->flush());
+}
+
+void Scene::requestTextures(std::unique_ptr<SceneNode> &sceneNode) {
+    if(sceneNode->hasMesh()) {
+        auto &mat = sceneNode->getMaterial();
+        if(!mat->hasIndex()) {
+            ResourceLoader::loadMaterialTexturesAsync(mat);
+        }
+    }
+
+    for(auto &child : sceneNode->getChildren()) {
+        requestTextures(child);
     }
 }
 
@@ -93,33 +125,23 @@ void Scene::initSceneNode(std::shared_ptr<Context> &context, std::unique_ptr<Sce
     auto model = parentModel * sceneNode->getModelMatrix();
 
     if(sceneNode->hasMesh()) {
-        if(!sceneNode->getMesh()->hasBuffers()) {
-            sceneNode->getMesh()->createBuffers(context);
-        }
+        m_geometryArena.addMesh(sceneNode->getMesh());
 
         auto &mat = sceneNode->getMaterial();
         if(!mat->hasIndex()) {
             m_materialUniforms.emplace_back(mat->getUniformData());
 
             if(mat->hasDiffuseTexture()) {
-                m_textures.emplace_back(context, mat->getDiffuseTexture());
-                m_materialUniforms[m_numMaterials].diffuseTextureIndex = m_numTextures;
-                m_numTextures++;
+                m_materialUniforms[m_numMaterials].diffuseTextureIndex = getTextureIndex(mat->getDiffuseTexture(), ResourceLoader::getTextureEncoding(bc7Encoding));
             }
             if(mat->hasNormalTexture()) {
-                m_textures.emplace_back(context, mat->getNormalTexture());
-                m_materialUniforms[m_numMaterials].normalTextureIndex = m_numTextures;
-                m_numTextures++;
+                m_materialUniforms[m_numMaterials].normalTextureIndex = getTextureIndex(mat->getNormalTexture(), ResourceLoader::getTextureEncoding(bc5Encoding));
             }
             if(mat->hasRoughnessTexture()) {
-                m_textures.emplace_back(context, mat->getRoughnessTexture());
-                m_materialUniforms[m_numMaterials].roughnessTextureIndex = m_numTextures;
-                m_numTextures++;
+                m_materialUniforms[m_numMaterials].roughnessTextureIndex = getTextureIndex(mat->getRoughnessTexture(), ResourceLoader::getTextureEncoding(bc4Encoding));
             }
             if(mat->hasMetallicTexture()) {
-                m_textures.emplace_back(context, mat->getMetallicTexture());
-                m_materialUniforms[m_numMaterials].metallicTextureIndex = m_numTextures;
-                m_numTextures++;
+                m_materialUniforms[m_numMaterials].metallicTextureIndex = getTextureIndex(mat->getMetallicTexture(), ResourceLoader::getTextureEncoding(bc4Encoding));
             }
 
             mat->setIndex(m_numMaterials);
@@ -147,31 +169,76 @@ void Scene::initSceneNode(std::shared_ptr<Context> &context, std::unique_ptr<Sce
     }
 }
 
+uint32_t Scene::getTextureIndex(const std::string &fileName, TextureEncoding encoding) {
+    auto path = ResourceLoader::normalizePath(fileName) + ":" + BlockEncoder::getName(encoding);
+    auto knownPath = m_texturePaths.find(path);
+    if(knownPath != m_texturePaths.end()) {
+        return knownPath->second;
+    }
+
+    //a copy of a file under a different name is only detected after decoding, but still shares the slot
+    auto texture = ResourceLoader::takeTexture(fileName, encoding);
+    auto content = std::make_pair(texture->getContentHash(), static_cast<uint32_t>(encoding));
+    auto knownContent = m_textureHashes.find(content);
+    if(knownContent != m_textureHashes.end()) {
+        m_texturePaths[path] = knownContent->second;
+        return knownContent->second;
+    }
+
+    m_textures.emplace_back(texture);
+    m_texturePaths[path] = m_numTextures;
+    m_textureHashes[content] = m_numTextures;
+    return m_numTextures++;
+}
+
+void Scene::updateBounds() {
+    m_rootNode->updateBounds();
+}
+
+BoundingBox Scene::getBoundingBox() {
+    return m_rootNode->getWorldBoundingBox();
+}
+
 void Scene::updateUniforms(std::vector<DescriptorSet> &descriptorSets, uint32_t frameIndex) {
     descriptorSets[1].updateBuffer("Materials", frameIndex, m_materialUniforms.data());
     descriptorSets[1].updateBuffer("Lights", frameIndex, m_lightUniforms.data());
 }
 
-void Scene::renderMeshes(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t numInstances) {
-    m_rootNode->renderMesh(commandBuffer, pipelineLayout, numInstances);
+void Scene::renderMeshes(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const LodSelection &lodSelection, uint32_t numInstances, bool bindAttributes) {
+    //draws are grouped by the index buffer they read from
+    m_geometryArena.bind(commandBuffer, bindAttributes);
+    for(auto indexType : {VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32}) {
+        if(m_geometryArena.bindIndices(commandBuffer, indexType)) {
+            m_rootNode->renderMesh(commandBuffer, pipelineLayout, numInstances, lodSelection, indexType);
+        }
+    }
 }
 
 void Scene::renderScreenQuad(VkCommandBuffer commandBuffer) {
+    m_geometryArena.bind(commandBuffer);
+    m_geometryArena.bindIndices(commandBuffer, m_defaultMeshes[0]->getIndexType());
     m_defaultMeshes[0]->render(commandBuffer, 1);
 }
 
-void Scene::renderLightProxies(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) {
-    m_rootNode->renderLightProxy(commandBuffer, pipelineLayout);
+void Scene::renderLightProxies(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, bool bindAttributes) {
+    m_geometryArena.bind(commandBuffer, bindAttributes);
+    for(auto indexType : {VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32}) {
+        if(m_geometryArena.bindIndices(commandBuffer, indexType)) {
+            m_rootNode->renderLightProxy(commandBuffer, pipelineLayout, indexType);
+        }
+    }
 }
 
 void Scene::cleanUp(std::shared_ptr<Context> &context) {
     m_rootNode->cleanUp(context);
 
     for(auto &texture : m_textures) {
-        texture.cleanUp(context);
+        texture->cleanUp(context);
     }
 
     for(auto &mesh : m_defaultMeshes) {
         mesh->cleanUp(context);
     }
+
+    m_geometryArena.cleanUp(context);
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "ResourceLoader.h"
 #include "DescriptorSet.h"
+#include "GeometryArena.h"
 #include "Image.h"
 #include "Light.h"
 
@@ -46,6 +47,16 @@ public:
      */
     void addSceneNode(std::unique_ptr<SceneNode> &sceneNode);
 
+    /**
+     * Add a scene node that is still being loaded in the background.
+     * 
+     * The node is added as a child to the root node once init waits for it.
+     * Since the future can only be read once it will be invalid after.
+     * 
+     * @param pendingNode future resolving to a new scene node, e.g. from ResourceLoader::loadModelAsync
+     */
+    void addSceneNode(std::future<std::unique_ptr<SceneNode>> &pendingNode);
+
     /**
      * Add the sun as a default light source.
      * 
@@ -63,7 +74,12 @@ public:
     /**
      * Initialize meshes, materials, and descriptor sets.
      * 
-     * Mesh buffers are created and material uniforms are gathered to be provided via descriptor sets.
+     * The geometry of all meshes is uploaded into the shared buffers of the scene's geometry arena
+     * and material uniforms are gathered to be provided via descriptor sets.
+     * Scene nodes added as pending nodes are waited for first.
+     * Textures of all materials are then decoded in parallel on the resource loader's worker pool.
+     * All copies are recorded into the upload manager of the context and submitted together at the end.
+     * The world space bounds of the scene graph are computed once all meshes have their buffers.
      * This has to be called before the scene can be rendered.
      * No new meshes or materials can be added to the scene after this point.
      * 
@@ -72,6 +88,18 @@ public:
      */
     void init(std::shared_ptr<Context> &context, std::vector<DescriptorSet> &descriptorSets);
 
+    /**
+     * Recompute the world space bounds of all scene nodes, e.g. after they have been moved.
+     * 
+     * Called by init, the scene has to be initialized first.
+     */
+    void updateBounds();
+
+    /**
+     * Return the box enclosing all meshes of the scene in world coordinates, as of the last updateBounds.
+     */
+    BoundingBox getBoundingBox();
+
     /**
      * Update material uniform data at the beginning of a new frame.
      * 
@@ -83,11 +111,16 @@ public:
     /**
      * Record draw calls for all meshes in the scene graph.
      * 
+     * The vertex buffers of the geometry arena are bound once for all draws,
+     * meshes with 16 bit indices are drawn first, then those with 32 bit indices.
+     * 
      * @param commandBuffer graphics command buffer receiving the draw commands
      * @param pipelineLayout pipeline layout of the current render step
+     * @param lodSelection camera parameters for choosing the level of detail of each mesh
      * @param numInstances number of instances rendered for each mesh
+     * @param bindAttributes false if the render step only reads positions
      */
-    void renderMeshes(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t numInstances = 1);
+    void renderMeshes(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const LodSelection &lodSelection, uint32_t numInstances = 1, bool bindAttributes = true);
 
     /**
      * Record the draw command for a screen-aligned quad.
@@ -103,8 +136,9 @@ public:
      * 
      * @param commandBuffer graphics command buffer receiving the draw command
      * @param pipelineLayout pipeline layout of the current render step
+     * @param bindAttributes false if the render step only reads positions
      */
-    void renderLightProxies(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
+    void renderLightProxies(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, bool bindAttributes = true);
 
     /**
      * Destroy all vulkan components.
@@ -122,21 +156,47 @@ private:
      * @param sceneNode node in the scene graph
      * @param parentModel model matrix of the parent node
      */
+    /**
+     * Start decoding the textures of all materials in a given scene node.
+     * 
+     * Recursively called for all child nodes.
+     * Materials that already have an index are skipped.
+     * 
+     * @param sceneNode node in the scene graph
+     */
+    void requestTextures(std::unique_ptr<SceneNode> &sceneNode);
+
     void initSceneNode(std::shared_ptr<Context> &context, std::unique_ptr<SceneNode> &sceneNode, glm::mat4 parentModel = glm::mat4(1.0f));
 
+    /**
+     * Find the slot of a texture in the texture array or add it as a new one.
+     * 
+     * Textures are identified by their normalized path and by the hash of their file contents, together with their encoding.
+     * Materials referencing the same texture share a single image and descriptor slot.
+     * 
+     * @param fileName name of an image file in the resources/textures folder
+     * @param encoding format the texture is converted to
+     * @return index of the texture in the texture array
+     */
+    uint32_t getTextureIndex(const std::string &fileName, TextureEncoding encoding);
+
     glm::vec3 m_backgroundColor{0.43f, 0.38f, 0.3f}; /**< Color displayed in the background of the scene */
 
     std::unique_ptr<SceneNode> m_rootNode; /**< Root node of the scene graph */
+    std::vector<std::future<std::unique_ptr<SceneNode>>> m_pendingNodes; /**< Scene nodes loaded in the background that are added to the root node in init */
 
     uint32_t m_numMaterials = 0; /**< Number of materials applied throughout the scene graph */
     std::vector<MaterialUniforms> m_materialUniforms; /**< Uniform data for all materials in the scene */
     uint32_t m_numTextures = 0; /**< Number of textures attached to the materials */
-    std::vector<Image> m_textures; /**< Texture images required by the materials */
+    std::vector<std::shared_ptr<Image>> m_textures; /**< Texture images required by the materials */
+    std::map<std::string, uint32_t> m_texturePaths; /**< Texture index for each normalized texture path and encoding */
+    std::map<std::pair<uint64_t, uint32_t>, uint32_t> m_textureHashes; /**< Texture index for each texture file content hash and encoding */
 
     uint32_t m_numLights = 0; /**< Number of light sources in the scene graph */
     std::vector<LightUniforms> m_lightUniforms; /**< Uniform data for all lights in the scene */
 
     std::vector<std::shared_ptr<Mesh>> m_defaultMeshes; /**< Default meshes required for deferred rendering */
+    GeometryArena m_geometryArena; /**< Vertex and index buffers shared by all meshes of the scene */
 
 };
 
@@ -16,7 +16,7 @@ SceneNode::~SceneNode() {
 }
 
 glm::mat4 SceneNode::getModelMatrix() {
-    return glm::scale(glm::translate(glm::mat4(1.0f), m_position) * glm::mat4_cast(m_rotation), glm::vec3(m_scale));
+    return glm::scale(glm::translate(glm::mat4(1.0f), m_position) * glm::mat4_cast(m_rotation), m_scale);
 }
 
 bool SceneNode::hasMesh() {
@@ -51,7 +51,15 @@ void SceneNode::rotate(float degrees, glm::vec3 axis) {
     m_rotation = glm::rotate(m_rotation, glm::radians(degrees), axis);
 }
 
+void SceneNode::setRotation(glm::quat rotation) {
+    m_rotation = rotation;
+}
+
 void SceneNode::setScale(float scale) {
+    m_scale = glm::vec3(scale);
+}
+
+void SceneNode::setScale(glm::vec3 scale) {
     m_scale = scale;
 }
 
@@ -72,39 +80,102 @@ void SceneNode::addChild(std::unique_ptr<SceneNode> &child) {
     m_children.emplace_back(std::move(child));
 }
 
-void SceneNode::renderMesh(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t numInstances, glm::mat4 parentModel) {
+void SceneNode::updateBounds(glm::mat4 parentModel) {
     auto model = parentModel * getModelMatrix();
 
-    if(m_mesh != nullptr) {
+    m_worldBoundingBox = BoundingBox();
+    glm::vec4 meshSphere{0.0f};
+    if(m_mesh != nullptr && !m_mesh->getBoundingBox().isEmpty()) {
+        m_worldBoundingBox.extend(m_mesh->getBoundingBox().transform(model));
+        auto localSphere = m_mesh->getBoundingSphere();
+        meshSphere = glm::vec4(glm::vec3(model * glm::vec4(glm::vec3(localSphere), 1.0f)), getMaxScale(model) * localSphere.w);
+    }
+    for(auto &child : m_children) {
+        child->updateBounds(model);
+        m_worldBoundingBox.extend(child->getWorldBoundingBox());
+    }
+
+    m_worldBoundingSphere = glm::vec4(0.0f);
+    if(m_worldBoundingBox.isEmpty()) {
+        return;
+    }
+    //both the sphere around the box and the one around the enclosed spheres are valid, the smaller one is kept
+    auto center = 0.5f * (m_worldBoundingBox.minimum + m_worldBoundingBox.maximum);
+    float boxRadius = 0.5f * glm::distance(m_worldBoundingBox.minimum, m_worldBoundingBox.maximum);
+    float sphereRadius = 0.0f;
+    if(m_mesh != nullptr && !m_mesh->getBoundingBox().isEmpty()) {
+        sphereRadius = glm::distance(center, glm::vec3(meshSphere)) + meshSphere.w;
+    }
+    for(auto &child : m_children) {
+        if(!child->getWorldBoundingBox().isEmpty()) {
+            auto childSphere = child->getWorldBoundingSphere();
+            sphereRadius = std::max(sphereRadius, glm::distance(center, glm::vec3(childSphere)) + childSphere.w);
+        }
+    }
+    m_worldBoundingSphere = glm::vec4(center, std::min(boxRadius, sphereRadius));
+}
+
+BoundingBox SceneNode::getWorldBoundingBox() {
+    return m_worldBoundingBox;
+}
+
+glm::vec4 SceneNode::getWorldBoundingSphere() {
+    return m_worldBoundingSphere;
+}
+
+void SceneNode::renderMesh(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t numInstances, const LodSelection &lodSelection, VkIndexType indexType, glm::mat4 parentModel) {
+    auto model = parentModel * getModelMatrix();
+
+    if(m_mesh != nullptr && m_mesh->getIndexType() == indexType) {
         SceneNodeConstants constants {
             model,
+            m_mesh->getPositionOffset(),
+            m_mesh->getPositionScale(),
             m_material->getIndex()
         };
         vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SceneNodeConstants), &constants);
 
-        m_mesh->render(commandBuffer, numInstances);
+        uint32_t lod = 0;
+        if(m_mesh->getNumLods() > 1) {
+            //the largest scale of the model matrix keeps the estimate conservative for non-uniform scaling
+            float scale = getMaxScale(model);
+            float pixelsPerUnit = lodSelection.pixelsPerUnit * scale;
+            float distance = 1.0f;
+            if(lodSelection.perspective) {
+                auto boundingSphere = m_mesh->getBoundingSphere();
+                auto center = glm::vec3(model * glm::vec4(glm::vec3(boundingSphere), 1.0f));
+                distance = glm::distance(center, lodSelection.cameraPosition) - scale * boundingSphere.w;
+            }
+            //the camera inside the bounding sphere always gets the full resolution
+            if(distance > 0.0f) {
+                lod = m_mesh->selectLod(pixelsPerUnit / distance, lodSelection.maxPixelError);
+            }
+        }
+        m_mesh->render(commandBuffer, numInstances, lod);
     }
 
     for(auto &child : m_children) {
-        child->renderMesh(commandBuffer, pipelineLayout, numInstances, model);
+        child->renderMesh(commandBuffer, pipelineLayout, numInstances, lodSelection, indexType, model);
     }
 }
 
-void SceneNode::renderLightProxy(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, glm::mat4 parentModel) {
+void SceneNode::renderLightProxy(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkIndexType indexType, glm::mat4 parentModel) {
     auto model = parentModel * getModelMatrix();
 
-    if(m_light != nullptr) {
+    if(m_light != nullptr && m_light->getProxyMesh()->getIndexType() == indexType) {
         SceneNodeConstants constants {
             m_light->getProxyModel(model),
+            m_light->getProxyMesh()->getPositionOffset(),
+            m_light->getProxyMesh()->getPositionScale(),
             m_light->getIndex()
         };
         vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SceneNodeConstants), &constants);
 
-        m_light->getProxyMesh()->render(commandBuffer, 1);
+        m_light->getProxyMesh()->render(commandBuffer, 1, 0);
     }
 
     for(auto &child : m_children) {
-        child->renderLightProxy(commandBuffer, pipelineLayout, model);
+        child->renderLightProxy(commandBuffer, pipelineLayout, indexType, model);
     }
 }
 
@@ -116,4 +187,8 @@ void SceneNode::cleanUp(std::shared_ptr<Context> &context) {
     for(auto &child : m_children) {
         child->cleanUp(context);
     }
+}
+
+float SceneNode::getMaxScale(const glm::mat4 &model) {
+    return glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef SLBVULKAN_SCENENODE_H
 #define SLBVULKAN_SCENENODE_H
 
+#include "Camera.h"
 #include "Mesh.h"
 #include "Material.h"
 #include "Light.h"
@@ -12,6 +13,8 @@
  */
 struct SceneNodeConstants {
     glm::mat4 model; /**< Model matrix transforming local coordiantes to world coordinates */
+    glm::vec4 positionOffset; /**< Offset restoring the local coordinates of packed vertices */
+    glm::vec4 positionScale; /**< Scale restoring the local coordinates of packed vertices */
     uint32_t currentIndex; /**< Index of a relevant component e.g. material, light source, etc. */
 };
 
@@ -97,6 +100,13 @@ public:
      */
     void rotate(float degrees, glm::vec3 axis);
 
+    /**
+     * Replace the rotation of the local coordinate system of the scene node.
+     * 
+     * @param rotation unit quaternion describing the new rotation
+     */
+    void setRotation(glm::quat rotation);
+
     /**
      * Change the scale of the local coordinate system of the scene node.
      * 
@@ -106,6 +116,13 @@ public:
      */
     void setScale(float scale);
 
+    /**
+     * Change the scale of the local coordinate system of the scene node separately for each axis.
+     * 
+     * @param scale factors scaling the local x, y and z axes
+     */
+    void setScale(glm::vec3 scale);
+
     /**
      * Scale the local coordinate system of the scene node.
      * 
@@ -146,17 +163,46 @@ public:
      */
     void addChild(std::unique_ptr<SceneNode> &child);
 
+    /**
+     * Compute the world space bounds of the meshes in this node and all of its descendants.
+     * 
+     * Recursively called for all child nodes, the bounds of the children are merged into those of the parent.
+     * Has to be called again on the root node after transformations have changed.
+     * Light sources do not contribute to the bounds.
+     * 
+     * @param parentModel model matrix of the parent node
+     */
+    void updateBounds(glm::mat4 parentModel = glm::mat4(1.0f));
+
+    /**
+     * Return the box enclosing all meshes of the subtree in world coordinates, as of the last updateBounds.
+     * 
+     * @return axis aligned box, empty if the subtree contains no meshes
+     */
+    BoundingBox getWorldBoundingBox();
+
+    /**
+     * Return the sphere enclosing all meshes of the subtree in world coordinates, as of the last updateBounds.
+     * 
+     * @return center and radius as w component, zero if the subtree contains no meshes
+     */
+    glm::vec4 getWorldBoundingSphere();
+
     /**
      * Render the attached mesh.
      * 
      * Recursively called for all child nodes.
+     * The level of detail is chosen by projecting the bounding sphere of the mesh onto the screen,
+     * the coarsest level whose error covers at most lodSelection.maxPixelError pixels is drawn.
      * 
      * @param commandBuffer graphics command buffer receiving the draw command
      * @param pipelineLayout pipeline layout of the current render step
      * @param numInstances number of instances rendered for the mesh
+     * @param lodSelection camera parameters for choosing the level of detail
+     * @param indexType only meshes with this index type are drawn, matching the bound index buffer
      * @param parentModel model matrix of the parent node
      */
-    void renderMesh(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t numInstances, glm::mat4 parentModel = glm::mat4(1.0f));
+    void renderMesh(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t numInstances, const LodSelection &lodSelection, VkIndexType indexType, glm::mat4 parentModel = glm::mat4(1.0f));
 
     /**
      * Render the proxy geometry of the attached light source.
@@ -165,9 +211,10 @@ public:
      * 
      * @param commandBuffer graphics command buffer receiving the draw command
      * @param pipelineLayout pipeline layout of the current render step
+     * @param indexType only proxies with this index type are drawn, matching the bound index buffer
      * @param parentModel model matrix of the parent node
      */
-    void renderLightProxy(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, glm::mat4 parentModel = glm::mat4(1.0f));
+    void renderLightProxy(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkIndexType indexType, glm::mat4 parentModel = glm::mat4(1.0f));
 
     /**
      * Destroy all vulkan components.
@@ -177,9 +224,17 @@ public:
     void cleanUp(std::shared_ptr<Context> &context);
 
 private:
+    /**
+     * Return the largest factor by which a model matrix scales distances.
+     * 
+     * @param model model matrix
+     * @return length of the longest of the first three columns
+     */
+    static float getMaxScale(const glm::mat4 &model);
+
     glm::vec3 m_position{0.0f}; /**< Position the node is located at in the local coordinates of the parent node */
     glm::quat m_rotation{1.0f, 0.0f, 0.0f, 0.0f}; /**< Rotation of the node in the local coordinates of the parent node */
-    float m_scale{1.0f}; /**< Factor scaling the node contents relative to the parent node */  
+    glm::vec3 m_scale{1.0f}; /**< Factors scaling the node contents relative to the parent node */  
     
     std::shared_ptr<Mesh> m_mesh = nullptr; /**< Geometry rendered with the transformations of this scene node */
     std::shared_ptr<Material> m_material = nullptr; /**< Material applied to the mesh instance */
@@ -188,6 +243,9 @@ private:
 
     std::vector<std::unique_ptr<SceneNode>> m_children; /**< Child nodes subject to this node's transformations */
 
+    BoundingBox m_worldBoundingBox; /**< World space box enclosing the meshes of this node and its descendants */
+    glm::vec4 m_worldBoundingSphere{0.0f}; /**< World space sphere enclosing the meshes of this node and its descendants */
+
 };
 
 #endif //SLBVULKAN_SCENENODE_H
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t numThreads) {
+    if(numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for(uint32_t t=0; t<numThreads; t++) {
+        m_workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for(auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+uint32_t ThreadPool::getNumThreads() {
+    return static_cast<uint32_t>(m_workers.size());
+}
+
+void ThreadPool::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.emplace_back(std::move(job));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::work() {
+    while(true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() {
+                return m_stopping || !m_jobs.empty();
+            });
+            if(m_jobs.empty()) {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef SLBVULKAN_THREADPOOL_H
+#define SLBVULKAN_THREADPOOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Fixed set of worker threads executing submitted tasks in order of submission.
+ *
+ * Used for loading resources in the background while the application continues.
+ * Tasks must not wait on other tasks of the same pool, otherwise all workers may end up blocked.
+ * Remaining tasks are still executed when the pool is destroyed, so no future is left unresolved.
+ */
+class ThreadPool {
+public:
+    /**
+     * Create a pool and start its worker threads.
+     *
+     * @param numThreads number of worker threads, 0 uses all hardware threads
+     */
+    ThreadPool(uint32_t numThreads = 0);
+
+    /**
+     * Finish all remaining tasks and join the worker threads.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool &operator=(const ThreadPool&) = delete;
+
+    /**
+     * Return the number of worker threads.
+     */
+    uint32_t getNumThreads();
+
+    /**
+     * Queue a task for execution on one of the worker threads.
+     *
+     * Exceptions thrown by the task are stored in the returned future and rethrown by get().
+     *
+     * @param task callable object without parameters
+     * @return future resolving to the return value of the task
+     */
+    template<typename Task>
+    std::future<typename std::result_of<Task()>::type> submit(Task task) {
+        typedef typename std::result_of<Task()>::type Result;
+        //packaged tasks can only be moved, std::function requires a copyable object
+        auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        auto future = packagedTask->get_future();
+        enqueue([packagedTask]() {
+            (*packagedTask)();
+        });
+        return future;
+    }
+
+private:
+    /**
+     * Add a job to the queue and wake up a worker.
+     *
+     * @param job function executed by the next free worker
+     */
+    void enqueue(std::function<void()> job);
+
+    /**
+     * Loop executed by each worker thread.
+     *
+     * Takes jobs from the queue until the pool is stopped and the queue is empty.
+     */
+    void work();
+
+    std::vector<std::thread> m_workers; /**< Worker threads executing the queued jobs */
+    std::deque<std::function<void()>> m_jobs; /**< Jobs waiting for a free worker */
+    std::mutex m_mutex; /**< Protects the job queue and the stop flag */
+    std::condition_variable m_condition; /**< Signals new jobs or the end of the pool to the workers */
+    bool m_stopping = false; /**< True once the pool is being destroyed */
+
+};
+
+#endif //SLBVULKAN_THREADPOOL_H
\ No newline at end of file
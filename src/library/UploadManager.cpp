@@ -0,0 +1,385 @@
+#include "UploadManager.h"
+
+#include <algorithm>
+#include <cstring>
+
+UploadManager::UploadManager(VkDevice device, MemoryAllocator &allocator, VkQueue transferQueue, uint32_t transferFamilyIndex, VkQueue graphicsQueue, uint32_t graphicsFamilyIndex)
+: m_device(device), m_allocator(&allocator), m_queue(transferQueue), m_queueFamilyIndex(transferFamilyIndex), m_graphicsQueue(graphicsQueue), m_graphicsFamilyIndex(graphicsFamilyIndex) {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_queueFamilyIndex;
+    if(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("UPLOAD MANAGER ERROR: Could not create command pool.");
+    }
+    if(hasTransferQueue()) {
+        poolInfo.queueFamilyIndex = m_graphicsFamilyIndex;
+        if(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_graphicsCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("UPLOAD MANAGER ERROR: Could not create command pool.");
+        }
+    }
+
+    createStagingBuffer(stagingRingSize, m_ringBuffer, m_ringMemory);
+}
+
+bool UploadManager::hasTransferQueue() {
+    return m_queueFamilyIndex != m_graphicsFamilyIndex;
+}
+
+StagingRange UploadManager::stage(VkDeviceSize size, VkDeviceSize alignment) {
+    updateBatches();
+    alignment = std::max<VkDeviceSize>(alignment, 1);
+    StagingRange range;
+
+    //large uploads would block the ring for too long, they get a buffer of their own
+    if(size > stagingRingSize / 2) {
+        openBatch();
+        MemoryAllocation memory;
+        createStagingBuffer(size, range.buffer, memory);
+        range.data = static_cast<unsigned char*>(memory.mapped);
+        m_openBatch.temporaryBuffers.emplace_back(range.buffer);
+        m_openBatch.temporaryMemory.emplace_back(memory);
+        return range;
+    }
+
+    while(true) {
+        //ranges never wrap around the end of the ring, the rest of the ring is skipped instead
+        VkDeviceSize offset = (m_ringHead + alignment - 1) / alignment * alignment;
+        if(offset + size > stagingRingSize) {
+            offset = 0;
+        }
+        VkDeviceSize required = offset >= m_ringHead ? offset + size - m_ringHead : stagingRingSize - m_ringHead + size;
+        if(m_ringUsed + required <= stagingRingSize) {
+            openBatch();
+            m_ringHead = offset + size;
+            m_ringUsed += required;
+            m_openBatch.ringBytes += required;
+            range.buffer = m_ringBuffer;
+            range.offset = offset;
+            range.data = static_cast<unsigned char*>(m_ringMemory.mapped) + offset;
+            return range;
+        }
+
+        //the ring is full, submit what has been recorded so far and wait for the oldest copies to free their range
+        flush();
+        auto oldest = std::find_if(m_pendingBatches.begin(), m_pendingBatches.end(), [](const UploadBatch &batch) {
+            return !batch.transferred;
+        });
+        if(oldest != m_pendingBatches.end()) {
+            updateBatches(oldest->id);
+        }
+    }
+}
+
+VkCommandBuffer UploadManager::getCommandBuffer() {
+    openBatch();
+    return m_openBatch.commandBuffer;
+}
+
+VkCommandBuffer UploadManager::getGraphicsCommandBuffer() {
+    openBatch();
+    return hasTransferQueue() ? m_openBatch.graphicsCommandBuffer : m_openBatch.commandBuffer;
+}
+
+void UploadManager::releaseBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size) {
+    if(!hasTransferQueue()) {
+        return;
+    }
+    openBatch();
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = m_queueFamilyIndex;
+    barrier.dstQueueFamilyIndex = m_graphicsFamilyIndex;
+    barrier.buffer = buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+
+    //release on the transfer queue, the destination access is ignored there
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(m_openBatch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    //matching acquire on the graphics queue, the source access is ignored there
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(m_openBatch.graphicsCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void UploadManager::releaseImage(VkImage image, const VkImageSubresourceRange &range, VkImageLayout layout) {
+    if(!hasTransferQueue()) {
+        return;
+    }
+    openBatch();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = layout;
+    barrier.newLayout = layout;
+    barrier.srcQueueFamilyIndex = m_queueFamilyIndex;
+    barrier.dstQueueFamilyIndex = m_graphicsFamilyIndex;
+    barrier.image = image;
+    barrier.subresourceRange = range;
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(m_openBatch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(m_openBatch.graphicsCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+uint64_t UploadManager::uploadBuffer(const void *data, VkDeviceSize size, VkBuffer buffer, VkDeviceSize offset) {
+    auto range = stage(size);
+    memcpy(range.data, data, static_cast<size_t>(size));
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = range.offset;
+    copyRegion.dstOffset = offset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(getCommandBuffer(), range.buffer, buffer, 1, &copyRegion);
+    releaseBuffer(buffer, offset, size);
+    return m_openBatch.id;
+}
+
+uint64_t UploadManager::getBatchId() {
+    openBatch();
+    return m_openBatch.id;
+}
+
+uint64_t UploadManager::flush() {
+    if(!m_batchOpen) {
+        updateBatches();
+        return m_nextBatchId - 1;
+    }
+
+    //with a transfer queue the visibility for the graphics queue is established by the hand over
+    if(!hasTransferQueue()) {
+        recordVisibilityBarrier(m_openBatch.commandBuffer);
+    }
+    if(vkEndCommandBuffer(m_openBatch.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("UPLOAD MANAGER ERROR: Could not record upload command buffer.");
+    }
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_openBatch.commandBuffer;
+    if(hasTransferQueue()) {
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &m_openBatch.semaphore;
+    }
+    if(vkQueueSubmit(m_queue, 1, &submitInfo, m_openBatch.fence) != VK_SUCCESS) {
+        throw std::runtime_error("UPLOAD MANAGER ERROR: Could not submit upload command buffer.");
+    }
+
+    uint64_t batchId = m_openBatch.id;
+    m_openBatch.handedOver = !hasTransferQueue();
+    m_pendingBatches.emplace_back(std::move(m_openBatch));
+    m_openBatch = UploadBatch();
+    m_batchOpen = false;
+
+    updateBatches();
+    return batchId;
+}
+
+void UploadManager::handOver(uint64_t batchId) {
+    if(m_batchOpen && m_openBatch.id <= batchId) {
+        flush();
+    }
+    updateBatches(0, batchId);
+}
+
+bool UploadManager::isComplete(uint64_t batchId) {
+    if(m_batchOpen && m_openBatch.id <= batchId) {
+        return false;
+    }
+    updateBatches();
+    return m_pendingBatches.empty() || m_pendingBatches.front().id > batchId;
+}
+
+void UploadManager::wait(uint64_t batchId) {
+    if(m_batchOpen && m_openBatch.id <= batchId) {
+        flush();
+    }
+    updateBatches(batchId, batchId, batchId);
+}
+
+void UploadManager::waitIdle() {
+    wait(flush());
+}
+
+void UploadManager::cleanUp() {
+    waitIdle();
+    for(auto &batch : m_idleBatches) {
+        vkDestroyFence(m_device, batch.fence, nullptr);
+        vkDestroyFence(m_device, batch.graphicsFence, nullptr);
+        vkDestroySemaphore(m_device, batch.semaphore, nullptr);
+    }
+    m_idleBatches.clear();
+
+    vkDestroyBuffer(m_device, m_ringBuffer, nullptr);
+    m_allocator->free(m_ringMemory);
+    m_ringBuffer = VK_NULL_HANDLE;
+
+    //destroying the pools also frees the command buffers
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyCommandPool(m_device, m_graphicsCommandPool, nullptr);
+    m_commandPool = VK_NULL_HANDLE;
+    m_graphicsCommandPool = VK_NULL_HANDLE;
+}
+
+void UploadManager::openBatch() {
+    if(m_batchOpen) {
+        return;
+    }
+
+    if(!m_idleBatches.empty()) {
+        m_openBatch = std::move(m_idleBatches.back());
+        m_idleBatches.pop_back();
+    } else {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = m_commandPool;
+        allocInfo.commandBufferCount = 1;
+        if(vkAllocateCommandBuffers(m_device, &allocInfo, &m_openBatch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("UPLOAD MANAGER ERROR: Could not allocate upload command buffer.");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if(vkCreateFence(m_device, &fenceInfo, nullptr, &m_openBatch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("UPLOAD MANAGER ERROR: Could not create upload fence.");
+        }
+
+        if(hasTransferQueue()) {
+            allocInfo.commandPool = m_graphicsCommandPool;
+            if(vkAllocateCommandBuffers(m_device, &allocInfo, &m_openBatch.graphicsCommandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("UPLOAD MANAGER ERROR: Could not allocate upload command buffer.");
+            }
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            if(vkCreateFence(m_device, &fenceInfo, nullptr, &m_openBatch.graphicsFence) != VK_SUCCESS ||
+               vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_openBatch.semaphore) != VK_SUCCESS) {
+                throw std::runtime_error("UPLOAD MANAGER ERROR: Could not create upload synchronization objects.");
+            }
+        }
+    }
+    m_openBatch.id = m_nextBatchId++;
+    m_openBatch.ringBytes = 0;
+    m_openBatch.transferred = false;
+    m_openBatch.handedOver = false;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if(vkBeginCommandBuffer(m_openBatch.commandBuffer, &beginInfo) != VK_SUCCESS ||
+       (hasTransferQueue() && vkBeginCommandBuffer(m_openBatch.graphicsCommandBuffer, &beginInfo) != VK_SUCCESS)) {
+        throw std::runtime_error("UPLOAD MANAGER ERROR: Could not record upload command buffer.");
+    }
+    m_batchOpen = true;
+}
+
+void UploadManager::updateBatches(uint64_t transferId, uint64_t handOverId, uint64_t completeId) {
+    //batches on a queue complete in the order of submission, so the ring is freed from its tail
+    bool transferring = true;
+    bool handingOver = true;
+    for(auto &batch : m_pendingBatches) {
+        if(!batch.transferred && transferring) {
+            if(batch.id <= transferId) {
+                vkWaitForFences(m_device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+            }
+            if(batch.id <= transferId || vkGetFenceStatus(m_device, batch.fence) == VK_SUCCESS) {
+                for(size_t b=0; b<batch.temporaryBuffers.size(); b++) {
+                    vkDestroyBuffer(m_device, batch.temporaryBuffers[b], nullptr);
+                    m_allocator->free(batch.temporaryMemory[b]);
+                }
+                batch.temporaryBuffers.clear();
+                batch.temporaryMemory.clear();
+                m_ringUsed -= batch.ringBytes;
+                batch.transferred = true;
+            } else {
+                transferring = false;
+            }
+        }
+
+        //finished copies are handed over right away, the semaphore wait on the graphics queue is then already satisfied
+        if(!batch.handedOver && handingOver) {
+            if(batch.transferred || batch.id <= handOverId) {
+                submitHandOver(batch);
+            } else {
+                handingOver = false;
+            }
+        }
+    }
+
+    while(!m_pendingBatches.empty()) {
+        auto &batch = m_pendingBatches.front();
+        if(!batch.transferred || !batch.handedOver) {
+            break;
+        }
+        if(hasTransferQueue()) {
+            if(batch.id <= completeId) {
+                vkWaitForFences(m_device, 1, &batch.graphicsFence, VK_TRUE, UINT64_MAX);
+            } else if(vkGetFenceStatus(m_device, batch.graphicsFence) != VK_SUCCESS) {
+                break;
+            }
+            vkResetFences(m_device, 1, &batch.graphicsFence);
+        }
+        vkResetFences(m_device, 1, &batch.fence);
+
+        m_idleBatches.emplace_back(std::move(batch));
+        m_pendingBatches.pop_front();
+    }
+    //an empty ring starts over at the beginning, so large ranges do not have to skip its end
+    if(m_ringUsed == 0 && !m_batchOpen) {
+        m_ringHead = 0;
+    }
+}
+
+void UploadManager::submitHandOver(UploadBatch &batch) {
+    recordVisibilityBarrier(batch.graphicsCommandBuffer);
+    if(vkEndCommandBuffer(batch.graphicsCommandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("UPLOAD MANAGER ERROR: Could not record upload command buffer.");
+    }
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &batch.semaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.graphicsCommandBuffer;
+    if(vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, batch.graphicsFence) != VK_SUCCESS) {
+        throw std::runtime_error("UPLOAD MANAGER ERROR: Could not submit upload command buffer.");
+    }
+    batch.handedOver = true;
+}
+
+void UploadManager::recordVisibilityBarrier(VkCommandBuffer commandBuffer) {
+    //later submissions on the graphics queue may read the uploaded data in any stage
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void UploadManager::createStagingBuffer(VkDeviceSize size, VkBuffer &buffer, MemoryAllocation &memory) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if(vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("UPLOAD MANAGER ERROR: Could not create staging buffer.");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &memoryRequirements);
+    m_allocator->allocate(memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, bufferAllocation, memory);
+    vkBindBufferMemory(m_device, buffer, memory.memory, memory.offset);
+}
\ No newline at end of file
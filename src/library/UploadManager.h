@@ -0,0 +1,256 @@
+#ifndef SLBVULKAN_UPLOADMANAGER_H
+#define SLBVULKAN_UPLOADMANAGER_H
+
+#include <deque>
+
+#include "MemoryAllocator.h"
+
+/** Size of the persistently mapped staging buffer that uploads are written to */
+const VkDeviceSize stagingRingSize = 64 * 1024 * 1024;
+
+/**
+ * Range of staging memory reserved for a single upload.
+ */
+struct StagingRange {
+    VkBuffer buffer = VK_NULL_HANDLE; /**< Staging buffer the copy commands read from */
+    VkDeviceSize offset = 0; /**< Start of the range inside the staging buffer */
+    unsigned char *data = nullptr; /**< Host address of the range the contents are written to */
+};
+
+/**
+ * Copy commands recorded into one command buffer and submitted together.
+ */
+struct UploadBatch {
+    uint64_t id = 0; /**< Number identifying the batch, increases with each batch */
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE; /**< Command buffer receiving the copy commands */
+    VkFence fence = VK_NULL_HANDLE; /**< Signaled once the GPU has executed the copy commands */
+    VkDeviceSize ringBytes = 0; /**< Bytes of the staging ring used by the batch, including alignment padding */
+    std::vector<VkBuffer> temporaryBuffers; /**< Staging buffers of uploads too large for the ring, destroyed once the copies are complete */
+    std::vector<MemoryAllocation> temporaryMemory; /**< Memory of the temporary staging buffers */
+    bool transferred = false; /**< True once the copy commands are complete and the staging memory has been released */
+
+    VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE; /**< Command buffer acquiring the uploaded resources on the graphics queue, only used with a transfer queue */
+    VkFence graphicsFence = VK_NULL_HANDLE; /**< Signaled once the graphics queue has acquired the resources */
+    VkSemaphore semaphore = VK_NULL_HANDLE; /**< Signaled by the transfer queue, waited for by the graphics queue */
+    bool handedOver = false; /**< True once the graphics part of the batch has been submitted */
+};
+
+/**
+ * Streams buffer and image contents to the GPU without waiting for each copy.
+ *
+ * Contents are written into a persistently mapped staging ring and the copy commands of many uploads
+ * are recorded into one command buffer, which is submitted by flush, e.g. once per frame by the renderer.
+ * A fence per batch tracks its completion, ring memory is only reused after the batch reading it is complete.
+ * If the ring is full the current batch is submitted and the oldest batches are waited for,
+ * uploads larger than half the ring get a temporary staging buffer instead.
+ *
+ * If the transfer queue belongs to a different family than the graphics queue, the copies run on the transfer queue
+ * alongside rendering. Ownership of the uploaded resources is released to the graphics family at the end of the copies
+ * and acquired by a second, small command buffer on the graphics queue, which waits for a semaphore signaled by the copies.
+ * That command buffer also receives commands the transfer queue cannot execute, like mip level blits.
+ * It is only submitted once the copies are complete, so frames submitted in between are not held up,
+ * unless handOver asks for the resources right away.
+ * With a single queue all commands go into one command buffer and the ownership transfers are skipped.
+ * In both cases the end of a batch makes the uploaded data visible to all later commands on the graphics queue.
+ * Uploads have to be recorded from a single thread.
+ */
+class UploadManager {
+public:
+    /**
+     * Create the staging ring and command pools for the upload batches.
+     *
+     * @param device logical device
+     * @param allocator memory allocator providing the staging memory
+     * @param transferQueue queue the copies are submitted to
+     * @param transferFamilyIndex family of the transfer queue
+     * @param graphicsQueue queue the uploaded resources are used on
+     * @param graphicsFamilyIndex family of the graphics queue, may be the same as the transfer family
+     */
+    UploadManager(VkDevice device, MemoryAllocator &allocator, VkQueue transferQueue, uint32_t transferFamilyIndex, VkQueue graphicsQueue, uint32_t graphicsFamilyIndex);
+
+    /**
+     * Check whether the copies run on a queue of their own.
+     *
+     * @return true if transfer and graphics queue belong to different families
+     */
+    bool hasTransferQueue();
+
+    /**
+     * Reserve staging memory for an upload.
+     *
+     * The contents have to be written to range.data, the copies reading them have to be recorded
+     * into the command buffer returned by getCommandBuffer afterwards, before anything else is staged.
+     *
+     * @param size number of bytes to stage
+     * @param alignment required alignment of the offset inside the staging buffer, e.g. for the texel blocks of images
+     * @return staging buffer, offset, and host address of the reserved range
+     */
+    StagingRange stage(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+    /**
+     * Return the command buffer of the batch that is currently being recorded.
+     *
+     * Only copies and layout transitions are allowed, the command buffer may belong to a transfer queue.
+     * Each resource written by the copies has to be passed to releaseBuffer or releaseImage afterwards.
+     *
+     * @return command buffer in the recording state
+     */
+    VkCommandBuffer getCommandBuffer();
+
+    /**
+     * Return the command buffer executed on the graphics queue after the copies of the current batch.
+     *
+     * Resources are only accessible in it after they have been released.
+     *
+     * @return command buffer in the recording state, the same as getCommandBuffer without a transfer queue
+     */
+    VkCommandBuffer getGraphicsCommandBuffer();
+
+    /**
+     * Hand a buffer written by the current batch over to the graphics queue.
+     *
+     * @param buffer buffer written by the copies
+     * @param offset start of the written range
+     * @param size size of the written range
+     */
+    void releaseBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+    /**
+     * Hand an image written by the current batch over to the graphics queue.
+     *
+     * The layout is kept, transitions for sampling have to follow in the graphics command buffer.
+     *
+     * @param image image written by the copies
+     * @param range mip levels and array layers written by the copies
+     * @param layout current layout of the image
+     */
+    void releaseImage(VkImage image, const VkImageSubresourceRange &range, VkImageLayout layout);
+
+    /**
+     * Copy data into a buffer and hand the buffer over to the graphics queue.
+     *
+     * The data is written into the staging ring immediately and can be released by the caller.
+     *
+     * @param data contents to upload
+     * @param size number of bytes to upload
+     * @param buffer destination buffer, which needs VK_BUFFER_USAGE_TRANSFER_DST_BIT
+     * @param offset position in the destination buffer
+     * @return id of the batch containing the copy
+     */
+    uint64_t uploadBuffer(const void *data, VkDeviceSize size, VkBuffer buffer, VkDeviceSize offset = 0);
+
+    /**
+     * Return the id of the batch that is currently being recorded.
+     */
+    uint64_t getBatchId();
+
+    /**
+     * Submit the batch that is currently being recorded.
+     *
+     * Batches whose copies have completed in the meantime are handed over to the graphics queue.
+     * Does not block.
+     *
+     * @return id of the last submitted batch
+     */
+    uint64_t flush();
+
+    /**
+     * Hand batches over to the graphics queue without waiting for their copies on the host.
+     *
+     * Graphics commands submitted afterwards can use the uploaded resources,
+     * the graphics queue waits for the copies if they are not complete yet.
+     *
+     * @param batchId id returned by uploadBuffer, getBatchId or flush, the batch is submitted if necessary
+     */
+    void handOver(uint64_t batchId);
+
+    /**
+     * Check whether the GPU has finished a batch.
+     *
+     * @param batchId id returned by uploadBuffer, getBatchId or flush
+     */
+    bool isComplete(uint64_t batchId);
+
+    /**
+     * Submit a batch if necessary and block until it is complete.
+     *
+     * @param batchId id returned by uploadBuffer, getBatchId or flush
+     */
+    void wait(uint64_t batchId);
+
+    /**
+     * Submit the current batch and block until all uploads are complete.
+     */
+    void waitIdle();
+
+    /**
+     * Wait for all uploads and destroy all vulkan components.
+     */
+    void cleanUp();
+
+private:
+    /**
+     * Start recording a new batch if none is being recorded.
+     *
+     * Command buffers, fences, and semaphores of completed batches are reused.
+     */
+    void openBatch();
+
+    /**
+     * Advance submitted batches in the order of submission.
+     *
+     * Staging memory of batches whose copies are complete is released and their graphics part is submitted.
+     * Batches are retired once complete.
+     *
+     * @param transferId the copies of batches up to this id are waited for
+     * @param handOverId batches up to this id are handed over even if their copies are not complete yet
+     * @param completeId batches up to this id are waited for until complete
+     */
+    void updateBatches(uint64_t transferId = 0, uint64_t handOverId = 0, uint64_t completeId = 0);
+
+    /**
+     * Submit the graphics command buffer of a batch, waiting for the semaphore of its copies.
+     *
+     * @param batch submitted batch with a transfer queue
+     */
+    void submitHandOver(UploadBatch &batch);
+
+    /**
+     * Record a barrier making the uploaded data visible to all later commands.
+     *
+     * @param commandBuffer command buffer executed last in a batch
+     */
+    void recordVisibilityBarrier(VkCommandBuffer commandBuffer);
+
+    /**
+     * Create a host visible buffer uploads are copied from.
+     *
+     * @param size size of the buffer in bytes
+     * @param[out] buffer vulkan handle of the buffer
+     * @param[out] memory persistently mapped memory of the buffer
+     */
+    void createStagingBuffer(VkDeviceSize size, VkBuffer &buffer, MemoryAllocation &memory);
+
+    VkDevice m_device = VK_NULL_HANDLE; /**< Logical device */
+    MemoryAllocator *m_allocator = nullptr; /**< Memory allocator providing the staging memory */
+    VkQueue m_queue = VK_NULL_HANDLE; /**< Queue the copies are submitted to */
+    uint32_t m_queueFamilyIndex = 0; /**< Family of the queue the copies are submitted to */
+    VkCommandPool m_commandPool = VK_NULL_HANDLE; /**< Pool the command buffers of the copies are allocated from */
+    VkQueue m_graphicsQueue = VK_NULL_HANDLE; /**< Queue the uploaded resources are used on */
+    uint32_t m_graphicsFamilyIndex = 0; /**< Family of the graphics queue */
+    VkCommandPool m_graphicsCommandPool = VK_NULL_HANDLE; /**< Pool the command buffers acquiring the resources are allocated from, only used with a transfer queue */
+
+    VkBuffer m_ringBuffer = VK_NULL_HANDLE; /**< Vulkan handle of the staging ring */
+    MemoryAllocation m_ringMemory; /**< Persistently mapped memory of the staging ring */
+    VkDeviceSize m_ringHead = 0; /**< Position in the ring the next range is reserved at */
+    VkDeviceSize m_ringUsed = 0; /**< Bytes of the ring used by batches whose copies are not complete yet */
+
+    bool m_batchOpen = false; /**< True if a batch is being recorded */
+    UploadBatch m_openBatch; /**< Batch that is currently being recorded */
+    std::deque<UploadBatch> m_pendingBatches; /**< Submitted batches in the order of submission */
+    std::vector<UploadBatch> m_idleBatches; /**< Completed batches whose command buffers and synchronization objects can be reused */
+    uint64_t m_nextBatchId = 1; /**< Id of the next batch that is opened */
+
+};
+
+#endif //SLBVULKAN_UPLOADMANAGER_H
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <thread>
+
+#include "ResourceLoader.h"
+
+/**
+ * Size and modification time of a cache file, compared before and after a job to tell whether it was rebuilt.
+ */
+struct CacheStatus {
+    bool exists = false; /**< True if the file existed */
+    uint64_t size = 0; /**< Number of bytes in the file */
+    uint64_t modificationTime = 0; /**< Time of the last modification in platform specific units */
+};
+
+/**
+ * Query the status of a cache file.
+ */
+CacheStatus getCacheStatus(const std::string &path) {
+    CacheStatus status;
+    status.exists = MappedFile::getFileStatus(path, status.size, status.modificationTime);
+    return status;
+}
+
+/**
+ * Check whether a cache file has been written since its status was queried.
+ */
+bool wasRebuilt(const std::string &path, const CacheStatus &before) {
+    auto after = getCacheStatus(path);
+    return after.exists && (!before.exists || after.size != before.size || after.modificationTime != before.modificationTime);
+}
+
+/**
+ * Texture file referenced by a material together with the encoding its slot requires.
+ */
+struct TextureJob {
+    std::string fileName; /**< Name of the texture in resources/textures */
+    TextureEncoding encoding; /**< Block compression used for the texture */
+    std::string cachePath; /**< Path of the cache file written by Image::decodeTexture */
+    CacheStatus before; /**< Status of the cache file before the job started */
+};
+
+/**
+ * Collect the textures of all materials in a scene node and its descendants.
+ */
+void collectTextures(std::unique_ptr<SceneNode> &sceneNode, std::set<std::pair<std::string, TextureEncoding>> &textures) {
+    if(sceneNode->hasMesh()) {
+        auto &material = sceneNode->getMaterial();
+        if(material->hasDiffuseTexture()) {
+            textures.emplace(material->getDiffuseTexture(), bc7Encoding);
+        }
+        if(material->hasNormalTexture()) {
+            textures.emplace(material->getNormalTexture(), bc5Encoding);
+        }
+        if(material->hasRoughnessTexture()) {
+            textures.emplace(material->getRoughnessTexture(), bc4Encoding);
+        }
+        if(material->hasMetallicTexture()) {
+            textures.emplace(material->getMetallicTexture(), bc4Encoding);
+        }
+    }
+    for(auto &child : sceneNode->getChildren()) {
+        collectTextures(child, textures);
+    }
+}
+
+/**
+ * Convert model and texture sources into the caches the runtime loads, so applications never parse or encode assets.
+ *
+ * Every .obj model is parsed, welded, simplified into levels of detail and optimized for the vertex cache,
+ * then written to its binary model cache (.slbmesh). The textures referenced by its materials are block compressed
+ * with a full mip chain according to their slot and written to their texture caches (.slbtex).
+ * Models are processed in parallel on the resource loader's worker pool and textures are encoded as soon as
+ * the model referencing them has been parsed.
+ * Both caches store a hash of their sources, caches whose sources did not change are reused instead of being rebuilt,
+ * so running the cooker again only converts what has changed.
+ * Usage: slbCook [--threads numThreads] [--source directory] [model names...]
+ * The source directory is a folder inside resources/models, since the runtime looks for models and their caches there.
+ * Without model names all .obj files in the source directory are cooked, model names are relative to it.
+ * Textures are always taken from resources/textures, where materials reference them.
+ */
+int main(int argc, char *argv[]) {
+    uint32_t numThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::string sourceDirectory;
+    std::vector<std::string> models;
+    for(int a=1; a<argc; a++) {
+        std::string argument = argv[a];
+        if(argument == "--threads" && a + 1 < argc) {
+            numThreads = std::max(1, std::atoi(argv[++a]));
+        } else if(argument == "--source" && a + 1 < argc) {
+            sourceDirectory = argv[++a];
+            while(!sourceDirectory.empty() && (sourceDirectory.back() == '/' || sourceDirectory.back() == '\\')) {
+                sourceDirectory.pop_back();
+            }
+        } else {
+            models.emplace_back(argument);
+        }
+    }
+    std::string modelDirectory = "../resources/models" + (sourceDirectory.empty() ? "" : "/" + sourceDirectory);
+    if(models.empty()) {
+        for(auto &fileName : MappedFile::listFiles(modelDirectory, ".obj")) {
+            models.emplace_back(fileName.substr(0, fileName.size() - 4));
+        }
+    }
+    if(models.empty()) {
+        std::cout << "No models found in " << modelDirectory << std::endl;
+        return 0;
+    }
+    //model names passed to the loader are relative to resources/models
+    if(!sourceDirectory.empty()) {
+        for(auto &model : models) {
+            model = sourceDirectory + "/" + model;
+        }
+    }
+
+    //the cooked caches always contain compressed textures
+    ResourceLoader::setTextureCompression(true);
+    auto start = std::chrono::high_resolution_clock::now();
+
+    //models share the threads, a model that is up to date only maps its cache
+    uint32_t threadsPerModel = std::max(1u, numThreads / static_cast<uint32_t>(models.size()));
+    std::vector<CacheStatus> modelStatus;
+    std::vector<std::future<std::unique_ptr<SceneNode>>> pendingModels;
+    for(auto &model : models) {
+        modelStatus.emplace_back(getCacheStatus("../resources/models/" + model + ".slbmesh"));
+        pendingModels.emplace_back(ResourceLoader::getThreadPool().submit([model, threadsPerModel]() {
+            auto modelNode = std::make_unique<SceneNode>();
+            ResourceLoader::loadModel(model, modelNode, threadsPerModel);
+            return modelNode;
+        }));
+    }
+
+    uint32_t numCooked = 0;
+    uint32_t numUpToDate = 0;
+    uint32_t numFailed = 0;
+    std::set<std::pair<std::string, TextureEncoding>> requestedTextures;
+    std::vector<TextureJob> textureJobs;
+    for(size_t m=0; m<models.size(); m++) {
+        std::unique_ptr<SceneNode> modelNode;
+        try {
+            modelNode = pendingModels[m].get();
+        } catch(const std::exception &e) {
+            std::cout << "failed      " << models[m] << ": " << e.what() << std::endl;
+            numFailed++;
+            continue;
+        }
+        if(wasRebuilt("../resources/models/" + models[m] + ".slbmesh", modelStatus[m])) {
+            std::cout << "cooked      " << models[m] << ".slbmesh" << std::endl;
+            numCooked++;
+        } else {
+            std::cout << "up to date  " << models[m] << ".slbmesh" << std::endl;
+            numUpToDate++;
+        }
+
+        //textures shared by several models are only encoded once
+        std::set<std::pair<std::string, TextureEncoding>> textures;
+        collectTextures(modelNode, textures);
+        for(auto &texture : textures) {
+            if(!requestedTextures.insert(texture).second) {
+                continue;
+            }
+            TextureJob job;
+            job.fileName = texture.first;
+            job.encoding = texture.second;
+            job.cachePath = "../resources/textures/" + job.fileName + "." + BlockEncoder::getName(job.encoding) + ".slbtex";
+            job.before = getCacheStatus(job.cachePath);
+            ResourceLoader::loadTextureAsync(job.fileName, job.encoding);
+            textureJobs.emplace_back(job);
+        }
+    }
+
+    for(auto &job : textureJobs) {
+        try {
+            ResourceLoader::takeTexture(job.fileName, job.encoding);
+        } catch(const std::exception &e) {
+            std::cout << "failed      " << job.fileName << ": " << e.what() << std::endl;
+            numFailed++;
+            continue;
+        }
+        //KTX2 files are used as they are, without a cache they always count as up to date
+        if(wasRebuilt(job.cachePath, job.before)) {
+            std::cout << "cooked      " << job.fileName << "." << BlockEncoder::getName(job.encoding) << ".slbtex" << std::endl;
+            numCooked++;
+        } else {
+            std::cout << "up to date  " << job.fileName << "." << BlockEncoder::getName(job.encoding) << ".slbtex" << std::endl;
+            numUpToDate++;
+        }
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << numCooked << " cooked, " << numUpToDate << " up to date, " << numFailed << " failed in "
+        << std::fixed << std::setprecision(2) << seconds << " s" << std::endl;
+    return numFailed > 0 ? 1 : 0;
+}
\ No newline at end of file